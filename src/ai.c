@@ -191,6 +191,8 @@ static int aiL_brake( lua_State *L ); /* brake() */
 static int aiL_getnearestplanet( lua_State *L ); /* Vec2 getnearestplanet() */
 static int aiL_getrndplanet( lua_State *L ); /* Vec2 getrndplanet() */
 static int aiL_getlandplanet( lua_State *L ); /* Vec2 getlandplanet() */
+static int aiL_getgatherable( lua_State *L ); /* integer getgatherable(number) */
+static int aiL_gatherablepos( lua_State *L ); /* Vec2, Vec2 gatherablepos(integer) */
 static int aiL_land( lua_State *L ); /* bool land() */
 static int aiL_stop( lua_State *L ); /* stop() */
 static int aiL_relvel( lua_State *L ); /* relvel( number ) */
@@ -271,6 +273,8 @@ static const luaL_Reg aiL_methods[] = {
    { "nearestplanet", aiL_getnearestplanet },
    { "rndplanet", aiL_getrndplanet },
    { "landplanet", aiL_getlandplanet },
+   { "getgatherable", aiL_getgatherable },
+   { "gatherablepos", aiL_gatherablepos },
    { "land", aiL_land },
    { "accel", aiL_accel },
    { "turn", aiL_turn },
@@ -2195,6 +2199,54 @@ static int aiL_getrndplanet( lua_State *L )
    return 1;
 }
 
+/**
+ * @brief Gets the closest gatherable to the pilot within a radius.
+ *
+ * The id stays valid while the gatherable exists, ai.gatherablepos() returns
+ * nil once it's gathered or gone.
+ *
+ *    @luatparam number rad Radius to search within.
+ *    @luatreturn number|nil Id of the gatherable or nil if there is none.
+ * @luafunc getgatherable( rad )
+ */
+static int aiL_getgatherable( lua_State *L )
+{
+   int i;
+   double rad;
+
+   rad = luaL_checknumber(L,1);
+   i = gatherable_getClosest( cur_pilot->solid->pos, rad );
+   if (i < 0)
+      return 0;
+
+   lua_pushnumber(L, i);
+   return 1;
+}
+
+
+/**
+ * @brief Gets the position and velocity of a gatherable.
+ *
+ *    @luatparam number id Id of the gatherable from ai.getgatherable().
+ *    @luatreturn Vec2|nil Position of the gatherable or nil if it's gone.
+ *    @luatreturn Vec2 Velocity of the gatherable.
+ * @luafunc gatherablepos( id )
+ */
+static int aiL_gatherablepos( lua_State *L )
+{
+   Vector2d pos, vel;
+   int i;
+
+   i = luaL_checkint(L,1);
+   if (gatherable_getPos( &pos, &vel, i ) != 0)
+      return 0;
+
+   lua_pushvector(L, pos);
+   lua_pushvector(L, vel);
+   return 2;
+}
+
+
 /**
  * @brief Get a random friendly planet.
  *
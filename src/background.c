@@ -30,6 +30,7 @@
 #include "camera.h"
 #include "nebula.h"
 #include "nstring.h"
+#include "profile.h"
 
 
 /**
@@ -292,6 +293,7 @@ void background_renderStars( const double dt )
    /* Render. */
    gl_vboActivate( star_vertexVBO, GL_VERTEX_ARRAY, 2, GL_FLOAT, 2 * sizeof(GLfloat) );
    gl_vboActivate( star_colourVBO, GL_COLOR_ARRAY,  4, GL_FLOAT, 4 * sizeof(GLfloat) );
+   profile_count( PROFILE_DRAWS, shade_mode ? 2 : 1 );
    if (shade_mode) {
       glDrawArrays( GL_LINES, 0, nstars );
       glDrawArrays( GL_POINTS, 0, nstars ); /* This second pass is when the lines are very short that they "lose" intensity. */
@@ -14,6 +14,111 @@
 #include "naev.h"
 
 #include "log.h"
+#include "profile.h"
+
+
+/*
+ * Collision masks.
+ */
+static const uint64_t* collide_row( const glTexture *t, int frame, int y );
+static uint64_t collide_bits( const uint64_t *row, int x );
+static int collide_coarseAny( const glTexture *t, int frame,
+      int x0, int x1, int y0, int y1 );
+static int collide_firstBit( uint64_t m );
+
+
+/**
+ * @brief Gets a row of the collision mask of a sprite.
+ *
+ *    @param t Texture the sprite belongs to.
+ *    @param frame Index of the sprite in the (flipped) sheet.
+ *    @param y Row within the sprite.
+ *    @return The packed row.
+ */
+static const uint64_t* collide_row( const glTexture *t, int frame, int y )
+{
+   return &t->collide[ ((size_t)frame*(int)t->sh + y) * (t->collide_words+1) ];
+}
+
+
+/**
+ * @brief Gets the 64 pixels of a mask row starting at a column.
+ *
+ *    @param row Row to read, as given by collide_row().
+ *    @param x First column, within the sprite.
+ *    @return Pixels with column x as the lowest bit, past the sprite is 0.
+ */
+static uint64_t collide_bits( const uint64_t *row, int x )
+{
+   int w, s;
+
+   w = x / 64;
+   s = x % 64;
+   if (s == 0)
+      return row[w];
+   /* Rows have a trailing zero word, so w+1 is always valid. */
+   return (row[w] >> s) | (row[w+1] << (64-s));
+}
+
+
+/**
+ * @brief Checks the coarse mask of a sprite for opaque blocks in a rectangle.
+ *
+ *    @param t Texture the sprite belongs to.
+ *    @param frame Index of the sprite in the (flipped) sheet.
+ *    @param x0 Left of the rectangle within the sprite.
+ *    @param x1 Right of the rectangle within the sprite.
+ *    @param y0 Bottom of the rectangle within the sprite.
+ *    @param y1 Top of the rectangle within the sprite.
+ *    @return 1 if any block touching the rectangle has an opaque pixel.
+ */
+static int collide_coarseAny( const glTexture *t, int frame,
+      int x0, int x1, int y0, int y1 )
+{
+   int y, w, w0, w1, crows;
+   uint64_t m;
+   const uint64_t *row;
+
+   /* Blocks of the rectangle. */
+   x0 /= 8;
+   x1 /= 8;
+   w0 = x0 / 64;
+   w1 = x1 / 64;
+   crows = ((int)t->sh+7) / 8;
+
+   for (y=y0/8; y<=y1/8; y++) {
+      row = &t->collide_coarse[ ((size_t)frame*crows + y) * t->collide_cwords ];
+      for (w=w0; w<=w1; w++) {
+         m = ~(uint64_t)0;
+         if (w == w0)
+            m &= ~(uint64_t)0 << (x0%64);
+         if ((w == w1) && (x1%64 != 63))
+            m &= ((uint64_t)1 << (x1%64+1)) - 1;
+         if (row[w] & m)
+            return 1;
+      }
+   }
+   return 0;
+}
+
+
+/**
+ * @brief Gets the lowest set bit of a word.
+ *
+ *    @param m Word to check, must not be 0.
+ *    @return Index of the lowest set bit.
+ */
+static int collide_firstBit( uint64_t m )
+{
+#ifdef __GNUC__
+   return __builtin_ctzll( m );
+#else /* __GNUC__ */
+   int i;
+   for (i=0; !(m & 1); i++)
+      m >>= 1;
+   return i;
+#endif /* __GNUC__ */
+}
 
 
 /**
@@ -37,20 +142,23 @@ int CollideSprite( const glTexture* at, const int asx, const int asy, const Vect
       const glTexture* bt, const int bsx, const int bsy, const Vector2d* bp,
       Vector2d* crash )
 {
-   int x,y;
+   int x,y, n;
    int ax1,ax2, ay1,ay2;
    int bx1,bx2, by1,by2;
    int inter_x0, inter_x1, inter_y0, inter_y1;
-   int rasy, rbsy;
-   int abx,aby, bbx, bby;
+   int aframe, bframe;
+   const uint64_t *arow, *brow;
+   uint64_t m;
+
+   profile_count( PROFILE_COLLIDE, 1 );
 
 #if DEBUGGING
-   /* Make sure the surfaces have transparency maps. */
-   if (at->trans == NULL) {
+   /* Make sure the surfaces have collision masks. */
+   if (at->collide == NULL) {
       WARN(_("Texture '%s' has no transparency map"), at->name);
       return 0;
    }
-   if (bt->trans == NULL) {
+   if (bt->collide == NULL) {
       WARN(_("Texture '%s' has no transparency map"), bt->name);
       return 0;
    }
@@ -78,27 +186,36 @@ int CollideSprite( const glTexture* at, const int asx, const int asy, const Vect
    inter_y0 = MAX( ay1, by1 );
    inter_y1 = MIN( ay2, by2 );
 
-   /* real vertical sprite value (flipped) */
-   rasy = at->sy - asy - 1;
-   rbsy = bt->sy - bsy - 1;
-
-   /* set up the base points */
-   abx =  asx*(int)(at->sw) - ax1;
-   aby = rasy*(int)(at->sh) - ay1;
-   bbx =  bsx*(int)(bt->sw) - bx1;
-   bby = rbsy*(int)(bt->sh) - by1;
+   /* sprites in the masks (flipped vertically) */
+   aframe = (at->sy - asy - 1)*(int)(at->sx) + asx;
+   bframe = (bt->sy - bsy - 1)*(int)(bt->sx) + bsx;
 
-   for (y=inter_y0; y<=inter_y1; y++)
-      for (x=inter_x0; x<=inter_x1; x++)
-         /* compute offsets for surface before pass to TransparentPixel test */
-         if ((!gl_isTrans(at, abx + x, aby + y)) &&
-               (!gl_isTrans(bt, bbx + x, bby + y))) {
+   /* both need opaque blocks in the intersection to collide */
+   if (!collide_coarseAny( at, aframe, inter_x0-ax1, inter_x1-ax1,
+            inter_y0-ay1, inter_y1-ay1 ))
+      return 0;
+   if (!collide_coarseAny( bt, bframe, inter_x0-bx1, inter_x1-bx1,
+            inter_y0-by1, inter_y1-by1 ))
+      return 0;
 
+   /* AND the rows 64 pixels at a time, lowest bit is the leftmost pixel */
+   n = inter_x1 - inter_x0 + 1;
+   for (y=inter_y0; y<=inter_y1; y++) {
+      arow = collide_row( at, aframe, y - ay1 );
+      brow = collide_row( bt, bframe, y - by1 );
+      for (x=0; x<n; x+=64) {
+         m = collide_bits( arow, inter_x0 - ax1 + x ) &
+               collide_bits( brow, inter_x0 - bx1 + x );
+         if (n-x < 64)
+            m &= ((uint64_t)1 << (n-x)) - 1;
+         if (m != 0) {
             /* Set the crash position. */
-            crash->x = x;
+            crash->x = inter_x0 + x + collide_firstBit( m );
             crash->y = y;
             return 1;
          }
+      }
+   }
 
    return 0;
 }
@@ -125,6 +242,8 @@ int CollideLineLine( double s1x, double s1y, double e1x, double e1y,
    double ua_t, ub_t, u_b;
    double ua, ub;
 
+   profile_count( PROFILE_COLLIDE, 1 );
+
    ua_t = (e2x - s2x) * (s1y - s2y) - (e2y - s2y) * (s1x - s2x);
    ub_t = (e1x - s1x) * (s1y - s2y) - (e1y - s1y) * (s1x - s2x);
    u_b  = (e2y - s2y) * (e1x - s1x) - (e2x - s2x) * (e1y - s1y);
@@ -159,7 +278,8 @@ int CollideLineLine( double s1x, double s1y, double e1x, double e1y,
  *
  * First collisions are detected on all the walls of the sprite's rectangle.
  *  Then the collisions are tested by pixel perfectness until collisions are
- *  actually found with the ship itself.
+ *  actually found with the ship itself. Only the pixels between where the line
+ *  starts (possibly inside the rectangle) and where it ends are checked.
  *
  *    @param[in] ap Origin of the line.
  *    @param[in] ad Direction of the line.
@@ -177,11 +297,13 @@ int CollideLineSprite( const Vector2d* ap, double ad, double al,
       const glTexture* bt, const int bsx, const int bsy, const Vector2d* bp,
       Vector2d crash[2] )
 {
-   int x,y, rbsy, bbx,bby;
-   double ep[2], bl[2], tr[2], v[2], mod;
+   int i, n, rbsy, bbx,bby;
+   double x,y, ep[2], bl[2], tr[2], v[2], mod;
    int hits, real_hits;
    Vector2d tmp_crash, border[2];
 
+   profile_count( PROFILE_COLLIDE, 1 );
+
    /* Make sure texture has transparency map. */
    if (bt->trans == NULL) {
       WARN(_("Texture '%s' has no transparency map"), bt->name);
@@ -233,6 +355,21 @@ int CollideLineSprite( const Vector2d* ap, double ad, double al,
       hits++;
    }
 
+   /* Line starts inside the rectangle, so it's the first border. */
+   if ((hits < 2) && (ap->x > bl[0]) && (ap->x < tr[0]) &&
+         (ap->y > bl[1]) && (ap->y < tr[1])) {
+      /* Ends where it leaves the rectangle or inside it. */
+      if (hits == 1)
+         border[1] = border[0];
+      else {
+         border[1].x = ep[0];
+         border[1].y = ep[1];
+      }
+      border[0].x = ap->x;
+      border[0].y = ap->y;
+      hits = 2;
+   }
+
    /* No hits - missed. */
    if (hits == 0)
       return 0;
@@ -243,6 +380,10 @@ int CollideLineSprite( const Vector2d* ap, double ad, double al,
       border[1].y = ep[1];
    }
 
+   /* Too short to walk along. */
+   if ((border[0].x == border[1].x) && (border[0].y == border[1].y))
+      return 0;
+
    /*
     * Now we do a pixel perfect approach.
     */
@@ -254,6 +395,8 @@ int CollideLineSprite( const Vector2d* ap, double ad, double al,
    mod = MOD(v[0],v[1])/2.; /* Multiply by two to reduce check amount. */
    v[0] /= mod;
    v[1] /= mod;
+   /* Only walk between the borders, the line doesn't go on past them. */
+   n = (int)mod;
 
    /* real vertical sprite value (flipped) */
    rbsy = bt->sy - bsy - 1;
@@ -264,7 +407,7 @@ int CollideLineSprite( const Vector2d* ap, double ad, double al,
    /* We start checking first border until we find collision. */
    x = border[0].x - bl[0] + v[0];
    y = border[0].y - bl[1] + v[1];
-   while ((x > 0.) && (x < bt->sw) && (y > 0.) && (y < bt->sh)) {
+   for (i=0; (i < n) && (x > 0.) && (x < bt->sw) && (y > 0.) && (y < bt->sh); i++) {
       /* Is non-transparent. */
       if (!gl_isTrans(bt, bbx+(int)x, bby+(int)y)) {
          crash[real_hits].x = x + bl[0];
@@ -279,7 +422,7 @@ int CollideLineSprite( const Vector2d* ap, double ad, double al,
    /* Now we check the second border. */
    x = border[1].x - bl[0] - v[0];
    y = border[1].y - bl[1] - v[1];
-   while ((x > 0.) && (x < bt->sw) && (y > 0.) && (y < bt->sh)) {
+   for (i=0; (i < n) && (x > 0.) && (x < bt->sw) && (y > 0.) && (y < bt->sh); i++) {
       /* Is non-transparent. */
       if (!gl_isTrans(bt, bbx+(int)x, bby+(int)y)) {
          crash[real_hits].x = x + bl[0];
@@ -16,9 +16,20 @@
 #include "log.h"
 #include "nlua.h"
 #include "nluadef.h"
+#include "profile.h"
 
 
-static nlua_env cond_env = LUA_NOREF; /** Conditional Lua env. */
+static nlua_env cond_env   = LUA_NOREF; /** Conditional Lua env. */
+static int cond_cache      = LUA_NOREF; /**< Registry table of compiled conditions by string. */
+static unsigned long cond_nchecks = 0; /**< Conditions checked. */
+static unsigned long cond_nhits = 0; /**< Checks that found the condition already compiled. */
+static double cond_time    = 0.; /**< Seconds spent checking conditions while profiling. */
+
+
+/*
+ * Prototypes.
+ */
+static int cond_load( const char *cond );
 
 
 /**
@@ -35,6 +46,9 @@ int cond_init (void)
       return -1;
    }
 
+   lua_newtable(naevL);
+   cond_cache = luaL_ref(naevL, LUA_REGISTRYINDEX);
+
    return 0;
 }
 
@@ -47,11 +61,79 @@ void cond_exit (void)
    if (cond_env == LUA_NOREF)
       return;
 
+#ifdef DEBUGGING
+   if (cond_nchecks > 0)
+      DEBUG(_("Conditionals: %lu checks, %lu compiled, %.3f ms profiled"),
+            cond_nchecks, cond_nchecks - cond_nhits, cond_time * 1000.);
+#endif /* DEBUGGING */
+
+   luaL_unref(naevL, LUA_REGISTRYINDEX, cond_cache);
+   cond_cache = LUA_NOREF;
    nlua_freeEnv(cond_env);
    cond_env = LUA_NOREF;
 }
 
 
+/**
+ * @brief Gets the statistics of the conditional subsystem.
+ *
+ *    @param[out] checks Conditions checked.
+ *    @param[out] hits Checks that didn't have to compile the condition.
+ *    @param[out] time Seconds spent checking conditions while profiling.
+ */
+void cond_stats( unsigned long *checks, unsigned long *hits, double *time )
+{
+   *checks = cond_nchecks;
+   *hits   = cond_nhits;
+   *time   = cond_time;
+}
+
+
+/**
+ * @brief Pushes the compiled function of a condition.
+ *
+ * Conditions are compiled once with their environment already set and kept
+ *  keyed by the condition string, so checking it again is only a call.
+ *
+ *    @param cond Condition to load.
+ *    @return 0 on success, or the luaL_loadbuffer() error with the message
+ *            pushed.
+ */
+static int cond_load( const char *cond )
+{
+   int ret;
+
+   lua_rawgeti(naevL, LUA_REGISTRYINDEX, cond_cache); /* c */
+   lua_getfield(naevL, -1, cond); /* c, f */
+   if (lua_isfunction(naevL, -1)) {
+      lua_remove(naevL, -2); /* f */
+      cond_nhits++;
+      return 0;
+   }
+   lua_pop(naevL, 1); /* c */
+
+   /* Compile it as an expression. */
+   lua_pushstring(naevL, "return ");
+   lua_pushstring(naevL, cond);
+   lua_concat(naevL, 2); /* c, s */
+   ret = luaL_loadbuffer(naevL, lua_tostring(naevL,-1),
+                         lua_strlen(naevL,-1), "Lua Conditional"); /* c, s, f */
+   lua_remove(naevL, -2); /* c, f */
+   if (ret != 0) {
+      lua_remove(naevL, -2); /* err */
+      return ret;
+   }
+   nlua_pushenv(cond_env);
+   lua_setfenv(naevL, -2);
+
+   /* Keep it. */
+   lua_pushvalue(naevL, -1); /* c, f, f */
+   lua_setfield(naevL, -3, cond); /* c, f */
+   lua_remove(naevL, -2); /* f */
+   return 0;
+}
+
+
 /**
  * @brief Checks to see if a condition is true.
  *
@@ -62,13 +144,16 @@ int cond_check( const char* cond )
 {
    int b;
    int ret;
+   double t;
+
+   t = profile_begin();
+   cond_nchecks++;
+   profile_count( PROFILE_COND, 1 );
 
    /* Load the string. */
-   lua_pushstring(naevL, "return ");
-   lua_pushstring(naevL, cond);
-   lua_concat(naevL, 2);
-   ret = nlua_dobufenv(cond_env, lua_tostring(naevL,-1),
-                       lua_strlen(naevL,-1), "Lua Conditional");
+   ret = cond_load( cond );
+   if (ret == 0)
+      ret = nlua_pcall(cond_env, 0, 1);
    switch (ret) {
       case  LUA_ERRSYNTAX:
          WARN(_("Lua conditional syntax error: %s"), lua_tostring(naevL, -1));
@@ -98,6 +183,8 @@ int cond_check( const char* cond )
       /* Clear the stack. */
       lua_settop(naevL, 0);
 
+      if (profile_active)
+         cond_time += profile_now() - t;
       return ret;
    }
    WARN(_("Lua Conditional didn't return a boolean"));
@@ -105,5 +192,7 @@ int cond_check( const char* cond )
 cond_err:
    /* Clear the stack. */
    lua_settop(naevL, 0);
+   if (profile_active)
+      cond_time += profile_now() - t;
    return -1;
 }
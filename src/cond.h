@@ -10,6 +10,7 @@
 int cond_init (void);
 void cond_exit (void);
 int cond_check( const char *cond );
+void cond_stats( unsigned long *checks, unsigned long *hits, double *time );
 
 
 #endif /* COND_H */
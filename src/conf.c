@@ -101,6 +101,12 @@ static void print_usage( char **argv )
    LOG(_("   -N, --nondata         do not use ndata and try to use laid out files"));
    LOG(_("   -d, --datapath        specifies a custom path for all user data (saves, screenshots, etc.)"));
    LOG(_("   -X, --scale           defines the scale factor"));
+   LOG(_("   --headless s          simulates system s without a display, then exits"));
+   LOG(_("   --scenario s          runs scenario s from %s without a display, then exits"), SCENARIO_DATA_PATH);
+   LOG(_("   --ticks n             number of ticks to simulate headless (default %d)"), HEADLESS_TICKS_DEFAULT);
+   LOG(_("   --seed n              random seed to simulate headless with"));
+   LOG(_("   --trace f             replays trace file f headless, recording it if it doesn't exist"));
+   LOG(_("   --profile-csv         writes every profiled frame to profile.csv in the cache"));
 #ifdef DEBUGGING
    LOG(_("   --devmode             enables dev mode perks like the editors"));
    LOG(_("   --devcsv              generates csv output from the ndata for development purposes"));
@@ -156,6 +162,9 @@ void conf_setDefaults (void)
    conf.devmode      = 0;
    conf.devautosave  = 0;
    conf.devcsv       = 0;
+   conf.headless_ticks = 0;
+   conf.headless_seed = -1;
+   conf.profile_csv  = 0;
 
    /* Gameplay. */
    conf_setGameplayDefaults();
@@ -297,6 +306,12 @@ void conf_cleanup (void)
       free(conf.dev_save_map);
    if (conf.dev_save_asset != NULL)
       free(conf.dev_save_asset);
+   if (conf.headless != NULL)
+      free(conf.headless);
+   if (conf.scenario != NULL)
+      free(conf.scenario);
+   if (conf.trace != NULL)
+      free(conf.trace);
 
    /* Clear memory. */
    memset( &conf, 0, sizeof(conf) );
@@ -612,6 +627,12 @@ void conf_parseCLI( int argc, char** argv )
       { "generate", no_argument, 0, 'G' },
       { "nondata", no_argument, 0, 'N' },
       { "scale", required_argument, 0, 'X' },
+      { "headless", required_argument, 0, 'B' },
+      { "scenario", required_argument, 0, 'E' },
+      { "ticks", required_argument, 0, 'T' },
+      { "seed", required_argument, 0, 'R' },
+      { "trace", required_argument, 0, 'Q' },
+      { "profile-csv", no_argument, 0, 'P' },
 #ifdef DEBUGGING
       { "devmode", no_argument, 0, 'D' },
       { "devcsv", no_argument, 0, 'C' },
@@ -680,6 +701,30 @@ void conf_parseCLI( int argc, char** argv )
          case 'X':
             conf.scalefactor = atof(optarg);
             break;
+         case 'B':
+            if (conf.headless != NULL)
+               free(conf.headless);
+            conf.headless = strdup(optarg);
+            break;
+         case 'E':
+            if (conf.scenario != NULL)
+               free(conf.scenario);
+            conf.scenario = strdup(optarg);
+            break;
+         case 'T':
+            conf.headless_ticks = atoi(optarg);
+            break;
+         case 'R':
+            conf.headless_seed = strtoul(optarg, NULL, 10);
+            break;
+         case 'Q':
+            if (conf.trace != NULL)
+               free(conf.trace);
+            conf.trace = strdup(optarg);
+            break;
+         case 'P':
+            conf.profile_csv = 1;
+            break;
 #ifdef DEBUGGING
          case 'D':
             conf.devmode = 1;
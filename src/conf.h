@@ -57,6 +57,8 @@
 #define DEV_SAVE_SYSTEM_DEFAULT           "dat/ssys/"
 #define DEV_SAVE_ASSET_DEFAULT            "dat/assets/"
 #define DEV_SAVE_MAP_DEFAULT              "dat/outfits/maps/"
+/* Headless options */
+#define HEADLESS_TICKS_DEFAULT               3600  /**< Ticks to simulate when headless (a minute at 60 fps). */
 
 
 /**
@@ -148,6 +150,12 @@ typedef struct PlayerConf_s {
    int devmode; /**< Developer mode. */
    int devautosave; /**< Developer mode autosave. */
    int devcsv; /**< Output CSV data. */
+   char *headless; /**< System to simulate without a display, NULL to play normally. */
+   char *scenario; /**< Scenario to run without a display, NULL to play normally. */
+   int headless_ticks; /**< Ticks to simulate when headless, 0 for the default. */
+   long headless_seed; /**< Seed to simulate headless with, -1 to pick one. */
+   char *trace; /**< Trace to replay or record when headless. */
+   int profile_csv; /**< Whether the profiler writes every frame to a CSV. */
 
    /* Debugging. */
    int fpu_except; /**< Enable FPU exceptions? */
@@ -366,7 +366,7 @@ static void sysedit_btnNew( unsigned int wid_unused, char *unused )
    /* Create the new planet. */
    p        = planet_new();
    p->real  = ASSET_REAL;
-   p->name  = name;
+   planet_setName( p, name );
 
    /* Base planet data off another. */
    b                    = planet_get( space_getRndPlanet(0, 0, NULL) );
@@ -436,9 +436,8 @@ static void sysedit_btnRename( unsigned int wid_unused, char *unused )
 
          free(oldName);
          free(newName);
-         free(p->name);
 
-         p->name = name;
+         planet_setName( p, name );
          window_modifyText( sysedit_widEdit, "txtName", p->name );
          dpl_savePlanet( p );
       }
@@ -1922,7 +1921,7 @@ static void sysedit_planetGFX( unsigned int wid_unused, char *wgt )
    bg             = malloc( sizeof(glColour) * nfiles );
    j              = 0;
    for (i=0; i<nfiles; i++) {
-      nsnprintf( buf, sizeof(buf), "%s/%s", path, files[i] );
+      nsnprintf( buf, sizeof(buf), "%s%s", path, files[i] );
       t              = gl_newImage( buf, OPENGL_TEX_MIPMAPS );
       if (t != NULL) {
          tex[j]         = t;
@@ -736,9 +736,8 @@ static void uniedit_renameSys (void)
 
       free(oldName);
       free(newName);
-      free(sys->name);
 
-      sys->name = name;
+      system_setName( sys, name );
       dsys_saveSystem(sys);
 
       /* Re-save adjacent systems. */
@@ -778,7 +777,7 @@ static void uniedit_newSys( double x, double y )
 
    /* Create the system. */
    sys         = system_new();
-   sys->name   = name;
+   system_setName( sys, name );
    sys->pos.x  = x;
    sys->pos.y  = y;
    sys->stars  = STARS_DENSITY_DEFAULT;
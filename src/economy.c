@@ -36,6 +36,7 @@
 #include "rng.h"
 #include "space.h"
 #include "ntime.h"
+#include "nhash.h"
 
 
 #define XML_COMMODITY_ID      "Commodities" /**< XML document identifier */
@@ -52,9 +53,19 @@
 #define ECON_PROD_VAR      0.01 /**< Defines the variability of production. */
 
 
+/*
+ * Gatherables.
+ */
+#define GATHER_CHUNK       64 /**< Smallest gatherable stack and grid. */
+#define GATHER_CELL        128. /**< Size of a cell of the gatherable grid. */
+#define GATHER_QUERY_MAX   64 /**< Most grid cells a query visits before checking all the gatherables. */
+#define GATHER_FACTOR      0.03 /**< Scale of the distance and relative speed a pilot must be within to gather. */
+
+
 /* commodity stack */
 static Commodity* commodity_stack = NULL; /**< Contains all the commodities. */
 static int commodity_nstack       = 0; /**< Number of commodities in the stack. */
+static NHash* commodity_hash      = NULL; /**< Commodity name to index in the stack. */
 
 
 /* systems stack. */
@@ -65,6 +76,15 @@ extern int systems_nstack; /**< Number of star systems. */
 /* gatherables stack */
 static Gatherable* gatherable_stack = NULL; /**< Contains the gatherable stuff floating around. */
 static int gatherable_nstack        = 0; /**< Number of gatherables in the stack. */
+static int gatherable_mstack        = 0; /**< Memory allocated for the gatherables. */
+static int gatherable_id            = 0; /**< Id of the last gatherable created. */
+/* Spatial hash of the gatherables, rebuilt every update. */
+static int *gatherable_grid         = NULL; /**< Gatherables sorted by grid bucket. */
+static int *gatherable_gridb        = NULL; /**< Grid bucket of each gatherable. */
+static int *gatherable_gridstart    = NULL; /**< First entry of gatherable_grid of each bucket. */
+static int gatherable_gridmask      = -1; /**< Number of buckets minus one. */
+static int gatherable_ngrid         = 0; /**< Gatherables in the grid. */
+static int gatherable_mgrid         = 0; /**< Memory allocated for the grid. */
 float noscoop_timer                 = 1.; /**< Timer for the "full cargo" message . */
 
 
@@ -76,6 +96,8 @@ static int econ_queued        = 0; /**< Whether there are any queued updates. */
 static int *econ_comm         = NULL; /**< Commodities to calculate. */
 static int econ_nprices       = 0; /**< Number of prices to calculate. */
 static cs *econ_G             = NULL; /**< Admittance matrix. */
+static css *econ_S            = NULL; /**< Symbolic Cholesky analysis of econ_G. */
+static csn *econ_N            = NULL; /**< Cholesky factor of econ_G. */
 
 
 /*
@@ -87,6 +109,18 @@ static int commodity_parse( Commodity *temp, xmlNodePtr parent );
 /* Economy. */
 static double econ_calcJumpR( StarSystem *A, StarSystem *B );
 static int econ_createGMatrix (void);
+static void econ_freeFactor (void);
+static int econ_factorize (void);
+static int econ_solve( double *B, int nrhs );
+/* Gatherables. */
+static int gatherable_bucket( int cx, int cy );
+static int gatherable_buckets( double x, double y, double rad, int *buckets, int max );
+static void gatherable_gridBuild (void);
+static void gatherable_query( double x, double y, double rad,
+      int (*func)( int id, void *data ), void *data );
+static int gatherable_gatherOne( int id, void *data );
+static int gatherable_closestOne( int id, void *data );
+static int gatherable_compid( const void *id, const void *p );
 credits_t economy_getPrice( const Commodity *com,
       const StarSystem *sys, const Planet *p ); /* externed in land.c */
 
@@ -148,9 +182,9 @@ void price2str(char *str, credits_t price, credits_t credits, int decimals )
 Commodity* commodity_get( const char* name )
 {
    int i;
-   for (i=0; i<commodity_nstack; i++)
-      if (strcmp(commodity_stack[i].name,name)==0)
-         return &commodity_stack[i];
+   i = nhash_get( commodity_hash, name );
+   if (i >= 0)
+      return &commodity_stack[i];
 
    WARN(_("Commodity '%s' not found in stack"), name);
    return NULL;
@@ -166,10 +200,8 @@ Commodity* commodity_get( const char* name )
 Commodity* commodity_getW( const char* name )
 {
    int i;
-   for (i=0; i<commodity_nstack; i++)
-      if (strcmp(commodity_stack[i].name,name)==0)
-         return &commodity_stack[i];
-   return NULL;
+   i = nhash_get( commodity_hash, name );
+   return (i >= 0) ? &commodity_stack[i] : NULL;
 }
 
 
@@ -326,14 +358,111 @@ void commodity_Jettison( int pilot, Commodity* com, int quantity )
  */
 void gatherable_init( Commodity* com, Vector2d pos, Vector2d vel )
 {
-   gatherable_stack = realloc(gatherable_stack,
-                              sizeof(Gatherable)*(++gatherable_nstack));
+   Gatherable *gat;
+
+   if (gatherable_nstack >= gatherable_mstack) {
+      gatherable_mstack = MAX( GATHER_CHUNK, 2*gatherable_mstack );
+      gatherable_stack  = realloc( gatherable_stack,
+            sizeof(Gatherable) * gatherable_mstack );
+   }
+
+   gat = &gatherable_stack[ gatherable_nstack++ ];
+   gat->id        = ++gatherable_id;
+   gat->type      = com;
+   gat->pos       = pos;
+   gat->vel       = vel;
+   gat->timer     = 0.;
+   gat->lifeleng  = RNGF()*100. + 50.;
+}
+
+
+/**
+ * @brief Gets the bucket of the grid cell holding a position.
+ */
+static int gatherable_bucket( int cx, int cy )
+{
+   return ((unsigned int)cx*73856093u ^ (unsigned int)cy*19349663u) & gatherable_gridmask;
+}
+
+
+/**
+ * @brief Gets the buckets of the grid covering a disc.
+ *
+ *    @param x X position of the center.
+ *    @param y Y position of the center.
+ *    @param rad Radius of the disc.
+ *    @param[out] buckets Distinct buckets covering the disc.
+ *    @param max Size of buckets.
+ *    @return Number of buckets or -1 if it needs more than max, in which case
+ *            the whole stack should be searched.
+ */
+static int gatherable_buckets( double x, double y, double rad, int *buckets, int max )
+{
+   int cx, cy, cx1, cx2, cy1, cy2, b, i, n;
+
+   if (gatherable_grid == NULL)
+      return 0;
 
-   gatherable_stack[gatherable_nstack-1].type = com;
-   gatherable_stack[gatherable_nstack-1].pos = pos;
-   gatherable_stack[gatherable_nstack-1].vel = vel;
-   gatherable_stack[gatherable_nstack-1].timer = 0.;
-   gatherable_stack[gatherable_nstack-1].lifeleng = RNGF()*100. + 50.;
+   cx1 = (int)floor( (x-rad) / GATHER_CELL );
+   cx2 = (int)floor( (x+rad) / GATHER_CELL );
+   cy1 = (int)floor( (y-rad) / GATHER_CELL );
+   cy2 = (int)floor( (y+rad) / GATHER_CELL );
+   if ((cx2-cx1+1) * (cy2-cy1+1) > max)
+      return -1;
+
+   n = 0;
+   for (cx=cx1; cx<=cx2; cx++) {
+      for (cy=cy1; cy<=cy2; cy++) {
+         b = gatherable_bucket( cx, cy );
+         for (i=0; i<n; i++)
+            if (buckets[i] == b)
+               break;
+         if (i == n)
+            buckets[n++] = b;
+      }
+   }
+   return n;
+}
+
+
+/**
+ * @brief Sorts the gatherables into the grid.
+ */
+static void gatherable_gridBuild (void)
+{
+   int i, b, nbuckets;
+
+   /* Keep about one gatherable per bucket. */
+   for (nbuckets=GATHER_CHUNK; nbuckets < gatherable_nstack; nbuckets *= 2);
+   if (nbuckets != gatherable_gridmask+1) {
+      gatherable_gridmask  = nbuckets-1;
+      gatherable_gridstart = realloc( gatherable_gridstart,
+            sizeof(int) * (nbuckets+1) );
+   }
+   if (gatherable_mstack > gatherable_mgrid) {
+      gatherable_mgrid  = gatherable_mstack;
+      gatherable_grid   = realloc( gatherable_grid, sizeof(int) * gatherable_mgrid );
+      gatherable_gridb  = realloc( gatherable_gridb, sizeof(int) * gatherable_mgrid );
+   }
+
+   /* Counting sort by bucket. */
+   memset( gatherable_gridstart, 0, sizeof(int) * (nbuckets+1) );
+   for (i=0; i<gatherable_nstack; i++) {
+      b = gatherable_bucket( (int)floor( gatherable_stack[i].pos.x / GATHER_CELL ),
+            (int)floor( gatherable_stack[i].pos.y / GATHER_CELL ) );
+      gatherable_gridb[i] = b;
+      gatherable_gridstart[b+1]++;
+   }
+   for (b=0; b<nbuckets; b++)
+      gatherable_gridstart[b+1] += gatherable_gridstart[b];
+   for (i=0; i<gatherable_nstack; i++)
+      gatherable_grid[ gatherable_gridstart[ gatherable_gridb[i] ]++ ] = i;
+
+   /* The starts were shifted to the ends while filling, shift them back. */
+   for (b=nbuckets; b>0; b--)
+      gatherable_gridstart[b] = gatherable_gridstart[b-1];
+   gatherable_gridstart[0] = 0;
+   gatherable_ngrid = gatherable_nstack;
 }
 
 
@@ -344,26 +473,29 @@ void gatherable_init( Commodity* com, Vector2d pos, Vector2d vel )
  */
 void gatherable_update( double dt )
 {
-   int i;
+   int i, j;
+   Gatherable *gat;
 
    /* Update the timer for "full cargo" message. */
    noscoop_timer += dt;
 
-   for (i=0; i < gatherable_nstack; i++) {
-      gatherable_stack[i].timer += dt;
-      gatherable_stack[i].pos.x += dt*gatherable_stack[i].vel.x;
-      gatherable_stack[i].pos.y += dt*gatherable_stack[i].vel.y;
-
-      /* Remove the gatherable */
-      if (gatherable_stack[i].timer > gatherable_stack[i].lifeleng) {
-         gatherable_nstack--;
-         memmove( &gatherable_stack[i], &gatherable_stack[i+1],
-                 sizeof(Gatherable)*(gatherable_nstack-i) );
-         gatherable_stack = realloc(gatherable_stack,
-                                    sizeof(Gatherable) * gatherable_nstack);
-         i--;
-      }
+   /* Remove the gathered and expired gatherables, keeping the ids sorted. */
+   j = 0;
+   for (i=0; i<gatherable_nstack; i++) {
+      gat = &gatherable_stack[i];
+      if ((gat->type == NULL) || (gat->timer + dt > gat->lifeleng))
+         continue;
+
+      gat->timer += dt;
+      gat->pos.x += dt*gat->vel.x;
+      gat->pos.y += dt*gat->vel.y;
+      if (j != i)
+         gatherable_stack[j] = *gat;
+      j++;
    }
+   gatherable_nstack = j;
+
+   gatherable_gridBuild();
 }
 
 
@@ -375,6 +507,16 @@ void gatherable_free( void )
    free(gatherable_stack);
    gatherable_stack = NULL;
    gatherable_nstack = 0;
+   gatherable_mstack = 0;
+   free(gatherable_grid);
+   gatherable_grid = NULL;
+   free(gatherable_gridb);
+   gatherable_gridb = NULL;
+   free(gatherable_gridstart);
+   gatherable_gridstart = NULL;
+   gatherable_gridmask = -1;
+   gatherable_ngrid = 0;
+   gatherable_mgrid = 0;
 }
 
 
@@ -388,11 +530,97 @@ void gatherable_render( void )
 
    for (i=0; i < gatherable_nstack; i++) {
       gat = &gatherable_stack[i];
+      if (gat->type == NULL)
+         continue;
       gl_blitSprite( gat->type->gfx_space, gat->pos.x, gat->pos.y, 0, 0, NULL );
    }
 }
 
 
+/**
+ * @brief Calls a function on the gatherables that may be within a disc.
+ *
+ * Only the grid buckets covering the disc are visited, along with the
+ * gatherables added since the grid was last built. Gathered ones are skipped.
+ *
+ *    @param x X position of the center.
+ *    @param y Y position of the center.
+ *    @param rad Radius of the disc.
+ *    @param func Function to call with the index of each gatherable, stops
+ *                the search when it returns nonzero.
+ *    @param data Data to pass to func.
+ */
+static void gatherable_query( double x, double y, double rad,
+      int (*func)( int id, void *data ), void *data )
+{
+   int buckets[GATHER_QUERY_MAX];
+   int i, j, n, id;
+
+   n = gatherable_buckets( x, y, rad, buckets, GATHER_QUERY_MAX );
+
+   /* Too big to be worth the grid, check them all. */
+   if (n < 0) {
+      for (i=0; i<gatherable_nstack; i++)
+         if ((gatherable_stack[i].type != NULL) && func( i, data ))
+            return;
+      return;
+   }
+
+   for (i=0; i<n; i++) {
+      for (j=gatherable_gridstart[buckets[i]]; j<gatherable_gridstart[buckets[i]+1]; j++) {
+         id = gatherable_grid[j];
+         if ((gatherable_stack[id].type != NULL) && func( id, data ))
+            return;
+      }
+   }
+   for (id=gatherable_ngrid; id<gatherable_nstack; id++)
+      if ((gatherable_stack[id].type != NULL) && func( id, data ))
+         return;
+}
+
+
+/**
+ * @brief Tries to gather a gatherable with a pilot.
+ *
+ *    @param id Index of the gatherable.
+ *    @param data Pilot gathering.
+ *    @return 1 when the pilot has no cargo space left.
+ */
+static int gatherable_gatherOne( int id, void *data )
+{
+   int q;
+   Gatherable *gat;
+   Pilot *p;
+
+   p   = (Pilot*) data;
+   gat = &gatherable_stack[id];
+
+   if (GATHER_FACTOR*vect_dist( &p->solid->pos, &gat->pos ) +
+       GATHER_FACTOR*vect_dist( &p->solid->vel, &gat->vel )  >= 1. )
+      return 0;
+
+   /* Add cargo to pilot. */
+   q = pilot_cargoAdd( p, gat->type, RNG(1,5), 0 );
+
+   if (q>0) {
+      if (pilot_isPlayer(p))
+         player_message( ngettext("%d ton of %s gathered", "%d tons of %s gathered", q), q, gat->type->name );
+
+      /* Remove the object from space, it gets dropped from the stack on the next update. */
+      gat->type = NULL;
+
+      /* Test if there is still cargo space */
+      if ((pilot_cargoFree(p) < 1) && (pilot_isPlayer(p)))
+         player_message( _("No more cargo space available") );
+   }
+   else if ((pilot_isPlayer(p)) && (noscoop_timer > 2.)) {
+      noscoop_timer = 0.;
+      player_message( _("Cannot gather material: no more cargo space available") );
+   }
+   return 0;
+}
+
+
 /**
  * @brief See if the pilot can gather anything
  *
@@ -400,41 +628,102 @@ void gatherable_render( void )
  */
 void gatherable_gather( int pilot )
 {
-   int i, q;
-   Gatherable *gat;
    Pilot* p;
 
+   if (gatherable_nstack == 0)
+      return;
+
    p = pilot_get( pilot );
+   if (p == NULL)
+      return;
 
-   for (i=0; i < gatherable_nstack; i++) {
-      gat = &gatherable_stack[i];
+   gatherable_query( p->solid->pos.x, p->solid->pos.y, 1. / GATHER_FACTOR,
+         gatherable_gatherOne, p );
+}
 
-      if (0.03*vect_dist( &p->solid->pos, &gat->pos ) +
-          0.03*vect_dist( &p->solid->vel, &gat->vel )  < 1. ) {
-         /* Add cargo to pilot. */
-         q = pilot_cargoAdd( p, gat->type, RNG(1,5), 0 );
-
-         if (q>0) {
-            if (pilot_isPlayer(p))
-               player_message( ngettext("%d ton of %s gathered", "%d tons of %s gathered", q), q, gat->type->name );
-
-            /* Remove the object from space. */
-            gatherable_nstack--;
-            memmove( &gatherable_stack[i], &gatherable_stack[i+1],
-                    sizeof(Gatherable)*(gatherable_nstack-i) );
-            gatherable_stack = realloc(gatherable_stack,
-                                       sizeof(Gatherable) * gatherable_nstack);
-
-            /* Test if there is still cargo space */
-            if ((pilot_cargoFree(p) < 1) && (pilot_isPlayer(p)))
-               player_message( _("No more cargo space available") );
-         }
-         else if ((pilot_isPlayer(p)) && (noscoop_timer > 2.)) {
-            noscoop_timer = 0.;
-            player_message( _("Cannot gather material: no more cargo space available") );
-         }
-      }
+
+/**
+ * @brief Search state for gatherable_getClosest().
+ */
+typedef struct GatherClosest_ {
+   Vector2d pos; /**< Position searched from. */
+   double dist; /**< Distance of the closest gatherable so far. */
+   int id; /**< Closest gatherable so far, -1 if none. */
+} GatherClosest;
+
+
+/**
+ * @brief Keeps the gatherable if it's the closest so far.
+ */
+static int gatherable_closestOne( int id, void *data )
+{
+   GatherClosest *c;
+   double d;
+
+   c = (GatherClosest*) data;
+   d = vect_dist( &c->pos, &gatherable_stack[id].pos );
+   if (d < c->dist) {
+      c->dist = d;
+      c->id   = id;
    }
+   return 0;
+}
+
+
+/**
+ * @brief Gets the closest gatherable from a given position, within a given radius.
+ *
+ *    @param pos Position to search from.
+ *    @param rad Radius to search within.
+ *    @return Id of the closest gatherable or -1 if there is none.
+ */
+int gatherable_getClosest( Vector2d pos, double rad )
+{
+   GatherClosest c;
+
+   c.pos  = pos;
+   c.dist = rad;
+   c.id   = -1;
+   gatherable_query( pos.x, pos.y, rad, gatherable_closestOne, &c );
+   if (c.id < 0)
+      return -1;
+   return gatherable_stack[ c.id ].id;
+}
+
+
+/**
+ * @brief Compare id (for use with bsearch)
+ */
+static int gatherable_compid( const void *id, const void *p )
+{
+   int a, b;
+   a = *((const int*)id);
+   b = ((const Gatherable*)p)->id;
+   return (a > b) - (a < b);
+}
+
+
+/**
+ * @brief Gets the position and velocity of a gatherable.
+ *
+ *    @param[out] pos Position of the gatherable.
+ *    @param[out] vel Velocity of the gatherable.
+ *    @param id Id of the gatherable.
+ *    @return 0 on success, -1 if it doesn't exist or was gathered.
+ */
+int gatherable_getPos( Vector2d *pos, Vector2d *vel, int id )
+{
+   Gatherable *gat;
+
+   /* binary search */
+   gat = bsearch( &id, gatherable_stack, gatherable_nstack,
+         sizeof(Gatherable), gatherable_compid );
+   if ((gat == NULL) || (gat->type == NULL))
+      return -1;
+
+   *pos = gat->pos;
+   *vel = gat->vel;
+   return 0;
 }
 
 
@@ -447,6 +736,7 @@ int commodity_load (void)
 {
    size_t bufsize;
    char *buf;
+   int i;
    xmlNodePtr node;
    xmlDocPtr doc;
 
@@ -499,6 +789,12 @@ int commodity_load (void)
    xmlFreeDoc(doc);
    free(buf);
 
+   /* Index the names, backwards so the first of duplicates wins like a scan. */
+   nhash_free( commodity_hash );
+   commodity_hash = nhash_create( commodity_nstack );
+   for (i=commodity_nstack-1; i>=0; i--)
+      nhash_set( commodity_hash, commodity_stack[i].name, i );
+
    DEBUG( ngettext( "Loaded %d Commodity", "Loaded %d Commodities", commodity_nstack ), commodity_nstack );
 
    return 0;
@@ -518,6 +814,8 @@ void commodity_free (void)
    free( commodity_stack );
    commodity_stack = NULL;
    commodity_nstack = 0;
+   nhash_free( commodity_hash );
+   commodity_hash = NULL;
 
    /* More clean up. */
    free( econ_comm );
@@ -649,8 +947,7 @@ static double econ_calcSysI( unsigned int dt, StarSystem *sys, int price )
  */
 static int econ_createGMatrix (void)
 {
-   int ret;
-   int i, j;
+   int i, j, k;
    double R, Rsum;
    cs *M;
    StarSystem *sys;
@@ -673,18 +970,27 @@ static int econ_createGMatrix (void)
          R     = 1./R; /* Must be inverted. */
          Rsum += R;
 
-         /* Matrix is symmetrical and non-diagonal is negative. */
-         ret = cs_entry( M, i, sys->jumps[j].target->id, -R );
-         if (ret != 1)
-            WARN(_("Unable to enter CSparse Matrix Cell."));
-         ret = cs_entry( M, sys->jumps[j].target->id, i, -R );
-         if (ret != 1)
+         /* Matrix is symmetrical and non-diagonal is negative. Each jump
+          * also adds to the other end's diagonal, so every row stays
+          * diagonally dominant even with one way jumps and the matrix is
+          * positive definite. */
+         k   = sys->jumps[j].target->id;
+         if ((cs_entry( M, i, k, -R ) != 1) ||
+               (cs_entry( M, k, i, -R ) != 1) ||
+               (cs_entry( M, k, k, R ) != 1)) {
             WARN(_("Unable to enter CSparse Matrix Cell."));
+            cs_spfree( M );
+            return -1;
+         }
       }
 
       /* Set the diagonal. */
       Rsum += 1./ECON_SELF_RES; /* We add a resistance for dampening. */
-      cs_entry( M, i, i, Rsum );
+      if (cs_entry( M, i, i, Rsum ) != 1) {
+         WARN(_("Unable to enter CSparse Matrix Cell."));
+         cs_spfree( M );
+         return -1;
+      }
    }
 
    /* Compress M matrix and put into G. */
@@ -693,14 +999,106 @@ static int econ_createGMatrix (void)
    econ_G = cs_compress( M );
    if (econ_G == NULL)
       ERR(_("Unable to create economy G Matrix."));
+   /* Sum the duplicate entries, the factorization doesn't. */
+   if (!cs_dupl( econ_G ))
+      ERR(_("Unable to create economy G Matrix."));
 
    /* Clean up. */
    cs_spfree(M);
 
+   /* Factorize once for all the updates until the universe changes. */
+   econ_factorize();
+
    return 0;
 }
 
 
+/**
+ * @brief Frees the stored factorization of the admittance matrix.
+ */
+static void econ_freeFactor (void)
+{
+   econ_N = cs_nfree( econ_N );
+   econ_S = cs_sfree( econ_S );
+}
+
+
+/**
+ * @brief Computes the Cholesky factorization of the admittance matrix.
+ *
+ * The symbolic analysis uses the AMD ordering of the matrix, jump graphs are
+ *  sparse enough that the factor stays close to the size of the matrix.
+ *
+ *    @return 0 on success.
+ */
+static int econ_factorize (void)
+{
+   econ_freeFactor();
+
+   econ_S = cs_schol( 1, econ_G );
+   if (econ_S != NULL)
+      econ_N = cs_chol( econ_G, econ_S );
+   if (econ_N == NULL) {
+      WARN(_("Unable to factorize economy G Matrix, falling back to QR."));
+      econ_freeFactor();
+      return -1;
+   }
+
+   return 0;
+}
+
+
+/**
+ * @brief Solves the economy system for a batch of intensity vectors.
+ *
+ *    @param[in,out] B Intensities of each price set one after another, each
+ *                     systems_nstack long. Overwritten with the solutions.
+ *    @param nrhs Number of price sets in B.
+ *    @return 0 on success.
+ */
+static int econ_solve( double *B, int nrhs )
+{
+   int i, j, n, ret;
+   double *b, *x;
+
+   n   = systems_nstack;
+   ret = 0;
+
+   /* No factor, solve each set on its own. */
+   if (econ_N == NULL) {
+      for (j=0; j<nrhs; j++)
+         if (cs_qrsol( 3, econ_G, &B[j*n] ) != 1)
+            ret = -1;
+      return ret;
+   }
+
+   x = malloc( sizeof(double) * n );
+   if (x == NULL) {
+      WARN(_("Out of Memory"));
+      return -1;
+   }
+
+   for (j=0; j<nrhs; j++) {
+      b = &B[j*n];
+
+      /* No intensity in any system means no potential either. */
+      for (i=0; i<n; i++)
+         if (b[i] != 0.)
+            break;
+      if (i >= n)
+         continue;
+
+      cs_ipvec( econ_S->pinv, b, x, n ); /* x = P*b */
+      cs_lsolve( econ_N->L, x ); /* x = L\x */
+      cs_ltsolve( econ_N->L, x ); /* x = L'\x */
+      cs_pvec( econ_S->pinv, x, b, n ); /* b = P'*x */
+   }
+
+   free( x );
+   return ret;
+}
+
+
 /**
  * @brief Initializes the economy.
  *
@@ -782,41 +1180,36 @@ int economy_refresh (void)
  */
 int economy_update( unsigned int dt )
 {
-   int ret;
    int i, j;
-   double *X;
+   double *X, *x;
    double scale, offset;
    /*double min, max;*/
 
    /* Economy must be initialized. */
-   if (econ_initialized == 0)
+   if ((econ_initialized == 0) || (econ_nprices == 0))
       return 0;
 
-   /* Create the vector to solve the system. */
-   X = malloc(sizeof(double)*systems_nstack);
+   /* Create the vectors to solve the system, one per price set. */
+   X = malloc(sizeof(double)*systems_nstack*econ_nprices);
    if (X == NULL) {
       WARN(_("Out of Memory"));
       return -1;
    }
 
-   /* Calculate the results for each price set. */
+   /* First we must load the vectors with intensities. */
    for (j=0; j<econ_nprices; j++) {
-
-      /* First we must load the vector with intensities. */
+      x = &X[j*systems_nstack];
       for (i=0; i<systems_nstack; i++)
-         X[i] = econ_calcSysI( dt, &systems_stack[i], j );
-
-      /* Solve the system. */
-      /** @TODO This should be improved to try to use better factorizations (LU/Cholesky)
-       * if possible or just outright try to use some other library that does fancy stuff
-       * like UMFPACK. Would be also interesting to see if it could be optimized so we
-       * store the factorization or update that instead of handling it individually. Another
-       * point of interest would be to split loops out to make the solving faster, however,
-       * this may be trickier to do (although it would surely let us use cholesky always if we
-       * enforce that condition). */
-      ret = cs_qrsol( 3, econ_G, X );
-      if (ret != 1)
-         WARN(_("Failed to solve the Economy System."));
+         x[i] = econ_calcSysI( dt, &systems_stack[i], j );
+   }
+
+   /* Solve all the price sets with the same factorization. */
+   if (econ_solve( X, econ_nprices ))
+      WARN(_("Failed to solve the Economy System."));
+
+   /* Calculate the results for each price set. */
+   for (j=0; j<econ_nprices; j++) {
+      x = &X[j*systems_nstack];
 
       /*
        * Get the minimum and maximum to scale.
@@ -825,10 +1218,10 @@ int economy_update( unsigned int dt )
       min = +HUGE_VALF;
       max = -HUGE_VALF;
       for (i=0; i<systems_nstack; i++) {
-         if (X[i] < min)
-            min = X[i];
-         if (X[i] > max)
-            max = X[i];
+         if (x[i] < min)
+            min = x[i];
+         if (x[i] > max)
+            max = x[i];
       }
       scale = 1. / (max - min);
       offset = 0.5 - min * scale;
@@ -842,7 +1235,7 @@ int economy_update( unsigned int dt )
       scale    = 1.;
       offset   = 1.;
       for (i=0; i<systems_nstack; i++)
-         systems_stack[i].prices[j] = X[i] * scale + offset;
+         systems_stack[i].prices[j] = x[i] * scale + offset;
    }
 
    /* Clean up. */
@@ -873,6 +1266,7 @@ void economy_destroy (void)
    }
 
    /* Destroy the economy matrix. */
+   econ_freeFactor();
    if (econ_G != NULL) {
       cs_spfree( econ_G );
       econ_G = NULL;
@@ -43,6 +43,7 @@ typedef struct Commodity_ {
  * @brief Represents stuff that can be gathered.
  */
 typedef struct Gatherable_ {
+   int id; /**< Unique id, increasing along the stack. */
    Commodity *type; /**< Type of commodity. */
    Vector2d pos; /**< Position. */
    Vector2d vel; /**< Velocity. */
@@ -79,6 +80,8 @@ void gatherable_render( void );
 void gatherable_free( void );
 void gatherable_update( double dt );
 void gatherable_gather( int pilot );
+int gatherable_getClosest( Vector2d pos, double rad );
+int gatherable_getPos( Vector2d *pos, Vector2d *vel, int id );
 
 
 /*
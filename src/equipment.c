@@ -35,6 +35,7 @@
 #include "map.h"
 #include "ndata.h"
 #include "tk/toolkit_priv.h" /* Yes, I'm a bad person, abstractions be damned! */
+#include "profile.h"
 
 
 /*
@@ -902,6 +903,7 @@ static void equipment_renderShip( double bx, double by,
       gl_vboActivateOffset( equipment_vbo, GL_VERTEX_ARRAY, 0, 2, GL_SHORT, 0 );
       gl_vboActivateOffset( equipment_vbo, GL_COLOR_ARRAY,
             sizeof(vertex), 4, GL_FLOAT, 0 );
+      profile_count( PROFILE_DRAWS, 1 );
       glDrawArrays( GL_LINES, 0, 4 );
       gl_vboDeactivate();
       glLineWidth( 1. );
@@ -2104,7 +2106,6 @@ static credits_t equipment_transportPrice( char* shipname )
    char *loc;
    Pilot* ship;
    credits_t price;
-   StarSystem **s;
    int jumps;
 
    ship = player_getShip(shipname);
@@ -2119,11 +2120,10 @@ static credits_t equipment_transportPrice( char* shipname )
       jumps = 200;
    else if ( strcmp( planet_getSystem( loc ), cur_system->name ) != 0 )
    {
-      s = map_getJumpPath( &jumps, cur_system->name, planet_getSystem( loc ), 1,
-         1, NULL );
-      if ( s == NULL )
+      jumps = map_getJumpDist( cur_system, system_get( planet_getSystem( loc ) ),
+         1, 1 );
+      if ( jumps == 0 )
          jumps = 50; /* Just consider a large number. */
-      free(s);
    }
    else /* Ship is in the same system and no jump path can be generated */
       jumps = 0;
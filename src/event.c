@@ -244,8 +244,7 @@ static unsigned int event_genID (void)
  */
 static int event_create( int dataid, unsigned int *id )
 {
-   size_t bufsize;
-   char *buf;
+   int ret;
    Event_t *ev;
    EventData_t *data;
 
@@ -280,20 +279,18 @@ static int event_create( int dataid, unsigned int *id )
       nlua_loadTut(ev->env);
 
    /* Load file. */
-   buf = ndata_read( data->lua, &bufsize );
-   if (buf == NULL) {
+   ret = nlua_dochunkenv(ev->env, data->lua);
+   if (ret == -2) {
       WARN(_("Event '%s' Lua script not found."), data->lua );
       return -1;
    }
-   if (nlua_dobufenv(ev->env, buf, bufsize, data->lua) != 0) {
+   if (ret != 0) {
       WARN(_("Error loading event file: %s\n"
             "%s\n"
             "Most likely Lua file has improper syntax, please check"),
             data->lua, lua_tostring(naevL,-1));
-      free(buf);
       return -1;
    }
-   free(buf);
 
    /* Run Lua. */
    if ((id==NULL) || (*id==0))
@@ -27,6 +27,7 @@
 #include "colour.h"
 #include "hook.h"
 #include "space.h"
+#include "nhash.h"
 
 
 #define XML_FACTION_ID     "Factions"   /**< XML section identifier */
@@ -86,6 +87,17 @@ typedef struct Faction_ {
 
 static Faction* faction_stack = NULL; /**< Faction stack. */
 int faction_nstack = 0; /**< Number of factions in the faction stack. */
+static NHash* faction_hash = NULL; /**< Faction name to ID. */
+
+/*
+ * Relation matrix, a bit per ordered pair of factions for each relation. It
+ * is kept symmetric and includes the player's standing based relations, so
+ * checking a relation never scans the ally and enemy lists.
+ */
+#define FACTION_GRID_ENEMIES  0 /**< Enemy bits. */
+#define FACTION_GRID_ALLIES   1 /**< Ally bits. */
+static uint32_t *faction_grid = NULL; /**< Enemy bits followed by ally bits. */
+static int faction_gridStride = 0; /**< Words per row of a relation. */
 
 
 /*
@@ -96,6 +108,13 @@ static void faction_sanitizePlayer( Faction* faction );
 static void faction_modPlayerLua( int f, double mod, const char *source, int secondary );
 static int faction_parse( Faction* temp, xmlNodePtr parent );
 static void faction_parseSocial( xmlNodePtr parent );
+/* relations */
+static void faction_gridSet( int rel, int a, int b, int value );
+static int faction_gridGet( int rel, int a, int b );
+static int faction_hasRelation( const int *list, int n, int o );
+static void faction_computePair( int a, int b );
+static void faction_computePlayer( int f );
+static void faction_computeGrid (void);
 /* externed */
 int pfaction_save( xmlTextWriterPtr writer );
 int pfaction_load( xmlNodePtr parent );
@@ -115,14 +134,9 @@ int faction_get( const char* name )
    if (strcmp(name, "Escort") == 0)
       return FACTION_PLAYER;
 
-   if (name != NULL) {
-      for (i=0; i<faction_nstack; i++)
-         if (strcmp(faction_stack[i].name, name)==0)
-            break;
-
-      if (i != faction_nstack)
-         return i;
-   }
+   i = nhash_get( faction_hash, name );
+   if (i >= 0)
+      return i;
 
    WARN(_("Faction '%s' not found in stack."), name);
    return -1;
@@ -367,7 +381,7 @@ int* faction_getEnemies( int f, int *n )
       enemies = malloc(sizeof(int)*faction_nstack);
 
       for (i=0; i<faction_nstack; i++)
-         if (faction_isPlayerEnemy(i))
+         if (faction_gridGet( FACTION_GRID_ENEMIES, FACTION_PLAYER, i ))
             enemies[nenemies++] = i;
 
       enemies = realloc(enemies, sizeof(int)*nenemies);
@@ -405,7 +419,7 @@ int* faction_getAllies( int f, int *n )
       allies = malloc(sizeof(int)*faction_nstack);
 
       for (i=0; i<faction_nstack; i++)
-         if (faction_isPlayerFriend(i))
+         if (faction_gridGet( FACTION_GRID_ALLIES, FACTION_PLAYER, i ))
             allies[nallies++] = i;
 
       allies = realloc(allies, sizeof(int)*nallies);
@@ -463,6 +477,8 @@ void faction_addEnemy( int f, int o)
    ff->nenemies++;
    ff->enemies = realloc(ff->enemies, sizeof(int)*ff->nenemies);
    ff->enemies[ff->nenemies-1] = o;
+
+   faction_computePair( f, o );
 }
 
 
@@ -491,6 +507,7 @@ void faction_rmEnemy( int f, int o)
          ff->enemies[i] = ff->enemies[ff->nenemies-1];
          ff->nenemies--;
          ff->enemies = realloc(ff->enemies, sizeof(int)*ff->nenemies);
+         faction_computePair( f, o );
          return;
       }
    }
@@ -540,6 +557,8 @@ void faction_addAlly( int f, int o)
    ff->nallies++;
    ff->allies = realloc(ff->allies, sizeof(int)*ff->nallies);
    ff->allies[ff->nallies-1] = o;
+
+   faction_computePair( f, o );
 }
 
 
@@ -568,6 +587,7 @@ void faction_rmAlly( int f, int o)
          ff->allies[i] = ff->allies[ff->nallies-1];
          ff->nallies--;
          ff->allies = realloc(ff->allies, sizeof(int)*ff->nallies);
+         faction_computePair( f, o );
          return;
       }
    }
@@ -662,6 +682,7 @@ static void faction_modPlayerLua( int f, double mod, const char *source, int sec
 
    /* Sanitize just in case. */
    faction_sanitizePlayer( faction );
+   faction_computePlayer( f );
 
    /* Run hook if necessary. */
    delta = faction->player - old;
@@ -765,6 +786,7 @@ void faction_modPlayerRaw( int f, double mod )
 
    /* Sanitize just in case. */
    faction_sanitizePlayer( faction );
+   faction_computePlayer( f );
 
    /* Tell space the faction changed. */
    space_factionChange();
@@ -801,6 +823,7 @@ void faction_setPlayer( int f, double value )
 
    /* Sanitize just in case. */
    faction_sanitizePlayer( faction );
+   faction_computePlayer( f );
 
    /* Tell space the faction changed. */
    space_factionChange();
@@ -1076,43 +1099,22 @@ const char *faction_getStandingBroad( int f, int bribed, int override )
  */
 int areEnemies( int a, int b)
 {
-   Faction *fa, *fb;
-   int i;
-
    if (a==b) return 0; /* luckily our factions aren't masochistic */
 
    /* handle a */
-   if (faction_isFaction(a))
-      fa = &faction_stack[a];
-   else { /* a is invalid */
+   if (!faction_isFaction(a)) { /* a is invalid */
       WARN(_("areEnemies: %d is an invalid faction"), a);
       return 0;
    }
 
    /* handle b */
-   if (faction_isFaction(b))
-      fb = &faction_stack[b];
-   else { /* b is invalid */
+   if (!faction_isFaction(b)) { /* b is invalid */
       WARN(_("areEnemies: %d is an invalid faction"), b);
       return 0;
    }
 
-   /* player handled separately */
-   if (a==FACTION_PLAYER) {
-      return faction_isPlayerEnemy(b);
-   }
-   else if (b==FACTION_PLAYER) {
-      return faction_isPlayerEnemy(a);
-   }
-
-   for (i=0;i<fa->nenemies;i++)
-      if (fa->enemies[i] == b)
-         return 1;
-   for (i=0;i<fb->nenemies;i++)
-      if(fb->enemies[i] == a)
-         return 1;
-
-   return 0;
+   /* The player's standing based enemies are in the matrix too. */
+   return faction_gridGet( FACTION_GRID_ENEMIES, a, b );
 }
 
 
@@ -1125,47 +1127,156 @@ int areEnemies( int a, int b)
  */
 int areAllies( int a, int b )
 {
-   Faction *fa, *fb;
-   int i;
-
    /* If they are the same they must be allies. */
    if (a==b) return 1;
 
    /* handle a */
-   if (faction_isFaction(a))
-      fa = &faction_stack[a];
-   else { /* a is invalid */
+   if (!faction_isFaction(a)) { /* a is invalid */
       WARN(_("%d is an invalid faction"), a);
       return 0;
    }
 
    /* handle b */
-   if (faction_isFaction(b))
-      fb = &faction_stack[b];
-   else { /* b is invalid */
+   if (!faction_isFaction(b)) { /* b is invalid */
       WARN(_("%d is an invalid faction"), b);
       return 0;
    }
 
-   /* we assume player becomes allies with high rating */
-   if (a==FACTION_PLAYER) {
-      return faction_isPlayerFriend(b);
-   }
-   else if (b==FACTION_PLAYER) {
-      return faction_isPlayerFriend(a);
-   }
+   /* we assume player becomes allies with high rating, that's in the matrix too */
+   return faction_gridGet( FACTION_GRID_ALLIES, a, b );
+}
+
+
+/**
+ * @brief Sets a bit of the relation matrix.
+ *
+ *    @param rel FACTION_GRID_ENEMIES or FACTION_GRID_ALLIES.
+ *    @param a Faction of the row.
+ *    @param b Faction of the column.
+ *    @param value Whether the relation holds.
+ */
+static void faction_gridSet( int rel, int a, int b, int value )
+{
+   uint32_t *w;
+
+   w = &faction_grid[ (rel*faction_nstack + a)*faction_gridStride + (b>>5) ];
+   if (value)
+      *w |= (1u << (b&31));
+   else
+      *w &= ~(1u << (b&31));
+}
 
-   for (i=0;i<fa->nallies;i++)
-      if (fa->allies[i] == b)
-         return 1;
-   for (i=0;i<fb->nallies;i++)
-      if(fb->allies[i] == a)
-         return 1;
 
+/**
+ * @brief Gets a bit of the relation matrix.
+ */
+static int faction_gridGet( int rel, int a, int b )
+{
+   return (faction_grid[ (rel*faction_nstack + a)*faction_gridStride + (b>>5) ] >> (b&31)) & 1;
+}
+
+
+/**
+ * @brief Checks to see if a faction is in an ally or enemy list.
+ */
+static int faction_hasRelation( const int *list, int n, int o )
+{
+   int i;
+   for (i=0; i<n; i++)
+      if (list[i] == o)
+         return 1;
    return 0;
 }
 
 
+/**
+ * @brief Recomputes the relations between two factions from their lists.
+ *
+ * Relations are mutual as soon as either side lists the other.
+ */
+static void faction_computePair( int a, int b )
+{
+   Faction *fa, *fb;
+   int r;
+
+   if ((faction_grid == NULL) || (a == b) ||
+         (a == FACTION_PLAYER) || (b == FACTION_PLAYER))
+      return;
+
+   fa = &faction_stack[a];
+   fb = &faction_stack[b];
+
+   r = faction_hasRelation( fa->enemies, fa->nenemies, b ) ||
+         faction_hasRelation( fb->enemies, fb->nenemies, a );
+   faction_gridSet( FACTION_GRID_ENEMIES, a, b, r );
+   faction_gridSet( FACTION_GRID_ENEMIES, b, a, r );
+
+   r = faction_hasRelation( fa->allies, fa->nallies, b ) ||
+         faction_hasRelation( fb->allies, fb->nallies, a );
+   faction_gridSet( FACTION_GRID_ALLIES, a, b, r );
+   faction_gridSet( FACTION_GRID_ALLIES, b, a, r );
+}
+
+
+/**
+ * @brief Recomputes the relations between the player and a faction.
+ *
+ * They depend on the standing thresholds of the faction's Lua, so this has
+ * to run whenever the player's standing with it changes.
+ */
+static void faction_computePlayer( int f )
+{
+   int r;
+
+   if ((faction_grid == NULL) || (f == FACTION_PLAYER))
+      return;
+
+   r = faction_isPlayerEnemy( f );
+   faction_gridSet( FACTION_GRID_ENEMIES, FACTION_PLAYER, f, r );
+   faction_gridSet( FACTION_GRID_ENEMIES, f, FACTION_PLAYER, r );
+
+   r = faction_isPlayerFriend( f );
+   faction_gridSet( FACTION_GRID_ALLIES, FACTION_PLAYER, f, r );
+   faction_gridSet( FACTION_GRID_ALLIES, f, FACTION_PLAYER, r );
+}
+
+
+/**
+ * @brief Rebuilds the whole relation matrix.
+ */
+static void faction_computeGrid (void)
+{
+   Faction *f;
+   int i, j;
+
+   free( faction_grid );
+   faction_gridStride = (faction_nstack + 31) / 32;
+   faction_grid = calloc( 2 * faction_nstack * faction_gridStride, sizeof(uint32_t) );
+
+   for (i=0; i<faction_nstack; i++) {
+      faction_gridSet( FACTION_GRID_ALLIES, i, i, 1 );
+      if (i == FACTION_PLAYER)
+         continue;
+
+      f = &faction_stack[i];
+      for (j=0; j<f->nenemies; j++) {
+         if (f->enemies[j] == FACTION_PLAYER)
+            continue;
+         faction_gridSet( FACTION_GRID_ENEMIES, i, f->enemies[j], 1 );
+         faction_gridSet( FACTION_GRID_ENEMIES, f->enemies[j], i, 1 );
+      }
+      for (j=0; j<f->nallies; j++) {
+         if (f->allies[j] == FACTION_PLAYER)
+            continue;
+         faction_gridSet( FACTION_GRID_ALLIES, i, f->allies[j], 1 );
+         faction_gridSet( FACTION_GRID_ALLIES, f->allies[j], i, 1 );
+      }
+
+      faction_computePlayer( i );
+   }
+}
+
+
 /**
  * @brief Checks whether or not a faction is valid.
  *
@@ -1427,8 +1538,10 @@ static void faction_parseSocial( xmlNodePtr parent )
 void factions_reset (void)
 {
    int i;
-   for (i=0; i<faction_nstack; i++)
+   for (i=0; i<faction_nstack; i++) {
       faction_stack[i].player = faction_stack[i].player_def;
+      faction_computePlayer( i );
+   }
 }
 
 
@@ -1439,7 +1552,7 @@ void factions_reset (void)
  */
 int factions_load (void)
 {
-   int mem;
+   int mem, id;
    size_t bufsize;
    char *buf = ndata_read( FACTION_DATA_PATH, &bufsize);
 
@@ -1487,6 +1600,12 @@ int factions_load (void)
    /* Shrink to minimum size. */
    faction_stack = realloc(faction_stack, sizeof(Faction)*faction_nstack);
 
+   /* Index the names, backwards so the first of duplicates wins like a scan. */
+   nhash_free( faction_hash );
+   faction_hash = nhash_create( faction_nstack );
+   for (id=faction_nstack-1; id>=0; id--)
+      nhash_set( faction_hash, faction_stack[id].name, id );
+
    /* Second pass - sets allies and enemies */
    node = factions;
    do {
@@ -1494,6 +1613,9 @@ int factions_load (void)
          faction_parseSocial(node);
    } while (xml_nextNode(node));
 
+   /* Relations are only ever checked in the matrix. */
+   faction_computeGrid();
+
 #ifdef DEBUGGING
    int i, j, k, r;
    Faction *f, *sf;
@@ -1573,6 +1695,10 @@ void factions_free (void)
    free(faction_stack);
    faction_stack = NULL;
    faction_nstack = 0;
+   nhash_free(faction_hash);
+   faction_hash = NULL;
+   free(faction_grid);
+   faction_grid = NULL;
 }
 
 
@@ -1639,8 +1765,10 @@ int pfaction_load( xmlNodePtr parent )
                      if (xml_isNode(sub,"standing")) {
 
                         /* Must not be static. */
-                        if (!faction_isFlag( &faction_stack[faction], FACTION_STATIC ))
+                        if (!faction_isFlag( &faction_stack[faction], FACTION_STATIC )) {
                            faction_stack[faction].player = xml_getFloat(sub);
+                           faction_computePlayer( faction );
+                        }
                         continue;
                      }
                      if (xml_isNode(sub,"known")) {
@@ -35,6 +35,7 @@
 #include "ndata.h"
 #include "nfile.h"
 #include "utf8.h"
+#include "profile.h"
 
 #define HASH_LUT_SIZE 512 /**< Size of glyph look up table. */
 #define MAX_ROWS 128 /**< Max number of rows per texture cache. */
@@ -832,6 +833,10 @@ int gl_printWidthRaw( const glFont *ft_font, const char *text )
    size_t i;
    uint32_t ch;
 
+   /* No fonts get loaded when running headless. */
+   if (avail_fonts == NULL)
+      return 0;
+
    if (ft_font == NULL)
       ft_font = &gl_defFont;
    glFontStash *stsh = gl_fontGetStash( ft_font );
@@ -1185,6 +1190,7 @@ static int gl_fontRenderGlyph( glFontStash* stsh, uint32_t ch, const glColour *c
    ind[5] = vbo_id + 2;
 
    /* Draw the element. */
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawElements( GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, ind );
 
    /* Translate matrix. */
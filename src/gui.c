@@ -58,6 +58,7 @@
 #include "nlua_tk.h"
 #include "gui_omsg.h"
 #include "nstring.h"
+#include "profile.h"
 
 
 #define XML_GUI_ID   "GUIs" /**< XML section identifier for GUI document. */
@@ -83,6 +84,29 @@ static double blink_planet    = 0.; /**< Timer on planet blinking on radar. */
 static gl_vbo *gui_vbo = NULL; /**< GUI VBO. */
 static GLsizei gui_vboColourOffset = 0; /**< Offset of colour pixels. */
 
+/* Radar batching, filled rectangles and lines are each drawn in one go. */
+#define GUI_BATCH_TRIS     0 /**< Batch of triangles. */
+#define GUI_BATCH_LINES    1 /**< Batch of line segments. */
+#define GUI_BATCH_TYPES    2 /**< Number of batches. */
+static gl_vbo *gui_batchVBO = NULL; /**< VBO the batches are drawn from. */
+static GLfloat *gui_batchVertex[GUI_BATCH_TYPES] = { NULL, NULL }; /**< Vertices of the batches. */
+static GLfloat *gui_batchColour[GUI_BATCH_TYPES] = { NULL, NULL }; /**< Colours of the batches. */
+static int gui_batchN[GUI_BATCH_TYPES] = { 0, 0 }; /**< Vertices in the batches. */
+static int gui_batchM[GUI_BATCH_TYPES] = { 0, 0 }; /**< Vertices there is memory for. */
+static int gui_batching = 0; /**< Whether the radar is being batched. */
+/**
+ * @brief Name printed over the markers once the batches are drawn.
+ */
+typedef struct GuiLabel_ {
+   double x; /**< X position. */
+   double y; /**< Y position. */
+   const glColour *c; /**< Colour. */
+   const char *str; /**< Text, must outlive the batch. */
+} GuiLabel;
+static GuiLabel *gui_batchLabel = NULL; /**< Labels of the batch. */
+static int gui_batchNLabel = 0; /**< Labels in the batch. */
+static int gui_batchMLabel = 0; /**< Labels there is memory for. */
+
 static int gui_getMessage     = 1; /**< Whether or not the player should receive messages. */
 
 /*
@@ -196,6 +220,12 @@ static void gui_planetBlink( int w, int h, int rc, int cx, int cy, GLfloat vr, R
 static const glColour* gui_getPilotColour( const Pilot* p );
 static void gui_renderInterference (void);
 static void gui_calcBorders (void);
+/* Radar batching. */
+static void gui_batchAdd( int type, const GLfloat *vertex, int n, const glColour *c, GLfloat a );
+static void gui_batchRect( double x, double y, double w, double h, const glColour *c );
+static void gui_batchStrip( const GLfloat *vertex, int n, const glColour *c, GLfloat a );
+static void gui_batchFlush (void);
+static void gui_batchPrint( double x, double y, const glColour *c, const char *str );
 /* Lua GUI. */
 static int gui_doFunc( const char* func );
 static int gui_prepFunc( const char* func );
@@ -309,8 +339,9 @@ void player_messageRaw( const char *str )
 {
    int i, p, l;
 
-   /* Must be receiving messages. */
-   if (!gui_getMessage)
+   /* Must be receiving messages, and have somewhere to put them (the GUI is
+    * never initialized when running headless). */
+   if (!gui_getMessage || (mesg_stack == NULL))
       return;
 
    /* Must be non-null. */
@@ -670,6 +701,7 @@ static void gui_renderBorder( double dt )
          gl_vboActivateOffset( gui_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
          gl_vboActivateOffset( gui_vbo, GL_COLOR_ARRAY,
                gui_vboColourOffset, 4, GL_FLOAT, 0 );
+         profile_count( PROFILE_DRAWS, 1 );
          glDrawArrays( GL_LINE_STRIP, 0, 5 );
       }
    }
@@ -715,6 +747,7 @@ static void gui_renderBorder( double dt )
          gl_vboActivateOffset( gui_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
          gl_vboActivateOffset( gui_vbo, GL_COLOR_ARRAY,
                gui_vboColourOffset, 4, GL_FLOAT, 0 );
+         profile_count( PROFILE_DRAWS, 1 );
          glDrawArrays( GL_LINE_STRIP, 0, 4 );
       }
    }
@@ -757,6 +790,7 @@ static void gui_renderBorder( double dt )
          gl_vboActivateOffset( gui_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
          gl_vboActivateOffset( gui_vbo, GL_COLOR_ARRAY,
                gui_vboColourOffset, 4, GL_FLOAT, 0 );
+         profile_count( PROFILE_DRAWS, 1 );
          glDrawArrays( GL_LINES, 0, 4 );
       }
    }
@@ -999,6 +1033,7 @@ void gui_radarRender( double x, double y )
    }
    else if (radar->shape==RADAR_CIRCLE)
       gl_matrixTranslate( x, y );
+   gui_batchBegin();
 
    /*
     * planets
@@ -1018,13 +1053,6 @@ void gui_radarRender( double x, double y )
    if (player.p->nav_hyperspace > -1)
       gui_renderJumpPoint( player.p->nav_hyperspace, radar->shape, radar->w, radar->h, radar->res, 0 );
 
-   /*
-    * weapons
-    */
-   weapon_minimap( radar->res, radar->w, radar->h,
-         radar->shape, 1.-interference_alpha );
-
-
    /* render the pilot_nstack */
    j = 0;
    for (i=1; i<pilot_nstack; i++) { /* skip the player */
@@ -1043,6 +1071,13 @@ void gui_radarRender( double x, double y )
       for (j=0; j<ast->nb; j++)
          gui_renderAsteroid( &ast->asteroids[j], radar->w, radar->h, radar->res, 0 );
    }
+   gui_batchEnd();
+
+   /*
+    * weapons, already drawn in a single batch
+    */
+   weapon_minimap( radar->res, radar->w, radar->h,
+         radar->shape, 1.-interference_alpha );
 
    /* Interference. */
    gui_renderInterference();
@@ -1260,12 +1295,12 @@ static const glColour* gui_getPilotColour( const Pilot* p )
    (shape==RADAR_CIRCLE && (((x)*(x)+(y)*(y)) < rc))
 void gui_renderPilot( const Pilot* p, RadarShape shape, double w, double h, double res, int overlay )
 {
-   int i, curs;
+   int curs;
    int x, y, sx, sy;
    double px, py;
    const glColour *col;
    glColour ccol;
-   GLfloat vertex[2*8], colours[4*8];
+   GLfloat vertex[2*8];
    GLfloat cx, cy;
    int rc;
 
@@ -1320,15 +1355,6 @@ void gui_renderPilot( const Pilot* p, RadarShape shape, double w, double h, doub
    /* Draw selection if targeted. */
    if (p->id == player.p->target) {
       if (blink_pilot < RADAR_BLINK_PILOT/2.) {
-         /* Set up colours. */
-         for (i=0; i<8; i++) {
-            colours[4*i + 0] = cRadar_tPilot.r;
-            colours[4*i + 1] = cRadar_tPilot.g;
-            colours[4*i + 2] = cRadar_tPilot.b;
-            colours[4*i + 3] = 1.-interference_alpha;
-         }
-         gl_vboSubData( gui_vbo, gui_vboColourOffset,
-               sizeof(GLfloat) * 8*4, colours );
          /* Set up vertex. */
          curs = 0;
          cx = x-sx;
@@ -1360,18 +1386,11 @@ void gui_renderPilot( const Pilot* p, RadarShape shape, double w, double h, doub
             vertex[curs++] = cx-3.3;
             vertex[curs++] = cy-3.3;
          }
-         gl_vboSubData( gui_vbo, 0, sizeof(GLfloat) * (curs/2)*2, vertex );
-         /* Draw tho VBO. */
-         gl_vboActivateOffset( gui_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
-         gl_vboActivateOffset( gui_vbo, GL_COLOR_ARRAY,
-               gui_vboColourOffset, 4, GL_FLOAT, 0 );
-         glDrawArrays( GL_LINES, 0, curs/2 );
+         gui_batchAdd( GUI_BATCH_LINES, vertex, curs/2,
+               &cRadar_tPilot, 1.-interference_alpha );
       }
    }
 
-   /* Deactivate VBO. */
-   gl_vboDeactivate();
-
    /* Draw square. */
    px     = MAX(x-sx,-w);
    py     = MAX(y-sy, -h);
@@ -1383,11 +1402,11 @@ void gui_renderPilot( const Pilot* p, RadarShape shape, double w, double h, doub
    ccol.g = col->g;
    ccol.b = col->b;
    ccol.a = 1.-interference_alpha;
-   gl_renderRect( px, py, MIN( 2*sx, w-px ), MIN( 2*sy, h-py ), &ccol );
+   gui_batchRect( px, py, MIN( 2*sx, w-px ), MIN( 2*sy, h-py ), &ccol );
 
    /* Draw name. */
    if (overlay && pilot_isFlag(p, PILOT_HILIGHT))
-      gl_printRaw( &gl_smallFont, x+2*sx+5., y-gl_smallFont.h/2., col, p->name );
+      gui_batchPrint( x+2*sx+5., y-gl_smallFont.h/2., col, p->name );
 }
 
 
@@ -1429,9 +1448,6 @@ void gui_renderAsteroid( const Asteroid* a, double w, double h, double res, int
       h *= 2.;
    }
 
-   /* Deactivate VBO. */
-   gl_vboDeactivate();
-
    /* Draw square. */
    px     = MAX(x-sx,-w);
    py     = MAX(y-sy, -h);
@@ -1441,7 +1457,7 @@ void gui_renderAsteroid( const Asteroid* a, double w, double h, double res, int
    ccol.g = col->g;
    ccol.b = col->b;
    ccol.a = 1.-interference_alpha;
-   gl_renderRect( px, py, MIN( 2*sx, w-px ), MIN( 2*sy, h-py ), &ccol );
+   gui_batchRect( px, py, MIN( 2*sx, w-px ), MIN( 2*sy, h-py ), &ccol );
 }
 
 
@@ -1509,8 +1525,8 @@ void gui_forceBlink (void)
 static void gui_planetBlink( int w, int h, int rc, int cx, int cy, GLfloat vr, RadarShape shape )
 {
    GLfloat vx, vy;
-   GLfloat vertex[8*2], colours[8*4];
-   int i, curs;
+   GLfloat vertex[8*2];
+   int curs;
 
    if (blink_planet < RADAR_BLINK_PLANET/2.) {
       curs = 0;
@@ -1543,25 +1559,9 @@ static void gui_planetBlink( int w, int h, int rc, int cx, int cy, GLfloat vr, R
          vertex[curs++] = vx-3.3;
          vertex[curs++] = vy-3.3;
       }
-      gl_vboSubData( gui_vbo, 0, sizeof(GLfloat) * (curs/2)*2, vertex );
-      /* Set the colours. */
-      for (i=0; i<curs/2; i++) {
-         colours[4*i + 0] = cRadar_tPlanet.r;
-         colours[4*i + 1] = cRadar_tPlanet.g;
-         colours[4*i + 2] = cRadar_tPlanet.b;
-         colours[4*i + 3] = 1.-interference_alpha;
-      }
-      gl_vboSubData( gui_vbo, gui_vboColourOffset,
-            sizeof(GLfloat) * (curs/2)*4, colours );
-      /* Draw tho VBO. */
-      gl_vboActivateOffset( gui_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
-      gl_vboActivateOffset( gui_vbo, GL_COLOR_ARRAY,
-            gui_vboColourOffset, 4, GL_FLOAT, 0 );
-      glDrawArrays( GL_LINES, 0, curs/2 );
+      gui_batchAdd( GUI_BATCH_LINES, vertex, curs/2,
+            &cRadar_tPlanet, 1.-interference_alpha );
    }
-
-   /* Deactivate the VBO. */
-   gl_vboDeactivate();
 }
 
 
@@ -1570,19 +1570,8 @@ static void gui_planetBlink( int w, int h, int rc, int cx, int cy, GLfloat vr, R
  */
 static void gui_renderRadarOutOfRange( RadarShape sh, int w, int h, int cx, int cy, const glColour *col )
 {
-   GLfloat vertex[2*2], colours[8*2];
+   GLfloat vertex[2*2];
    double a;
-   int i;
-
-   /* Set the colour. */
-   for (i=0; i<2; i++) {
-      colours[4*i + 0] = col->r;
-      colours[4*i + 1] = col->g;
-      colours[4*i + 2] = col->b;
-      colours[4*i + 3] = 1.-interference_alpha;
-   }
-   gl_vboSubData( gui_vbo, gui_vboColourOffset,
-         sizeof(GLfloat) * 2*4, colours );
 
    /* Draw a line like for pilots. */
    a = ANGLE(cx,cy);
@@ -1614,16 +1603,7 @@ static void gui_renderRadarOutOfRange( RadarShape sh, int w, int h, int cx, int
       vertex[2] = vertex[0] - 0.15*w*cos(a);
       vertex[3] = vertex[1] - 0.15*w*sin(a);
    }
-   /* Set the vertex. */
-   gl_vboSubData( gui_vbo, 0, sizeof(GLfloat) * 2*2, vertex );
-   /* Draw tho VBO. */
-   gl_vboActivateOffset( gui_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
-   gl_vboActivateOffset( gui_vbo, GL_COLOR_ARRAY,
-         gui_vboColourOffset, 4, GL_FLOAT, 0 );
-   glDrawArrays( GL_LINES, 0, 2 );
-
-   /* Deactivate the VBO. */
-   gl_vboDeactivate();
+   gui_batchAdd( GUI_BATCH_LINES, vertex, 2, col, 1.-interference_alpha );
 }
 
 
@@ -1634,14 +1614,13 @@ static void gui_renderRadarOutOfRange( RadarShape sh, int w, int h, int cx, int
  */
 void gui_renderPlanet( int ind, RadarShape shape, double w, double h, double res, int overlay )
 {
-   int i;
    int x, y;
    int cx, cy, r, rc;
    GLfloat vx, vy, vr;
    GLfloat a;
    const glColour *col;
    Planet *planet;
-   GLfloat vertex[5*2], colours[5*4];
+   GLfloat vertex[5*2];
 
    /* Make sure is known. */
    if ( !planet_isKnown( cur_system->planets[ind] ))
@@ -1702,14 +1681,6 @@ void gui_renderPlanet( int ind, RadarShape shape, double w, double h, double res
       a = 1.;
    else
       a   = 1.-interference_alpha;
-   for (i=0; i<5; i++) {
-      colours[4*i + 0] = col->r;
-      colours[4*i + 1] = col->g;
-      colours[4*i + 2] = col->b;
-      colours[4*i + 3] = a;
-   }
-   gl_vboSubData( gui_vbo, gui_vboColourOffset,
-      sizeof(GLfloat) * 5*4, colours );
    /* Now load the data. */
    vx = cx;
    vy = cy;
@@ -1723,19 +1694,11 @@ void gui_renderPlanet( int ind, RadarShape shape, double w, double h, double res
    vertex[7] = vy;
    vertex[8] = vertex[0];
    vertex[9] = vertex[1];
-   gl_vboSubData( gui_vbo, 0, sizeof(GLfloat) * 5*2, vertex );
-   /* Draw tho VBO. */
-   gl_vboActivateOffset( gui_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
-   gl_vboActivateOffset( gui_vbo, GL_COLOR_ARRAY,
-         gui_vboColourOffset, 4, GL_FLOAT, 0 );
-   glDrawArrays( GL_LINE_STRIP, 0, 5 );
-
-   /* Deactivate the VBO. */
-   gl_vboDeactivate();
+   gui_batchStrip( vertex, 5, col, a );
 
    /* Render name. */
    if (overlay)
-      gl_printRaw( &gl_smallFont, cx+vr+5., cy, col, planet->name );
+      gui_batchPrint( cx+vr+5., cy, col, planet->name );
 }
 
 
@@ -1746,13 +1709,12 @@ void gui_renderPlanet( int ind, RadarShape shape, double w, double h, double res
  */
 void gui_renderJumpPoint( int ind, RadarShape shape, double w, double h, double res, int overlay )
 {
-   int i;
    int cx, cy, x, y, r, rc;
    GLfloat a;
    GLfloat ca, sa;
    GLfloat vx, vy, vr;
    const glColour *col;
-   GLfloat vertex[4*2], colours[4*4];
+   GLfloat vertex[4*2];
    JumpPoint *jp;
 
    /* Default values. */
@@ -1819,15 +1781,6 @@ void gui_renderJumpPoint( int ind, RadarShape shape, double w, double h, double
    else
       a = 1.-interference_alpha;
 
-   /* Get the colour. */
-   for (i=0; i<4; i++) {
-      colours[4*i + 0] = col->r;
-      colours[4*i + 1] = col->g;
-      colours[4*i + 2] = col->b;
-      colours[4*i + 3] = a;
-   }
-   gl_vboSubData( gui_vbo, gui_vboColourOffset,
-      sizeof(GLfloat) * 5*4, colours );
    /* Now load the data. */
    vx = cx;
    vy = cy;
@@ -1842,23 +1795,209 @@ void gui_renderJumpPoint( int ind, RadarShape shape, double w, double h, double
    vertex[5] = vy + (2./3.*vr)*sa - vr*ca;
    vertex[6] = vertex[0];
    vertex[7] = vertex[1];
-   gl_vboSubData( gui_vbo, 0, sizeof(GLfloat) * 4*2, vertex );
-   /* Draw tho VBO. */
-   gl_vboActivateOffset( gui_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
-   gl_vboActivateOffset( gui_vbo, GL_COLOR_ARRAY,
-         gui_vboColourOffset, 4, GL_FLOAT, 0 );
-   glDrawArrays( GL_LINE_STRIP, 0, 4 );
-
-   /* Deactivate the VBO. */
-   gl_vboDeactivate();
+   gui_batchStrip( vertex, 4, col, a );
 
    /* Render name. */
    if (overlay)
-      gl_printRaw( &gl_smallFont, cx+vr+5., cy, col, sys_isKnown(jp->target) ? jp->target->name : _("Unknown") );
+      gui_batchPrint( cx+vr+5., cy, col, sys_isKnown(jp->target) ? jp->target->name : _("Unknown") );
 }
 #undef CHECK_PIXEL
 
 
+/**
+ * @brief Starts batching the radar.
+ *
+ * Until gui_batchEnd() is called, the radar markers are only gathered and
+ * then drawn with one call per primitive type instead of one per marker.
+ */
+void gui_batchBegin (void)
+{
+   gui_batching = 1;
+}
+
+
+/**
+ * @brief Draws the batched radar and stops batching.
+ */
+void gui_batchEnd (void)
+{
+   int i;
+   GuiLabel *l;
+
+   gui_batching = 0;
+   gui_batchFlush();
+
+   /* Names go over the markers. */
+   for (i=0; i<gui_batchNLabel; i++) {
+      l = &gui_batchLabel[i];
+      gl_printRaw( &gl_smallFont, l->x, l->y, l->c, l->str );
+   }
+   gui_batchNLabel = 0;
+}
+
+
+/**
+ * @brief Prints a marker name, after the markers when batching.
+ *
+ *    @param x X position.
+ *    @param y Y position.
+ *    @param c Colour.
+ *    @param str Text, must stay valid until gui_batchEnd().
+ */
+static void gui_batchPrint( double x, double y, const glColour *c, const char *str )
+{
+   GuiLabel *l;
+
+   if (!gui_batching) {
+      gl_printRaw( &gl_smallFont, x, y, c, str );
+      return;
+   }
+
+   if (gui_batchNLabel >= gui_batchMLabel) {
+      gui_batchMLabel = MAX( 32, 2*gui_batchMLabel );
+      gui_batchLabel  = realloc( gui_batchLabel, sizeof(GuiLabel) * gui_batchMLabel );
+   }
+   l      = &gui_batchLabel[ gui_batchNLabel++ ];
+   l->x   = x;
+   l->y   = y;
+   l->c   = c;
+   l->str = str;
+}
+
+
+/**
+ * @brief Adds vertices to a radar batch.
+ *
+ * Draws them right away when the radar isn't being batched.
+ *
+ *    @param type GUI_BATCH_TRIS or GUI_BATCH_LINES.
+ *    @param vertex Vertices to add, two coordinates each.
+ *    @param n Number of vertices.
+ *    @param c Colour of the vertices.
+ *    @param a Alpha of the vertices.
+ */
+static void gui_batchAdd( int type, const GLfloat *vertex, int n, const glColour *c, GLfloat a )
+{
+   GLfloat *col;
+   int i;
+
+   if (n <= 0)
+      return;
+
+   /* Grow memory. */
+   if (gui_batchN[type] + n > gui_batchM[type]) {
+      gui_batchM[type] = MAX( 2*gui_batchM[type], MAX( 256, gui_batchN[type] + n ) );
+      gui_batchVertex[type] = realloc( gui_batchVertex[type],
+            sizeof(GLfloat) * 2*gui_batchM[type] );
+      gui_batchColour[type] = realloc( gui_batchColour[type],
+            sizeof(GLfloat) * 4*gui_batchM[type] );
+   }
+
+   memcpy( &gui_batchVertex[type][ 2*gui_batchN[type] ], vertex, sizeof(GLfloat) * 2*n );
+   col = &gui_batchColour[type][ 4*gui_batchN[type] ];
+   for (i=0; i<n; i++) {
+      col[4*i + 0] = c->r;
+      col[4*i + 1] = c->g;
+      col[4*i + 2] = c->b;
+      col[4*i + 3] = a;
+   }
+   gui_batchN[type] += n;
+
+   if (!gui_batching)
+      gui_batchFlush();
+}
+
+
+/**
+ * @brief Adds a filled rectangle to the radar batch.
+ */
+static void gui_batchRect( double x, double y, double w, double h, const glColour *c )
+{
+   GLfloat vertex[6*2];
+
+   vertex[0]  = x;
+   vertex[1]  = y;
+   vertex[2]  = x + w;
+   vertex[3]  = y;
+   vertex[4]  = x;
+   vertex[5]  = y + h;
+   vertex[6]  = x + w;
+   vertex[7]  = y;
+   vertex[8]  = x + w;
+   vertex[9]  = y + h;
+   vertex[10] = x;
+   vertex[11] = y + h;
+   gui_batchAdd( GUI_BATCH_TRIS, vertex, 6, c, c->a );
+}
+
+
+/**
+ * @brief Adds a line strip to the radar batch as line segments.
+ *
+ *    @param vertex Vertices of the strip, at most 8.
+ *    @param n Number of vertices.
+ *    @param c Colour of the strip.
+ *    @param a Alpha of the strip.
+ */
+static void gui_batchStrip( const GLfloat *vertex, int n, const glColour *c, GLfloat a )
+{
+   GLfloat lines[2*2*7];
+   int i;
+
+   for (i=0; i<n-1; i++) {
+      lines[4*i + 0] = vertex[2*i + 0];
+      lines[4*i + 1] = vertex[2*i + 1];
+      lines[4*i + 2] = vertex[2*i + 2];
+      lines[4*i + 3] = vertex[2*i + 3];
+   }
+   gui_batchAdd( GUI_BATCH_LINES, lines, 2*(n-1), c, a );
+}
+
+
+/**
+ * @brief Draws everything in the radar batches and empties them.
+ */
+static void gui_batchFlush (void)
+{
+   int i, n, off;
+
+   n = gui_batchN[GUI_BATCH_TRIS] + gui_batchN[GUI_BATCH_LINES];
+   if (n == 0)
+      return;
+
+   /* Vertices of all the batches first, then their colours. */
+   if (gui_batchVBO == NULL)
+      gui_batchVBO = gl_vboCreateStream( sizeof(GLfloat) * n*(2+4), NULL );
+   else
+      gl_vboData( gui_batchVBO, sizeof(GLfloat) * n*(2+4), NULL );
+   off = 0;
+   for (i=0; i<GUI_BATCH_TYPES; i++) {
+      gl_vboSubData( gui_batchVBO, sizeof(GLfloat) * 2*off,
+            sizeof(GLfloat) * 2*gui_batchN[i], gui_batchVertex[i] );
+      gl_vboSubData( gui_batchVBO, sizeof(GLfloat) * (2*n + 4*off),
+            sizeof(GLfloat) * 4*gui_batchN[i], gui_batchColour[i] );
+      off += gui_batchN[i];
+   }
+
+   /* Draw the batches. */
+   gl_vboActivateOffset( gui_batchVBO, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
+   gl_vboActivateOffset( gui_batchVBO, GL_COLOR_ARRAY,
+         sizeof(GLfloat) * 2*n, 4, GL_FLOAT, 0 );
+   if (gui_batchN[GUI_BATCH_TRIS] > 0) {
+      profile_count( PROFILE_DRAWS, 1 );
+      glDrawArrays( GL_TRIANGLES, 0, gui_batchN[GUI_BATCH_TRIS] );
+   }
+   if (gui_batchN[GUI_BATCH_LINES] > 0) {
+      profile_count( PROFILE_DRAWS, 1 );
+      glDrawArrays( GL_LINES, gui_batchN[GUI_BATCH_TRIS], gui_batchN[GUI_BATCH_LINES] );
+   }
+   gl_vboDeactivate();
+
+   for (i=0; i<GUI_BATCH_TYPES; i++)
+      gui_batchN[i] = 0;
+}
+
+
 /**
  * @brief Sets the viewport.
  */
@@ -2332,6 +2471,8 @@ void gui_cleanup (void)
  */
 void gui_free (void)
 {
+   int i;
+
    /* Clean up gui. */
    gui_cleanup();
 
@@ -2347,6 +2488,24 @@ void gui_free (void)
       gui_vbo = NULL;
    }
 
+   /* Free the radar batches. */
+   if (gui_batchVBO != NULL) {
+      gl_vboDestroy( gui_batchVBO );
+      gui_batchVBO = NULL;
+   }
+   for (i=0; i<GUI_BATCH_TYPES; i++) {
+      free( gui_batchVertex[i] );
+      gui_batchVertex[i] = NULL;
+      free( gui_batchColour[i] );
+      gui_batchColour[i] = NULL;
+      gui_batchN[i] = 0;
+      gui_batchM[i] = 0;
+   }
+   free( gui_batchLabel );
+   gui_batchLabel  = NULL;
+   gui_batchNLabel = 0;
+   gui_batchMLabel = 0;
+
    /* Clean up the osd. */
    osd_exit();
 
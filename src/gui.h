@@ -78,6 +78,8 @@ void gui_renderJumpPoint( int ind, RadarShape shape, double w, double h, double
 void gui_renderPilot( const Pilot* p, RadarShape shape, double w, double h, double res, int overlay );
 void gui_renderAsteroid( const Asteroid* a, double w, double h, double res, int overlay );
 void gui_renderPlayer( double res, int overlay );
+void gui_batchBegin (void);
+void gui_batchEnd (void);
 
 
 /*
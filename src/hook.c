@@ -39,6 +39,7 @@
 #include "mission.h"
 #include "space.h"
 #include "menu.h"
+#include "nhash.h"
 
 
 #define HOOK_CHUNK   32 /**< Size to grow by when out of space */
@@ -48,12 +49,13 @@
  * @brief Hook queue to delay execution.
  */
 typedef struct HookQueue_s {
-   struct HookQueue_s *next; /**< Next in linked list. */
-   char *stack;         /**< Stack to run. */
-   unsigned int id;     /**< Run specific hook. */
-   HookParam hparam[ HOOK_MAX_PARAM ]; /**< Parameters. */
+   int stack;           /**< Stack to run. */
+   HookParam hparam[ HOOK_MAX_PARAM+1 ]; /**< Parameters and the sentinel. */
 } HookQueue_t;
-static HookQueue_t *hook_queue   = NULL; /**< The hook queue. */
+static HookQueue_t *hook_queue   = NULL; /**< Ring buffer of queued hooks. */
+static int hook_qhead            = 0; /**< First queued hook. */
+static int hook_nqueue           = 0; /**< Number of queued hooks. */
+static int hook_mqueue           = 0; /**< Memory allocated for the queue. */
 static int hook_atomic           = 0; /**< Whether or not hooks should be queued. */
 static ntime_t hook_time_accum   = 0; /**< Time accumulator. */
 
@@ -76,9 +78,12 @@ typedef enum HookType_e {
  */
 typedef struct Hook_ {
    struct Hook_ *next; /**< Linked list. */
+   struct Hook_ *snext; /**< Next hook of the same stack. */
+   struct Hook_ *sprev; /**< Previous hook of the same stack. */
 
    unsigned int id; /**< unique id */
-   char *stack; /**< stack it's a part of */
+   const char *stack; /**< stack it's a part of, interned in hook_stacks */
+   int stackid; /**< Index of the stack in hook_stacks. */
    int created; /**< Hook has just been created. */
    int delete; /**< indicates it should be deleted when possible */
    int ran_once; /**< Indicates if the hook already ran, useful when iterating. */
@@ -86,7 +91,8 @@ typedef struct Hook_ {
 
    /* Timer information. */
    int is_timer; /**< Whether or not is actually a timer. */
-   double ms; /**< Milliseconds left. */
+   double expire; /**< Value of hook_timer_clock at which it runs. */
+   int heap; /**< Position in hook_timers, -1 if not in it. */
 
    /* Date information. */
    int is_date; /**< Whether or not it is a date hook. */
@@ -107,6 +113,15 @@ typedef struct Hook_ {
 } Hook;
 
 
+/**
+ * @brief Hooks sharing a stack name.
+ */
+typedef struct HookStack_ {
+   char *name; /**< Name of the stack. */
+   Hook *list; /**< Hooks of the stack, newest first. */
+} HookStack;
+
+
 /*
  * the stack
  */
@@ -114,15 +129,37 @@ static unsigned int hook_id   = 0; /**< Unique hook id generator. */
 static Hook* hook_list        = NULL; /**< Stack of hooks. */
 static int hook_runningstack  = 0; /**< Check if stack is running. */
 static int hook_loadingstack  = 0; /**< Check if the hooks are being loaded. */
+static int hook_purge         = 0; /**< Whether hooks have been marked for deletion. */
+static HookStack *hook_stacks = NULL; /**< Hooks by stack. */
+static int hook_nstacks       = 0; /**< Number of stacks. */
+static NHash *hook_stackHash  = NULL; /**< Stack name to index in hook_stacks. */
+static Hook **hook_timers     = NULL; /**< Timer hooks as a min-heap on expire. */
+static int hook_ntimers       = 0; /**< Number of timer hooks in the heap. */
+static int hook_mtimers       = 0; /**< Memory allocated for the heap. */
+static double hook_timer_clock = 0.; /**< Time timers have been updated for. */
 
 
 /*
  * prototypes
  */
 /* Execution. */
-static int hooks_executeParam( const char* stack, HookParam *param );
+static int hooks_executeParam( int stack, HookParam *param );
 static void hooks_updateDateExecute( ntime_t change );
+/* Queue. */
+static void hq_add( const char *stack, HookParam *param );
+static void hq_clear (void);
+/* Stacks. */
+static int hook_stackGet( const char *stack, int create );
+static void hook_stackUnlink( Hook *h );
+/* Timers. */
+static int hook_timerLess( const Hook *a, const Hook *b );
+static void hook_timerSet( int i, Hook *h );
+static void hook_timerUp( int i );
+static void hook_timerDown( int i );
+static void hook_timerPush( Hook *h );
+static void hook_timerRemove( Hook *h );
 /* intern */
+static void hook_setDelete( Hook *h );
 static void hook_rmRaw( Hook *h );
 static void hooks_purgeList (void);
 static Hook* hook_get( unsigned int id );
@@ -143,33 +180,39 @@ static Mission *hook_getMission( Hook *hook );
 
 
 /**
- * Adds a hook to the queue.
+ * @brief Adds a hook to the queue.
+ *
+ *    @param stack Stack to run.
+ *    @param param Parameters to run it with, can be NULL.
  */
-static int hq_add( HookQueue_t *hq )
+static void hq_add( const char *stack, HookParam *param )
 {
-   HookQueue_t *c;
-
-   /* Set as head. */
-   if (hook_queue == NULL) {
-      hook_queue = hq;
-      return 0;
+   HookQueue_t *hq;
+   int i, n;
+
+   /* Grow, unwrapping the ring. */
+   if (hook_nqueue >= hook_mqueue) {
+      n           = hook_mqueue;
+      hook_mqueue = MAX( 2*hook_mqueue, HOOK_CHUNK );
+      hook_queue  = realloc( hook_queue, sizeof(HookQueue_t) * hook_mqueue );
+      /* The wrapped part goes after the rest, there's always room for it. */
+      for (i=0; i<hook_qhead; i++)
+         hook_queue[ n+i ] = hook_queue[i];
    }
 
-   /* Find tail. */
-   for (c=hook_queue; c->next != NULL; c=c->next);
-   c->next = hq;
-   return 0;
-}
-
-
-/**
- * @brief Frees a queued hook.
- */
-static void hq_free( HookQueue_t *hq )
-{
-   if (hq->stack != NULL)
-      free(hq->stack);
-   free(hq);
+   hq = &hook_queue[ (hook_qhead + hook_nqueue) % hook_mqueue ];
+   hq->stack = hook_stackGet( stack, 1 );
+   i = 0;
+   if (param != NULL) {
+      for (i=0; (i<HOOK_MAX_PARAM) && (param[i].type != HOOK_PARAM_SENTINEL); i++)
+         hq->hparam[i] = param[i];
+#ifdef DEBUGGING
+      if ((i >= HOOK_MAX_PARAM) && (param[i].type != HOOK_PARAM_SENTINEL))
+         WARN( _("HOOK_MAX_PARAM is set too low (%d)!"), HOOK_MAX_PARAM );
+#endif /* DEBUGGING */
+   }
+   hq->hparam[i].type = HOOK_PARAM_SENTINEL;
+   hook_nqueue++;
 }
 
 
@@ -178,12 +221,8 @@ static void hq_free( HookQueue_t *hq )
  */
 static void hq_clear (void)
 {
-   HookQueue_t *hq;
-   while (hook_queue != NULL) {
-      hq = hook_queue;
-      hook_queue = hq->next;
-      hq_free( hq );
-   }
+   hook_qhead  = 0;
+   hook_nqueue = 0;
 }
 
 
@@ -201,21 +240,19 @@ void hook_exclusionStart (void)
  */
 void hook_exclusionEnd( double dt )
 {
-   HookQueue_t *hq;
+   HookQueue_t hq;
    ntime_t temp;
    hook_atomic = 0;
 
    /* Handle hook queue. */
-   while (hook_queue != NULL) {
+   while (hook_nqueue > 0) {
       /* Move hook down. */
-      hq = hook_queue;
-      hook_queue = hq->next;
+      hq = hook_queue[ hook_qhead ];
+      hook_qhead = (hook_qhead+1) % hook_mqueue;
+      hook_nqueue--;
 
       /* Execute. */
-      hooks_executeParam( hq->stack, hq->hparam );
-
-      /* Clean up. */
-      hq_free( hq );
+      hooks_executeParam( hq.stack, hq.hparam );
    }
 
    /* Update timer hooks. */
@@ -309,7 +346,7 @@ static int hook_runMisn( Hook *hook, HookParam *param, int claims )
    /* Make sure it's valid. */
    if (hook->u.misn.parent == 0) {
       WARN(_("Trying to run hook with inexistant parent: deleting"));
-      hook->delete = 1; /* so we delete it */
+      hook_setDelete( hook ); /* so we delete it */
       return -1;
    }
 
@@ -317,7 +354,7 @@ static int hook_runMisn( Hook *hook, HookParam *param, int claims )
    misn = hook_getMission( hook );
    if (misn == NULL) {
       WARN(_("Trying to run hook with parent not in player mission stack: deleting"));
-      hook->delete = 1; /* so we delete it */
+      hook_setDelete( hook ); /* so we delete it */
       return -1;
    }
 
@@ -371,7 +408,7 @@ static int hook_runEvent( Hook *hook, HookParam *param, int claims )
    if (event_get(hook->u.event.parent) == NULL) {
       WARN(_("Hook [%s] '%d' -> '%s' failed, event does not exist. Deleting hook."), hook->stack,
             hook->id, hook->u.event.func);
-      hook->delete = 1; /* Set for deletion. */
+      hook_setDelete( hook ); /* Set for deletion. */
       return -1;
    }
 
@@ -425,7 +462,7 @@ static int hook_run( Hook *hook, HookParam *param, int claims )
 
       default:
          WARN(_("Invalid hook type '%d', deleting."), hook->type);
-         hook->delete = 1;
+         hook_setDelete( hook );
          return -1;
    }
 
@@ -457,6 +494,147 @@ static unsigned int hook_genID (void)
 }
 
 
+/**
+ * @brief Gets the index of a stack.
+ *
+ *    @param stack Name of the stack.
+ *    @param create Whether to create the stack if it doesn't exist.
+ *    @return Index of the stack in hook_stacks or -1 if it doesn't exist.
+ */
+static int hook_stackGet( const char *stack, int create )
+{
+   int i;
+
+   i = nhash_get( hook_stackHash, stack );
+   if ((i >= 0) || !create)
+      return i;
+
+   /* Stack names are kept for the rest of the session, there's only a handful. */
+   if (hook_stackHash == NULL)
+      hook_stackHash = nhash_create( HOOK_CHUNK );
+   if ((hook_nstacks % HOOK_CHUNK) == 0)
+      hook_stacks = realloc( hook_stacks, sizeof(HookStack) * (hook_nstacks+HOOK_CHUNK) );
+   i = hook_nstacks++;
+   hook_stacks[i].name = strdup( stack );
+   hook_stacks[i].list = NULL;
+   nhash_set( hook_stackHash, stack, i );
+   return i;
+}
+
+
+/**
+ * @brief Removes a hook from the list of its stack.
+ */
+static void hook_stackUnlink( Hook *h )
+{
+   if (h->sprev != NULL)
+      h->sprev->snext = h->snext;
+   else
+      hook_stacks[ h->stackid ].list = h->snext;
+   if (h->snext != NULL)
+      h->snext->sprev = h->sprev;
+   h->snext = NULL;
+   h->sprev = NULL;
+}
+
+
+/**
+ * @brief Orders timers by when they expire, then by id.
+ */
+static int hook_timerLess( const Hook *a, const Hook *b )
+{
+   if (a->expire != b->expire)
+      return (a->expire < b->expire);
+   return (a->id < b->id);
+}
+
+
+/**
+ * @brief Puts a timer at a position of the heap.
+ */
+static void hook_timerSet( int i, Hook *h )
+{
+   hook_timers[i] = h;
+   h->heap        = i;
+}
+
+
+/**
+ * @brief Moves a timer up the heap to its place.
+ */
+static void hook_timerUp( int i )
+{
+   Hook *h;
+   int p;
+
+   h = hook_timers[i];
+   while (i > 0) {
+      p = (i-1) / 2;
+      if (!hook_timerLess( h, hook_timers[p] ))
+         break;
+      hook_timerSet( i, hook_timers[p] );
+      i = p;
+   }
+   hook_timerSet( i, h );
+}
+
+
+/**
+ * @brief Moves a timer down the heap to its place.
+ */
+static void hook_timerDown( int i )
+{
+   Hook *h;
+   int c;
+
+   h = hook_timers[i];
+   for (c=2*i+1; c<hook_ntimers; c=2*i+1) {
+      if ((c+1 < hook_ntimers) && hook_timerLess( hook_timers[c+1], hook_timers[c] ))
+         c++;
+      if (!hook_timerLess( hook_timers[c], h ))
+         break;
+      hook_timerSet( i, hook_timers[c] );
+      i = c;
+   }
+   hook_timerSet( i, h );
+}
+
+
+/**
+ * @brief Adds a timer hook to the heap.
+ */
+static void hook_timerPush( Hook *h )
+{
+   if (hook_ntimers >= hook_mtimers) {
+      hook_mtimers = MAX( 2*hook_mtimers, HOOK_CHUNK );
+      hook_timers  = realloc( hook_timers, sizeof(Hook*) * hook_mtimers );
+   }
+   hook_timerSet( hook_ntimers++, h );
+   hook_timerUp( h->heap );
+}
+
+
+/**
+ * @brief Removes a timer hook from the heap.
+ */
+static void hook_timerRemove( Hook *h )
+{
+   int i;
+
+   i = h->heap;
+   if (i < 0)
+      return;
+   h->heap = -1;
+
+   hook_ntimers--;
+   if (i == hook_ntimers)
+      return;
+   hook_timerSet( i, hook_timers[ hook_ntimers ] );
+   hook_timerUp( i );
+   hook_timerDown( hook_timers[i]->heap );
+}
+
+
 /**
  * @brief Generates and allocates a new hook.
  *
@@ -466,6 +644,7 @@ static unsigned int hook_genID (void)
 static Hook* hook_new( HookType_t type, const char *stack )
 {
    Hook *new_hook;
+   HookStack *hs;
 
    /* Get and create new hook. */
    new_hook = calloc( 1, sizeof(Hook) );
@@ -477,11 +656,20 @@ static Hook* hook_new( HookType_t type, const char *stack )
       hook_list = new_hook;
    }
 
+   /* Also at the front of its stack. */
+   new_hook->stackid = hook_stackGet( stack, 1 );
+   hs = &hook_stacks[ new_hook->stackid ];
+   new_hook->snext = hs->list;
+   if (hs->list != NULL)
+      hs->list->sprev = new_hook;
+   hs->list = new_hook;
+
    /* Fill out generic details. */
    new_hook->type    = type;
    new_hook->id      = hook_genID();
-   new_hook->stack   = strdup(stack);
+   new_hook->stack   = hs->name;
    new_hook->created = 1;
+   new_hook->heap    = -1;
 
    /** @TODO fix this hack. */
    if (strcmp(stack,"safe")==0)
@@ -556,9 +744,10 @@ unsigned int hook_addTimerMisn( unsigned int parent, const char *func, double ms
    new_hook->u.misn.parent = parent;
    new_hook->u.misn.func   = strdup(func);
 
-   /* Timer information. */
+   /* Timer information, it counts from the next update. */
    new_hook->is_timer      = 1;
-   new_hook->ms            = ms;
+   new_hook->expire        = hook_timer_clock + ms;
+   hook_timerPush( new_hook );
 
    return new_hook->id;
 }
@@ -583,9 +772,10 @@ unsigned int hook_addTimerEvt( unsigned int parent, const char *func, double ms
    new_hook->u.event.parent = parent;
    new_hook->u.event.func   = strdup(func);
 
-   /* Timer information. */
+   /* Timer information, it counts from the next update. */
    new_hook->is_timer      = 1;
-   new_hook->ms            = ms;
+   new_hook->expire        = hook_timer_clock + ms;
+   hook_timerPush( new_hook );
 
    return new_hook->id;
 }
@@ -602,6 +792,11 @@ static void hooks_purgeList (void)
    if (hook_runningstack)
       return;
 
+   /* Nothing to delete. */
+   if (!hook_purge)
+      return;
+   hook_purge = 0;
+
    /* Second pass to delete. */
    hl = NULL;
    h  = hook_list;
@@ -646,21 +841,26 @@ void hooks_updateDate( ntime_t change )
  */
 static void hooks_updateDateExecute( ntime_t change )
 {
-   int j;
+   int j, s;
    Hook *h;
 
    /* Don't update without player. */
    if ((player.p == NULL) || player_isFlag(PLAYER_CREATING))
       return;
 
+   /* Date hooks all live in the "date" stack. */
+   s = hook_stackGet( "date", 0 );
+   if (s < 0)
+      return;
+
    /* Clear creation flags. */
-   for (h=hook_list; h!=NULL; h=h->next)
+   for (h=hook_stacks[s].list; h!=NULL; h=h->snext)
       h->created = 0;
 
    /* On j=0 we increment all timers and try to run, then on j=1 we update the timers. */
    hook_runningstack++; /* running hooks */
    for (j=1; j>=0; j--) {
-      for (h=hook_list; h!=NULL; h=h->next) {
+      for (h=hook_stacks[s].list; h!=NULL; h=h->snext) {
          /* Find valid date hooks. */
          if (h->is_date == 0)
             continue;
@@ -732,37 +932,48 @@ unsigned int hook_addDateEvt( unsigned int parent, const char *func, ntime_t res
 
 /**
  * @brief Updates all the hook timer related stuff.
+ *
+ * Only the timers that expire are touched. Timers created while running them
+ *  start counting on the next update.
  */
 void hooks_update( double dt )
 {
-   int j;
-   Hook *h;
+   int i, j, n, m;
+   double prev;
+   Hook *h, **expired;
 
    /* Don't update without player. */
    if ((player.p == NULL) || player_isFlag(PLAYER_CREATING))
       return;
 
-   /* Clear creation flags. */
-   for (h=hook_list; h!=NULL; h=h->next)
-      h->created = 0;
+   prev = hook_timer_clock;
+   hook_timer_clock += dt;
+
+   /* Take out the expired timers before running any. */
+   n        = 0;
+   m        = 0;
+   expired  = NULL;
+   while ((hook_ntimers > 0) && (hook_timers[0]->expire <= hook_timer_clock)) {
+      h = hook_timers[0];
+      hook_timerRemove( h );
+      if (h->delete)
+         continue;
+      if (n >= m) {
+         m        = MAX( 2*m, HOOK_CHUNK );
+         expired  = realloc( expired, sizeof(Hook*) * m );
+      }
+      expired[n++] = h;
+   }
 
    hook_runningstack++; /* running hooks */
    for (j=1; j>=0; j--) {
-      for (h=hook_list; h!=NULL; h=h->next) {
+      for (i=0; i<n; i++) {
+         h = expired[i];
          /* Not be deleting. */
          if (h->delete)
             continue;
-         /* Find valid timer hooks. */
-         if (h->is_timer == 0)
-            continue;
-         /* Don't update newly created hooks. */
-         if (h->created != 0)
-            continue;
-
-         /* Decrement timer and check to see if should run. */
-         if (j==0)
-            h->ms -= dt;
-         if (h->ms > 0.)
+         /* Claimed pass is for timers that had already expired before this update. */
+         if ((j==1) && (h->expire > prev))
             continue;
 
          /* Run the timer hook. */
@@ -771,6 +982,7 @@ void hooks_update( double dt )
       }
    }
    hook_runningstack--; /* not running hooks anymore */
+   free( expired );
 
    /* Second pass to delete. */
    hooks_purgeList();
@@ -813,11 +1025,21 @@ void hook_rm( unsigned int id )
  */
 static void hook_rmRaw( Hook *h )
 {
-   h->delete = 1;
+   hook_setDelete( h );
    hookL_unsetarg( h->id );
 }
 
 
+/**
+ * @brief Marks a hook for deletion.
+ */
+static void hook_setDelete( Hook *h )
+{
+   h->delete   = 1;
+   hook_purge  = 1;
+}
+
+
 /**
  * @brief Removes all hooks belonging to parent mission.
  *
@@ -829,7 +1051,7 @@ void hook_rmMisnParent( unsigned int parent )
 
    for (h=hook_list; h!=NULL; h=h->next)
       if ((h->type==HOOK_TYPE_MISN) && (parent == h->u.misn.parent))
-         h->delete = 1;
+         hook_setDelete( h );
 }
 
 
@@ -844,7 +1066,7 @@ void hook_rmEventParent( unsigned int parent )
 
    for (h=hook_list; h!=NULL; h=h->next)
       if ((h->type==HOOK_TYPE_EVENT) && (parent == h->u.event.parent))
-         h->delete = 1;
+         hook_setDelete( h );
 }
 
 
@@ -889,7 +1111,14 @@ int hook_hasEventParent( unsigned int parent )
 
 
 
-static int hooks_executeParam( const char* stack, HookParam *param )
+/**
+ * @brief Runs all the hooks of a stack.
+ *
+ *    @param stack Index of the stack to run.
+ *    @param param Parameters to pass.
+ *    @return Number of hooks run.
+ */
+static int hooks_executeParam( int stack, HookParam *param )
 {
    int j;
    int run;
@@ -900,16 +1129,15 @@ static int hooks_executeParam( const char* stack, HookParam *param )
       return 0;
 
    /* Reset the current stack's ran and creation flags. */
-   for (h=hook_list; h!=NULL; h=h->next)
-      if (strcmp(stack, h->stack)==0) {
-         h->ran_once = 0;
-         h->created = 0;
-      }
+   for (h=hook_stacks[stack].list; h!=NULL; h=h->snext) {
+      h->ran_once = 0;
+      h->created = 0;
+   }
 
    run = 0;
    hook_runningstack++; /* running hooks */
    for (j=1; j>=0; j--) {
-      for (h=hook_list; h!=NULL; h=h->next) {
+      for (h=hook_stacks[stack].list; h!=NULL; h=h->snext) {
          /* Should be deleted. */
          if (h->delete)
             continue;
@@ -919,9 +1147,6 @@ static int hooks_executeParam( const char* stack, HookParam *param )
          /* Don't update newly created hooks. */
          if (h->created != 0)
             continue;
-         /* Doesn't match stack. */
-         if (strcmp(stack, h->stack) != 0)
-            continue;
 
          /* Run hook. */
          hook_run( h, param, j );
@@ -946,8 +1171,7 @@ static int hooks_executeParam( const char* stack, HookParam *param )
  */
 int hooks_runParam( const char* stack, HookParam *param )
 {
-   int i;
-   HookQueue_t *hq;
+   int s;
 
    /* Don't update if player is dead. */
    if ((player.p == NULL) || player_isFlag(PLAYER_DESTROYED))
@@ -955,21 +1179,17 @@ int hooks_runParam( const char* stack, HookParam *param )
 
    /* Not time to run hooks, so queue them. */
    if (hook_atomic) {
-      hq = calloc( 1, sizeof(HookQueue_t) );
-      hq->stack = strdup(stack);
-      for (i=0; param[i].type != HOOK_PARAM_SENTINEL; i++)
-         hq->hparam[i] = param[i];
-#ifdef DEBUGGING
-      if (i >= HOOK_MAX_PARAM)
-         WARN( _("HOOK_MAX_PARAM is set too low (%d), need at least %d!"), HOOK_MAX_PARAM, i );
-#endif /* DEBUGGING */
-      hq->hparam[i].type = HOOK_PARAM_SENTINEL;
-      hq_add( hq );
+      hq_add( stack, param );
       return 0;
    }
 
+   /* No hook was ever added to the stack. */
+   s = hook_stackGet( stack, 0 );
+   if (s < 0)
+      return 0;
+
    /* Execute. */
-   return hooks_executeParam( stack, param );
+   return hooks_executeParam( s, param );
 }
 
 
@@ -1078,9 +1298,9 @@ static void hook_free( Hook *h )
    /* Remove from all the pilots. */
    pilots_rmHook( h->id );
 
-   /* Generic freeing. */
-   if (h->stack != NULL)
-      free(h->stack);
+   /* Remove from the indexes. */
+   hook_stackUnlink( h );
+   hook_timerRemove( h );
 
    /* Free type specific. */
    switch (h->type) {
@@ -1123,6 +1343,21 @@ void hook_cleanup (void)
    }
    /* sane defaults just in case */
    hook_list  = NULL;
+   hook_purge = 0;
+   hook_timer_clock = 0.;
+
+   /* Free the timer heap, freeing the hooks emptied it. */
+   free( hook_timers );
+   hook_timers  = NULL;
+   hook_ntimers = 0;
+   hook_mtimers = 0;
+
+   /* Free the queue. */
+   free( hook_queue );
+   hook_queue  = NULL;
+   hook_qhead  = 0;
+   hook_nqueue = 0;
+   hook_mqueue = 0;
 }
 
 
@@ -32,6 +32,7 @@
 #include "camera.h"
 #include "map_overlay.h"
 #include "hook.h"
+#include "profile.h"
 
 
 #define MOUSE_HIDE   ( 3.) /**< Time in seconds to wait before hiding mouse again. */
@@ -120,6 +121,7 @@ const char *keybind_info[][3] = {
    { "menu", gettext_noop("Small Menu"), gettext_noop("Opens the small in-game menu.") },
    { "info", gettext_noop("Information Menu"), gettext_noop("Opens the information menu.") },
    { "console", gettext_noop("Lua Console"), gettext_noop("Opens the Lua console.") },
+   { "profiler", gettext_noop("Toggle Profiler"), gettext_noop("Toggles the frame profiler overlay.") },
    { "switchtab1", gettext_noop("Switch Tab 1"), gettext_noop("Switches to tab 1.") },
    { "switchtab2", gettext_noop("Switch Tab 2"), gettext_noop("Switches to tab 2.") },
    { "switchtab3", gettext_noop("Switch Tab 3"), gettext_noop("Switches to tab 3.") },
@@ -283,6 +285,7 @@ void input_setDefault ( int wasd )
    input_setKeybind( "menu", KEYBIND_KEYBOARD, SDLK_ESCAPE, NMOD_ALL );
    input_setKeybind( "info", KEYBIND_KEYBOARD, SDLK_i, NMOD_NONE );
    input_setKeybind( "console", KEYBIND_KEYBOARD, SDLK_F2, NMOD_ALL );
+   input_setKeybind( "profiler", KEYBIND_KEYBOARD, SDLK_F12, NMOD_ALL );
    input_setKeybind( "switchtab1", KEYBIND_KEYBOARD, SDLK_1, NMOD_ALT );
    input_setKeybind( "switchtab2", KEYBIND_KEYBOARD, SDLK_2, NMOD_ALT );
    input_setKeybind( "switchtab3", KEYBIND_KEYBOARD, SDLK_3, NMOD_ALT );
@@ -1039,6 +1042,10 @@ static void input_key( int keynum, double value, double kabs, int repeat )
    /* Opens the Lua console. */
    } else if (KEY("console") && NODEAD() && !repeat) {
       if (value==KEY_PRESS) cli_open();
+
+   /* Toggles the profiler. */
+   } else if (KEY("profiler") && !repeat) {
+      if (value==KEY_PRESS) profile_toggle();
    }
 
    /* Key press not used. */
@@ -1095,7 +1095,7 @@ void land( Planet* p, int load )
 
    /* Load stuff */
    land_planet = p;
-   gfx_exterior = gl_newImage( p->gfx_exterior, 0 );
+   gfx_exterior = gl_newImageAsync( p->gfx_exterior, 0 );
 
    /* Generate the news. */
    if (planet_hasService(land_planet, PLANET_SERVICE_BAR))
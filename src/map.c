@@ -27,16 +27,13 @@
 #include "mapData.h"
 #include "nstring.h"
 #include "nmath.h"
+#include "profile.h"
 
 
 #define BUTTON_WIDTH    80 /**< Map button width. */
 #define BUTTON_HEIGHT   30 /**< Map button height. */
 
 
-#define MAP_LOOP_PROT   1000 /**< Number of iterations max in pathfinding before
-                                 aborting. */
-
-
 static double map_zoom        = 1.; /**< Zoom of the map. */
 static double map_xpos        = 0.; /**< Map X position. */
 static double map_ypos        = 0.; /**< Map Y position. */
@@ -50,6 +47,18 @@ glTexture *gl_map_circle      = NULL; /**< Texture of the circle used for system
 /* VBO. */
 static gl_vbo *map_vbo = NULL; /**< Map VBO. */
 
+/**
+ * @brief Jumps between systems, one row per source.
+ */
+typedef struct JumpDist_ {
+   short *dist; /**< Jumps from each source to each system, -1 if unreachable. */
+   unsigned int *gen; /**< Generation each row was computed at, 0 if never. */
+} JumpDist;
+static JumpDist map_jdist[4]; /**< Tables by ignore_known and show_hidden. */
+static int map_jdistN         = 0; /**< Systems the tables were made for. */
+static unsigned int map_jdistGenKnown = 1; /**< Changes with jumps and what is known. */
+static unsigned int map_jdistGenAll = 1; /**< Changes with jumps. */
+
 
 /*
  * extern
@@ -79,6 +88,9 @@ static glTexture *gl_genFactionDisk( int radius );
 static int map_keyHandler( unsigned int wid, SDLKey key, SDLMod mod );
 static void map_buttonZoom( unsigned int wid, char* str );
 static void map_selectCur (void);
+/* Pathfinding. */
+static void map_jumpDistFree (void);
+static void A_free (void);
 
 
 /**
@@ -112,6 +124,10 @@ void map_exit (void)
 
    if (gl_map_circle != NULL)
       gl_freeTexture( gl_map_circle );
+
+   /* Pathfinding memory. */
+   map_jumpDistFree();
+   A_free();
 }
 
 
@@ -623,6 +639,7 @@ static void map_drawMarker( double x, double y, double r, double a,
    gl_vboActivateOffset( map_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
    gl_vboActivateOffset( map_vbo, GL_COLOR_ARRAY,
          sizeof(GLfloat) * 2*3, 4, GL_FLOAT, 0 );
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_TRIANGLES, 0, 3 );
    gl_vboDeactivate();
    glDisable(GL_POLYGON_SMOOTH);
@@ -885,6 +902,7 @@ void map_renderJumps( double x, double y, int editor)
          vertex[16] = cole->b;
          vertex[17] = 0.2;
          gl_vboSubData( map_vbo, 0, sizeof(GLfloat) * 3*(2+4), vertex );
+         profile_count( PROFILE_DRAWS, 1 );
          glDrawArrays( GL_LINE_STRIP, 0, 3 );
       }
       gl_vboDeactivate();
@@ -1011,6 +1029,7 @@ static void map_renderPath( double x, double y, double a )
          gl_vboActivateOffset( map_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
          gl_vboActivateOffset( map_vbo, GL_COLOR_ARRAY,
                sizeof(GLfloat) * 2*3, 4, GL_FLOAT, 0 );
+         profile_count( PROFILE_DRAWS, 1 );
          glDrawArrays( GL_LINE_STRIP, 0, 3 );
          gl_vboDeactivate();
 
@@ -1464,133 +1483,209 @@ void map_select( StarSystem *sys, char shifted )
  * in reality just Djikstras. I've removed the heurestic bit to make sure I
  * don't try to implement an admissible heuristic when I'm pretty sure there is
  * none.
+ *
+ * Nodes live in an arena indexed by StarSystem->id that is reused between
+ * searches, a stamp tells which of them belong to the current search so
+ * nothing has to be cleared or allocated. The open set is a binary heap that
+ * knows where every system is in it, so improving a node is O(log n).
  */
 /**
  * @brief Node structure for A* pathfinding.
  */
 typedef struct SysNode_ {
-   struct SysNode_ *next; /**< Next node */
-   struct SysNode_ *gnext; /**< Next node in the garbage collector. */
-
-   struct SysNode_ *parent; /**< Parent node. */
-   StarSystem* sys; /**< System in node. */
+   int parent; /**< Id of the parent system, -1 for the start. */
    int g; /**< step */
+   unsigned int seq; /**< When the node was opened, ties go to the oldest. */
+   unsigned int stamp; /**< Search the node belongs to. */
+   int heap; /**< Position in the open heap, -1 when closed. */
 } SysNode; /**< System Node for use in A* pathfinding. */
-static SysNode *A_gc;
+static SysNode *A_nodes    = NULL; /**< Node of every system. */
+static int *A_heap         = NULL; /**< Open systems, heap ordered. */
+static int A_nheap         = 0; /**< Open systems. */
+static int A_mnodes        = 0; /**< Systems the arena has room for. */
+static unsigned int A_stamp = 0; /**< Current search. */
+static unsigned int A_seq  = 0; /**< Nodes opened in the current search. */
 /* prototypes */
-static SysNode* A_newNode( StarSystem* sys );
-static int A_g( SysNode* n );
-static SysNode* A_add( SysNode *first, SysNode *cur );
-static SysNode* A_rm( SysNode *first, StarSystem *cur );
-static SysNode* A_in( SysNode *first, StarSystem *cur );
-static SysNode* A_lowest( SysNode *first );
-static void A_freeList( SysNode *first );
-/** @brief Creates a new node link to star system. */
-static SysNode* A_newNode( StarSystem* sys )
+static void A_reset (void);
+static SysNode* A_get( int id );
+static int A_less( int a, int b );
+static void A_swap( int i, int j );
+static void A_up( int i );
+static void A_down( int i );
+static void A_push( int id, int g, int parent );
+static int A_pop (void);
+static int A_canJump( JumpPoint *jp, int ignore_known, int show_hidden );
+static void A_search( StarSystem *ssys, StarSystem *esys,
+      int ignore_known, int show_hidden );
+/** @brief Starts a new search. */
+static void A_reset (void)
 {
-   SysNode* n;
-
-   n        = malloc(sizeof(SysNode));
-
-   n->next  = NULL;
-   n->sys   = sys;
+   int i;
 
-   n->gnext = A_gc;
-   A_gc     = n;
+   if (systems_nstack > A_mnodes) {
+      A_mnodes = systems_nstack;
+      A_nodes  = realloc( A_nodes, sizeof(SysNode) * A_mnodes );
+      A_heap   = realloc( A_heap, sizeof(int) * A_mnodes );
+      for (i=0; i<A_mnodes; i++)
+         A_nodes[i].stamp = 0;
+      A_stamp  = 0;
+   }
 
-   return n;
+   /* Stamp wrapped around, old nodes could look current. */
+   if (++A_stamp == 0) {
+      for (i=0; i<A_mnodes; i++)
+         A_nodes[i].stamp = 0;
+      A_stamp = 1;
+   }
+   A_seq   = 0;
+   A_nheap = 0;
 }
-/** @brief Gets the g from a node. */
-static int A_g( SysNode* n )
+/** @brief Frees the arena. */
+static void A_free (void)
 {
-   return n->g;
+   free( A_nodes );
+   free( A_heap );
+   A_nodes  = NULL;
+   A_heap   = NULL;
+   A_mnodes = 0;
+   A_nheap  = 0;
 }
-/** @brief Adds a node to the linked list. */
-static SysNode* A_add( SysNode *first, SysNode *cur )
+/** @brief Gets the node of a system if it was reached in this search. */
+static SysNode* A_get( int id )
 {
-   SysNode *n;
-
-   if (first == NULL)
-      return cur;
-
-   n = first;
-   while (n->next != NULL)
-      n = n->next;
-   n->next = cur;
-
-   return first;
+   if (A_nodes[id].stamp != A_stamp)
+      return NULL;
+   return &A_nodes[id];
 }
-/* @brief Removes a node from a linked list. */
-static SysNode* A_rm( SysNode *first, StarSystem *cur )
+/** @brief Checks to see if a heap entry ranks before another. */
+static int A_less( int a, int b )
 {
-   SysNode *n, *p;
-
-   if (first->sys == cur) {
-      n = first->next;
-      first->next = NULL;
-      return n;
+   SysNode *na, *nb;
+   na = &A_nodes[ A_heap[a] ];
+   nb = &A_nodes[ A_heap[b] ];
+   if (na->g != nb->g)
+      return (na->g < nb->g);
+   return (na->seq < nb->seq);
+}
+/** @brief Swaps two heap entries. */
+static void A_swap( int i, int j )
+{
+   int t;
+   t         = A_heap[i];
+   A_heap[i] = A_heap[j];
+   A_heap[j] = t;
+   A_nodes[ A_heap[i] ].heap = i;
+   A_nodes[ A_heap[j] ].heap = j;
+}
+/** @brief Moves a heap entry up to its place. */
+static void A_up( int i )
+{
+   while ((i > 0) && A_less( i, (i-1)/2 )) {
+      A_swap( i, (i-1)/2 );
+      i = (i-1)/2;
    }
-
-   p = first;
-   n = p->next;
-   do {
-      if (n->sys == cur) {
-         n->next = NULL;
-         p->next = n->next;
+}
+/** @brief Moves a heap entry down to its place. */
+static void A_down( int i )
+{
+   int c;
+   while ((c = 2*i+1) < A_nheap) {
+      if ((c+1 < A_nheap) && A_less( c+1, c ))
+         c++;
+      if (!A_less( c, i ))
          break;
-      }
-      p = n;
-   } while ((n=n->next) != NULL);
-
-   return first;
+      A_swap( i, c );
+      i = c;
+   }
 }
-/** @brief Checks to see if node is in linked list. */
-static SysNode* A_in( SysNode *first, StarSystem *cur )
+/** @brief Opens a system or improves its open node. */
+static void A_push( int id, int g, int parent )
 {
    SysNode *n;
 
-   if (first == NULL)
-      return NULL;
+   n = &A_nodes[id];
+   if (n->stamp != A_stamp) {
+      n->stamp = A_stamp;
+      n->heap  = A_nheap;
+      A_heap[ A_nheap++ ] = id;
+   }
+   n->g      = g;
+   n->parent = parent;
+   n->seq    = A_seq++;
+   A_up( n->heap );
+}
+/** @brief Closes and returns the lowest ranking open system, -1 if none. */
+static int A_pop (void)
+{
+   int id;
 
-   n = first;
-   do {
-      if (n->sys == cur)
-         return n;
-   } while ((n=n->next) != NULL);
-   return NULL;
+   if (A_nheap == 0)
+      return -1;
+
+   id = A_heap[0];
+   A_nheap--;
+   if (A_nheap > 0) {
+      A_heap[0] = A_heap[ A_nheap ];
+      A_nodes[ A_heap[0] ].heap = 0;
+      A_down( 0 );
+   }
+   A_nodes[id].heap = -1;
+   return id;
 }
-/** @brief Returns the lowest ranking node from a linked list of nodes. */
-static SysNode* A_lowest( SysNode *first )
+/** @brief Checks to see if a jump can be used by the path. */
+static int A_canJump( JumpPoint *jp, int ignore_known, int show_hidden )
 {
-   SysNode *lowest, *n;
+   /* Make sure it's reachable */
+   if (!ignore_known) {
+      if (!jp_isKnown(jp))
+         return 0;
+      if (!sys_isKnown(jp->target) && !space_sysReachable(jp->target))
+         return 0;
+   }
+   if (jp_isFlag( jp, JP_EXITONLY ))
+      return 0;
 
-   if (first == NULL)
-      return NULL;
+   /* Skip hidden jumps if they're unknown and not specifically requested */
+   if (!show_hidden && jp_isFlag( jp, JP_HIDDEN ) && !jp_isKnown(jp))
+      return 0;
 
-   n = first;
-   lowest = n;
-   do {
-      if (n->g < lowest->g)
-         lowest = n;
-   } while ((n=n->next) != NULL);
-   return lowest;
+   return 1;
 }
-/** @brief Frees a linked list. */
-static void A_freeList( SysNode *first )
+/**
+ * @brief Finds the shortest paths from a system.
+ *
+ * Stops once esys is closed, or once every system reachable is if it's NULL.
+ */
+static void A_search( StarSystem *ssys, StarSystem *esys,
+      int ignore_known, int show_hidden )
 {
-   SysNode *p, *n;
+   int i, id, cost;
+   JumpPoint *jp;
+   SysNode *cur, *n;
 
-   if (first == NULL)
-      return;
+   A_reset();
+   A_push( ssys->id, 0, -1 );
+
+   while ((id = A_pop()) >= 0) {
+      /* End condition. */
+      if ((esys != NULL) && (id == esys->id))
+         break;
+
+      cur  = &A_nodes[id];
+      cost = cur->g + 1; /* Base unit is jump and always increases by 1. */
+      for (i=0; i<systems_stack[id].njumps; i++) {
+         jp = &systems_stack[id].jumps[i];
+         if (!A_canJump( jp, ignore_known, show_hidden ))
+            continue;
 
-   p = NULL;
-   n = first;
-   do {
-      if (p != NULL)
-         free(p);
-      p = n;
-   } while ((n=n->gnext) != NULL);
-   free(p);
+         /* Closed or already open with a path at least as good. */
+         n = A_get( jp->target->id );
+         if ((n != NULL) && ((n->heap < 0) || (cost >= n->g)))
+            continue;
+
+         A_push( jp->target->id, cost, id );
+      }
+   }
 }
 
 /** @brief Sets map_zoom to zoom and recreates the faction disk texture. */
@@ -1618,16 +1713,9 @@ StarSystem** map_getJumpPath( int* njumps, const char* sysstart,
     const char* sysend, int ignore_known, int show_hidden,
     StarSystem** old_data )
 {
-   int i, j, cost, ojumps;
-
-   StarSystem *sys, *ssys, *esys, **res;
-   JumpPoint *jp;
-
-   SysNode *cur,   *neighbour;
-   SysNode *open,  *closed;
-   SysNode *ocost, *ccost;
-
-   A_gc = NULL;
+   int i, id, ojumps;
+   StarSystem *ssys, *esys, **res;
+   SysNode *cur;
 
    /* initial and target systems */
    ssys = system_get(sysstart); /* start */
@@ -1657,77 +1745,12 @@ StarSystem** map_getJumpPath( int* njumps, const char* sysstart,
       return NULL;
    }
 
-   /* start the linked lists */
-   open     = closed = NULL;
-   cur      = A_newNode( ssys );
-   cur->parent = NULL;
-   cur->g   = 0;
-   open     = A_add( open, cur ); /* Initial open node is the start system */
-
-   j = 0;
-   while ((cur = A_lowest(open))) {
-      /* End condition. */
-      if (cur->sys == esys)
-         break;
-
-      /* Break if infinite loop. */
-      j++;
-      if (j > MAP_LOOP_PROT)
-         break;
-
-      /* Get best from open and toss to closed */
-      open   = A_rm( open, cur->sys );
-      closed = A_add( closed, cur );
-      cost   = A_g(cur) + 1; /* Base unit is jump and always increases by 1. */
-
-      for (i=0; i<cur->sys->njumps; i++) {
-         jp  = &cur->sys->jumps[i];
-         sys = jp->target;
-
-         /* Make sure it's reachable */
-         if (!ignore_known) {
-            if (!jp_isKnown(jp))
-               continue;
-            if (!sys_isKnown(sys) && !space_sysReachable(sys))
-               continue;
-         }
-         if (jp_isFlag( jp, JP_EXITONLY ))
-            continue;
-
-         /* Skip hidden jumps if they're unknown and not specifically requested */
-         if (!show_hidden && jp_isFlag( jp, JP_HIDDEN ) && !jp_isKnown(jp))
-            continue;
-
-         /* Check to see if it's already in the closed set. */
-         ccost = A_in(closed, sys);
-         if ((ccost != NULL) && (cost >= A_g(ccost)))
-            continue;
-            //closed = A_rm( closed, sys );
-
-         /* Remove if it exists and current is better. */
-         ocost = A_in(open, sys);
-         if (ocost != NULL) {
-            if (cost < A_g(ocost))
-               open = A_rm( open, sys ); /* New path is better */
-            else
-               continue; /* This node is worse, so ignore it. */
-         }
+   A_search( ssys, esys, ignore_known, show_hidden );
 
-         /* Create the node. */
-         neighbour         = A_newNode( sys );
-         neighbour->parent = cur;
-         neighbour->g      = cost;
-         open              = A_add( open, neighbour );
-      }
-
-      /* Sanity check in case not linked. */
-      if (open == NULL)
-         break;
-   }
-
-   /* Build path backwards if not broken from loop. */
-   if (esys == cur->sys) {
-      (*njumps) = A_g(cur);
+   /* Build path backwards if the goal was reached. */
+   cur = A_get( esys->id );
+   if (cur != NULL) {
+      (*njumps) = cur->g;
       if (old_data == NULL)
          res      = malloc( sizeof(StarSystem*) * (*njumps) );
       else {
@@ -1735,9 +1758,10 @@ StarSystem** map_getJumpPath( int* njumps, const char* sysstart,
          res      = realloc( old_data, sizeof(StarSystem*) * (*njumps) );
       }
       /* Build path. */
+      id = esys->id;
       for (i=0; i<((*njumps)-ojumps); i++) {
-         res[(*njumps)-i-1] = cur->sys;
-         cur                = cur->parent;
+         res[(*njumps)-i-1] = &systems_stack[id];
+         id                 = A_nodes[id].parent;
       }
    }
    else {
@@ -1747,12 +1771,129 @@ StarSystem** map_getJumpPath( int* njumps, const char* sysstart,
          free( old_data );
    }
 
-   /* free the linked lists */
-   A_freeList(A_gc);
    return res;
 }
 
 
+/**
+ * @brief Gets the number of jumps between two systems.
+ *
+ * Same as the length of the path map_getJumpPath() finds, but looked up in a
+ * table of the distances from every source asked about so far. Rows are
+ * computed on demand and thrown away when jumps or what the player knows
+ * change.
+ *
+ *    @param ssys System to start from.
+ *    @param esys System to end at.
+ *    @param ignore_known Whether or not to ignore if systems are known.
+ *    @param show_hidden Whether or not to use hidden jumps.
+ *    @return Number of jumps, 0 if there is no path.
+ */
+int map_getJumpDist( StarSystem *ssys, StarSystem *esys,
+      int ignore_known, int show_hidden )
+{
+   int i, n;
+   unsigned int gen;
+   JumpDist *jd;
+   short *row;
+   SysNode *node;
+
+   /* Check self. */
+   if ((ssys == esys) || (ssys->njumps==0))
+      return 0;
+
+   /* system target must be known and reachable */
+   if (!ignore_known && !sys_isKnown(esys) && !space_sysReachable(esys))
+      return 0;
+
+   /* Table was made for another universe. */
+   n = systems_nstack;
+   if (n != map_jdistN) {
+      map_jumpDistFree();
+      map_jdistN = n;
+   }
+
+   jd  = &map_jdist[ (ignore_known ? 2 : 0) + (show_hidden ? 1 : 0) ];
+   /* Hidden jumps still depend on what is known unless they are all shown. */
+   gen = (ignore_known && show_hidden) ? map_jdistGenAll : map_jdistGenKnown;
+   if (jd->dist == NULL) {
+      jd->dist = malloc( sizeof(short) * n * n );
+      jd->gen  = calloc( n, sizeof(unsigned int) );
+   }
+
+   /* Compute the row on first use. */
+   row = &jd->dist[ ssys->id * n ];
+   if (jd->gen[ ssys->id ] != gen) {
+      A_search( ssys, NULL, ignore_known, show_hidden );
+      for (i=0; i<n; i++) {
+         node   = A_get( i );
+         row[i] = (node != NULL) ? node->g : -1;
+      }
+      jd->gen[ ssys->id ] = gen;
+   }
+
+   return MAX( 0, row[ esys->id ] );
+}
+
+
+/**
+ * @brief Gets the shortest paths from a system to every system.
+ *
+ * Finds the same paths as map_getJumpPath() would for each destination, but
+ * with a single search.
+ *
+ *    @param ssys System to start from.
+ *    @param ignore_known Whether or not to ignore if systems are known.
+ *    @param show_hidden Whether or not to use hidden jumps.
+ *    @param[out] jumps Number of jumps to each system, -1 if it can't be
+ *                reached. Must have room for every system.
+ *    @param[out] parent System each system is jumped to from, -1 for ssys and
+ *                those that can't be reached. Must have room for every system.
+ */
+void map_getJumpTree( StarSystem *ssys, int ignore_known, int show_hidden,
+      int *jumps, int *parent )
+{
+   int i;
+   SysNode *node;
+
+   A_search( ssys, NULL, ignore_known, show_hidden );
+   for (i=0; i<systems_nstack; i++) {
+      node      = A_get( i );
+      jumps[i]  = (node != NULL) ? node->g : -1;
+      parent[i] = (node != NULL) ? node->parent : -1;
+   }
+}
+
+
+/**
+ * @brief Throws away the jump distances map_getJumpDist() knows.
+ *
+ *    @param known 1 if only what the player knows changed, 0 if the jumps did.
+ */
+void map_jumpDistInvalidate( int known )
+{
+   map_jdistGenKnown++;
+   if (!known)
+      map_jdistGenAll++;
+}
+
+
+/**
+ * @brief Frees the jump distance tables.
+ */
+static void map_jumpDistFree (void)
+{
+   int i;
+   for (i=0; i<4; i++) {
+      free( map_jdist[i].dist );
+      free( map_jdist[i].gen );
+      map_jdist[i].dist = NULL;
+      map_jdist[i].gen  = NULL;
+   }
+   map_jdistN = 0;
+}
+
+
 /**
  * @brief Marks maps around a radius of currently system as known.
  *
@@ -1773,6 +1914,7 @@ int map_map( const Outfit *map )
    for (i=0; i<array_size(map->u.map->jumps);i++)
       jp_setFlag(map->u.map->jumps[i], JP_KNOWN);
 
+   map_jumpDistInvalidate( 1 );
    return 1;
 }
 
@@ -1826,6 +1968,7 @@ int localmap_map( const Outfit *lmap )
       if (mod*jp->hide <= detect)
          jp_setFlag( jp, JP_KNOWN );
    }
+   map_jumpDistInvalidate( 1 );
 
    detect = lmap->u.lmap.asset_detect;
    for (i=0; i<cur_system->nplanets; i++) {
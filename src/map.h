@@ -33,6 +33,11 @@ void map_jump (void);
 StarSystem** map_getJumpPath( int* njumps, const char* sysstart,
      const char* sysend, int ignore_known, int show_hidden,
      StarSystem** old_data );
+int map_getJumpDist( StarSystem *ssys, StarSystem *esys,
+      int ignore_known, int show_hidden );
+void map_jumpDistInvalidate( int known );
+void map_getJumpTree( StarSystem *ssys, int ignore_known, int show_hidden,
+      int *jumps, int *parent );
 int map_map( const Outfit *map );
 int map_isMapped( const Outfit* map );
 
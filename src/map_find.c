@@ -37,6 +37,11 @@ static int map_found_ncur           = 0;     /**< Number of found stuff. */
 static tech_group_t **map_known_techs = NULL; /**< Known techs. */
 static Planet **map_known_planets   = NULL;  /**< Known planets with techs. */
 static int map_nknown               = 0;     /**< Number of known. */
+/* Paths from the current system, shared by the results of a search. */
+static int *map_find_jumps          = NULL;  /**< Jumps to each system, -1 if unreachable. */
+static int *map_find_parent         = NULL;  /**< System each system is reached from. */
+static double *map_find_travel      = NULL;  /**< Distance travelled to reach each system, -1 until computed. */
+static const Vector2d **map_find_arrive = NULL; /**< Where each system is arrived at. */
 
 
 /*
@@ -53,6 +58,11 @@ static int map_findSearchPlanets( unsigned int parent, const char *name );
 static int map_findSearchOutfits( unsigned int parent, const char *name );
 static int map_findSearchShips( unsigned int parent, const char *name );
 static void map_findSearch( unsigned int wid, char* str );
+/* Paths. */
+static void map_findPathsInit (void);
+static void map_findPathsClean (void);
+static double map_findTravel( int id, const Vector2d **pos );
+static int map_findDistance( StarSystem *sys, Planet *pnt, int *jumps, double *distance );
 /* Misc. */
 static int map_sortCompare( const void *p1, const void *p2 );
 static void map_sortFound( map_find_t *found, int n );
@@ -284,102 +294,132 @@ static void map_sortFound( map_find_t *found, int n )
 
 
 /**
- * @brief Gets the distance.
+ * @brief Finds the paths from the current system to every system.
  */
-static int map_findDistance( StarSystem *sys, Planet *pnt, int *jumps, double *distance )
+static void map_findPathsInit (void)
 {
-   int i, j;
-   StarSystem **slist, *ss;
-   double d;
-   Vector2d *vs, *ve;
+   int i, n;
 
-   /* Defaults. */
-   ve = NULL;
+   system_getAll( &n );
+   map_find_jumps  = malloc( sizeof(int) * n );
+   map_find_parent = malloc( sizeof(int) * n );
+   map_find_travel = malloc( sizeof(double) * n );
+   map_find_arrive = malloc( sizeof(Vector2d*) * n );
+   for (i=0; i<n; i++)
+      map_find_travel[i] = -1.;
+   map_getJumpTree( cur_system, 0, 1, map_find_jumps, map_find_parent );
+}
 
-   /* Special case it's the current system. */
-   if (sys == cur_system) {
-      *jumps = 0;
-      if (pnt != NULL)
-         *distance = vect_dist( &player.p->solid->pos, &pnt->pos );
-      else
-         *distance = 0.;
 
-      return 0;
+/**
+ * @brief Cleans up the paths from the current system.
+ */
+static void map_findPathsClean (void)
+{
+   free( map_find_jumps );
+   map_find_jumps = NULL;
+   free( map_find_parent );
+   map_find_parent = NULL;
+   free( map_find_travel );
+   map_find_travel = NULL;
+   free( map_find_arrive );
+   map_find_arrive = NULL;
+}
+
+
+/**
+ * @brief Gets the distance travelled to reach a system along its path.
+ *
+ * Distances are remembered so systems sharing a path only walk it once.
+ *
+ *    @param id System to reach, must be reachable.
+ *    @param[out] pos Where the system is arrived at.
+ *    @return Distance travelled through the systems before it.
+ */
+static double map_findTravel( int id, const Vector2d **pos )
+{
+   static const Vector2d origin = { .x = 0., .y = 0. };
+   const Vector2d *vs, *ve;
+   StarSystem *ss;
+   double d;
+   int j, par;
+
+   if (map_find_travel[id] >= 0.) {
+      *pos = map_find_arrive[id];
+      return map_find_travel[id];
    }
 
-   /* Calculate jump path. */
-   slist = map_getJumpPath( jumps, cur_system->name, sys->name, 0, 1, NULL );
-   if (slist==NULL)
-      /* Unknown. */
-      return -1;
+   /* Travel starts at the player. */
+   if (id == cur_system->id) {
+      map_find_travel[id] = 0.;
+      map_find_arrive[id] = &player.p->solid->pos;
+      *pos = map_find_arrive[id];
+      return 0.;
+   }
 
-   /* Distance to first jump point. */
-   vs = &player.p->solid->pos;
-   for (j=0; j < cur_system->njumps; j++) {
-      if (cur_system->jumps[j].target == slist[0]) {
-         ve = &cur_system->jumps[j].pos;
+   /* Go through the previous system to the jump into this one. */
+   par = map_find_parent[id];
+   d   = map_findTravel( par, &vs );
+   ss  = system_getIndex( par );
+   ve  = NULL;
+   for (j=0; j < ss->njumps; j++) {
+      if (ss->jumps[j].target->id == id) {
+         ve = &ss->jumps[j].pos;
          break;
       }
    }
-   if (ve == NULL) {
-      WARN(_("Jump to first system not found!"));
-      d = 0.;
-   }
+   if (ve == NULL)
+      WARN(_("Matching jumps not found, something is up..."));
    else
-      d = vect_dist( vs, ve );
-
-   /* Calculate distance. */
-   for (i=0; i<(*jumps-1); i++) {
-      ss = slist[i];
-
-      /* Search jump points. */
-      for (j=0; j < ss->njumps; j++) {
-
-         /* Get previous jump. */
-         if (i == 0) {
-            if (ss->jumps[j].target == cur_system)
-               vs = &ss->jumps[j].pos;
-         }
-         else {
-            if (ss->jumps[j].target == slist[i-1])
-               vs = &ss->jumps[j].pos;
-         }
+      d += vect_dist( vs, ve );
 
-         /* Get next jump. */
-         if (ss->jumps[j].target == slist[i+1]) {
-            ve = &ss->jumps[j].pos;
-            break;
-         }
+   /* Arrive at the jump back, or the middle of the system for one-way jumps. */
+   ss = system_getIndex( id );
+   map_find_arrive[id] = &origin;
+   for (j=0; j < ss->njumps; j++) {
+      if (ss->jumps[j].target->id == par) {
+         map_find_arrive[id] = &ss->jumps[j].pos;
+         break;
       }
+   }
 
-      /* Use current position. */
-      if (i==0)
-         vs = &player.p->solid->pos;
+   map_find_travel[id] = d;
+   *pos = map_find_arrive[id];
+   return d;
+}
 
-#ifdef DEBUGGING
-      if ((vs==NULL) || (ve==NULL)) {
-         WARN( _("Matching jumps not found, something is up...") );
-         continue;
-      }
-#endif /* DEBUGGING */
 
-      /* Calculate. */
-      d += vect_dist( vs, ve );
-   }
+/**
+ * @brief Gets the distance.
+ *
+ * Uses the paths map_findPathsInit() found, so every result of a search
+ * shares one path search.
+ */
+static int map_findDistance( StarSystem *sys, Planet *pnt, int *jumps, double *distance )
+{
+   const Vector2d *vs;
+   double d;
 
-   /* Account final travel to planet for planet targets. */
-   if (pnt != NULL) {
-      ss = slist[ i ];
-      for (j=0; j < ss->njumps; j++)
-         if (ss->jumps[j].target == slist[i-1])
-            vs = &ss->jumps[j].pos;
+   /* Special case it's the current system. */
+   if (sys == cur_system) {
+      *jumps = 0;
+      if (pnt != NULL)
+         *distance = vect_dist( &player.p->solid->pos, &pnt->pos );
+      else
+         *distance = 0.;
 
-      ve = &pnt->pos;
-      d += vect_dist( vs, ve );
+      return 0;
    }
 
-   /* Cleanup. */
-   free(slist);
+   /* Unknown. */
+   if (map_find_jumps[ sys->id ] <= 0)
+      return -1;
+
+   /* Travel through the path, then to the planet for planet targets. */
+   *jumps = map_find_jumps[ sys->id ];
+   d = map_findTravel( sys->id, &vs );
+   if (pnt != NULL)
+      d += vect_dist( vs, &pnt->pos );
 
    *distance = d;
    return 0;
@@ -1022,6 +1062,9 @@ static void map_findSearch( unsigned int wid, char* str )
       free( map_found_cur );
    map_found_cur = NULL;
 
+   /* All the results are ranked with the same paths. */
+   map_findPathsInit();
+
    /* Handle different search cases. */
    if (map_find_systems) {
       ret = map_findSearchSystems( wid, name );
@@ -1042,6 +1085,8 @@ static void map_findSearch( unsigned int wid, char* str )
    else
       ret = 1;
 
+   map_findPathsClean();
+
    if (ret < 0)
       dialogue_alert( _("%s matching '%s' not found!"), searchname, name );
 
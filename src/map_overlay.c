@@ -215,6 +215,9 @@ void ovr_render( double dt )
    /* First render the background overlay. */
    gl_renderRect( 0., 0., w, h, &c );
 
+   /* Batch the markers. */
+   gui_batchBegin();
+
    /* Render planets. */
    for (i=0; i<cur_system->nplanets; i++)
       if ((cur_system->planets[ i ]->real == ASSET_REAL) && (i != player.p->nav_planet))
@@ -244,6 +247,16 @@ void ovr_render( double dt )
    if (j!=0)
       gui_renderPilot( pstk[j], RADAR_RECT, w, h, res, 1 );
 
+   /* render the asteroids */
+   for (i=0; i<cur_system->nasteroids; i++) {
+      ast = &cur_system->asteroids[i];
+      for (j=0; j<ast->nb; j++)
+         gui_renderAsteroid( &ast->asteroids[j], w, h, res, 1 );
+   }
+
+   /* Draw the markers, the names go over them. */
+   gui_batchEnd();
+
    /* Check if player has goto target. */
    if (player_isFlag(PLAYER_AUTONAV) && (player.autonav == AUTONAV_POS_APPROACH)) {
       x = player.autonav_pos.x / res + w / 2.;
@@ -252,13 +265,6 @@ void ovr_render( double dt )
       gl_printRaw( &gl_smallFont, x+10., y-gl_smallFont.h/2., &cRadar_hilight, _("GOTO") );
    }
 
-   /* render the asteroids */
-   for (i=0; i<cur_system->nasteroids; i++) {
-      ast = &cur_system->asteroids[i];
-      for (j=0; j<ast->nb; j++)
-         gui_renderAsteroid( &ast->asteroids[j], w, h, res, 1 );
-   }
-
    /* Render the player. */
    gui_renderPlayer( res, 1 );
 
@@ -157,8 +157,6 @@ MissionData* mission_getFromName( const char* name )
  */
 static int mission_init( Mission* mission, MissionData* misn, int genid, int create, unsigned int *id )
 {
-   char *buf;
-   size_t bufsize;
    int ret;
 
    /* clear the mission */
@@ -180,20 +178,18 @@ static int mission_init( Mission* mission, MissionData* misn, int genid, int cre
    misn_loadLibs( mission->env ); /* load our custom libraries */
 
    /* load the file */
-   buf = ndata_read( misn->lua, &bufsize );
-   if (buf == NULL) {
+   ret = nlua_dochunkenv(mission->env, misn->lua);
+   if (ret == -2) {
       WARN(_("Mission '%s' Lua script not found."), misn->lua );
       return -1;
    }
-   if (nlua_dobufenv(mission->env, buf, bufsize, misn->lua) != 0) {
+   if (ret != 0) {
       WARN(_("Error loading mission file: %s\n"
           "%s\n"
           "Most likely Lua file has improper syntax, please check"),
             misn->lua, lua_tostring(naevL, -1));
-      free(buf);
       return -1;
    }
-   free(buf);
 
    /* run create function */
    if (create) {
@@ -83,6 +83,7 @@
 #include "nlua_var.h"
 #include "map.h"
 #include "event.h"
+#include "profile.h"
 #include "cond.h"
 #include "land.h"
 #include "tech.h"
@@ -100,12 +101,14 @@
 #include "options.h"
 #include "dialogue.h"
 #include "slots.h"
+#include "scenario.h"
 
 
 #define CONF_FILE       "conf.lua" /**< Configuration file by default. */
 #define VERSION_FILE    "VERSION" /**< Version file by default. */
 
 #define NAEV_INIT_DELAY 3000 /**< Minimum amount of time_ms to wait with loading screen */
+#define NAEV_HEADLESS_DT (1./60.) /**< Fixed tick length when running headless. */
 
 
 static int quit               = 0; /**< For primary loop */
@@ -146,6 +149,9 @@ static void display_fps( const double dt );
 static void window_caption (void);
 static void debug_sigInit (void);
 static void debug_sigClose (void);
+/* headless */
+static int naev_argHeadless( int argc, char** argv );
+static void naev_headless (void);
 /* update */
 static void fps_init (void);
 static double fps_elapsed (void);
@@ -218,6 +224,16 @@ int main( int argc, char** argv )
    setenv("SDL_VIDEO_X11_WMCLASS", APPNAME, 0);
 #endif /* HAS_UNIX */
 
+   /* Headless runs have no display, SDL's dummy driver still gives us events.
+    * The CLI isn't parsed yet so this has to be looked up by hand. */
+   if (naev_argHeadless( argc, argv )) {
+#if SDL_VERSION_ATLEAST(2,0,0)
+      SDL_setenv( "SDL_VIDEODRIVER", "dummy", 0 );
+#else /* SDL_VERSION_ATLEAST(2,0,0) */
+      SDL_putenv( "SDL_VIDEODRIVER=dummy" );
+#endif /* SDL_VERSION_ATLEAST(2,0,0) */
+   }
+
    /* Must be initialized before input_init is called. */
    if (SDL_InitSubSystem(SDL_INIT_VIDEO) < 0) {
       WARN( _("Unable to initialize SDL Video: %s"), SDL_GetError());
@@ -315,6 +331,10 @@ int main( int argc, char** argv )
    /* random numbers */
    rng_init();
 
+   /* Simulate without a display, does not return. */
+   if ((conf.headless != NULL) || (conf.scenario != NULL))
+      naev_headless();
+
    /*
     * OpenGL
     */
@@ -531,6 +551,7 @@ int main( int argc, char** argv )
    input_exit(); /* Cleans up keybindings */
    nebu_exit(); /* Destroys the nebula */
    lua_exit(); /* Closes Lua state. */
+   profile_exit(); /* Closes the profile dump. */
    gl_exit(); /* Kills video output */
    sound_exit(); /* Kills the sound */
    news_exit(); /* Destroys the news. */
@@ -558,6 +579,141 @@ int main( int argc, char** argv )
 }
 
 
+/**
+ * @brief Checks the arguments for --headless or --scenario before the CLI is parsed.
+ *
+ *    @param argc Number of arguments.
+ *    @param argv Array of argc arguments.
+ *    @return 1 if running headless.
+ */
+static int naev_argHeadless( int argc, char** argv )
+{
+   int i;
+
+   /* Either "--flag value" or "--flag=value". */
+   for (i=1; i<argc; i++)
+      if ((strcmp( argv[i], "--headless" ) == 0) ||
+            (strncmp( argv[i], "--headless=", 11 ) == 0) ||
+            (strcmp( argv[i], "--scenario" ) == 0) ||
+            (strncmp( argv[i], "--scenario=", 11 ) == 0))
+         return 1;
+
+   return 0;
+}
+
+
+/**
+ * @brief Runs a scenario without a display and exits, for benchmarking.
+ *
+ * Loads the data without OpenGL or sound, starts the --scenario scenario or
+ * the --headless system and steps update_routine() at a fixed rate as fast
+ * as possible, then reports the time spent in each subsystem. Sprites still
+ * get their transparency maps so collisions behave as in the game.
+ */
+static void naev_headless (void)
+{
+   Scenario sc;
+   int i, j, n, nsub, ret;
+   double dt, start, elapsed;
+   double zones[PROFILE_ZONES];
+   unsigned long counters[PROFILE_COUNTERS];
+   unsigned long cchecks, chits;
+   double ctime;
+   uint32_t seed;
+
+   gl_initHeadless();
+
+   LOG( _("Sound is disabled!") );
+   sound_disabled = 1;
+   music_disabled = 1;
+
+   cond_init(); /* Initialize conditional subsystem. */
+
+   /* Data loading */
+   load_all();
+
+   /* Set up the run, the seed is always logged so it can be reproduced. */
+   seed = (conf.headless_seed >= 0) ? (uint32_t)conf.headless_seed : randint();
+   if (conf.scenario != NULL) {
+      if (scenario_load( &sc, conf.scenario ))
+         exit(EXIT_FAILURE);
+      if (conf.headless_seed >= 0)
+         sc.seed = seed;
+   }
+   else
+      scenario_init( &sc, conf.headless, 0, seed );
+   if (conf.headless_ticks > 0)
+      sc.ticks = conf.headless_ticks;
+   if (sc.ticks <= 0)
+      sc.ticks = HEADLESS_TICKS_DEFAULT;
+   LOG( _("Running '%s' in %s for %d ticks with seed %u"),
+         sc.name, sc.system, sc.ticks, (unsigned int)sc.seed );
+   if (scenario_start( &sc ))
+      exit(EXIT_FAILURE);
+   if ((conf.trace != NULL) && scenario_traceOpen( conf.trace ))
+      exit(EXIT_FAILURE);
+
+   /* Compressed time is split in steps no longer than fps_min like update_all(). */
+   dt    = NAEV_HEADLESS_DT * sc.compression;
+   nsub  = MAX( 1, (int)ceil( dt / fps_min ) );
+   dt   /= (double)nsub;
+
+   /* Simulate. */
+   ret = 0;
+   profile_enable( 1 );
+   start = profile_now();
+   for (i=0; i<sc.ticks; i++) {
+      scenario_update( &sc, i );
+      for (j=0; j<nsub; j++)
+         update_routine( dt, 0 );
+      profile_frame( dt * nsub );
+      if (scenario_trace( i+1 )) {
+         ret = -1;
+         break;
+      }
+   }
+   elapsed = MAX( profile_now() - start, 1e-6 );
+   profile_totals( zones, counters );
+   profile_exit();
+   scenario_traceClose();
+
+   /* Report. */
+   pilot_getAll( &n );
+   LOG( _("Simulated %d ticks in %.3f s (%.1f ticks/s), %d pilots left, checksum %08x"),
+         i, elapsed, i / elapsed, n, (unsigned int)scenario_checksum() );
+   for (j=0; j<PROFILE_RENDER; j++)
+      LOG( _("   %-8s %8.3f s  %5.1f%%  %9.1f us/tick"), profile_zoneName(j),
+            zones[j], 100. * zones[j] / elapsed, zones[j] / MAX(i,1) * 1e6 );
+   for (j=0; j<PROFILE_COUNTERS; j++)
+      LOG( _("   %-8s %12lu  %9.1f /tick"), profile_counterName(j),
+            counters[j], (double)counters[j] / MAX(i,1) );
+   cond_stats( &cchecks, &chits, &ctime );
+   LOG( _("   Conditionals: %lu checks, %lu compiled, %.3f ms"),
+         cchecks, cchecks - chits, ctime * 1000. );
+   scenario_free( &sc );
+
+   /* data unloading */
+   unload_all();
+   ndata_close();
+   start_cleanup();
+   conf_cleanup();
+
+   /* exit subsystems */
+   map_exit(); /* Destroys the map. */
+   ai_exit(); /* Stops the Lua AI magic */
+   input_exit(); /* Cleans up keybindings */
+   lua_exit(); /* Closes Lua state. */
+   gl_exit(); /* Only frees the textures. */
+   SDL_Quit(); /* quits SDL */
+   xmlCleanupParser();
+   debug_sigClose();
+   free(binary_path);
+   log_clean();
+
+   exit( (ret == 0) ? EXIT_SUCCESS : EXIT_FAILURE );
+}
+
+
 /**
  * @brief Loads a loading screen.
  */
@@ -608,6 +764,10 @@ void loadscreen_render( double done, const char *msg )
    double x,y, w,h, rh;
    SDL_Event event;
 
+   /* Nothing to draw on. */
+   if (gl_has(OPENGL_HEADLESS))
+      return;
+
    /* Clear background. */
    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -747,6 +907,7 @@ void unload_all (void)
    dtype_free(); /* gets rid of the damage types */
    missions_free();
    events_cleanup(); /* Clean up events. */
+   hook_cleanup(); /* Frees the hooks. */
    factions_free();
    commodity_free();
    var_cleanup(); /* cleans up mission variables */
@@ -769,6 +930,7 @@ void main_loop( int update )
     */
    input_update( real_dt ); /* handle key repeats. */
    sound_update( real_dt ); /* Update sounds. */
+   gl_texUpdate(); /* Upload textures loaded in the background. */
    if (toolkit_isOpen())
       toolkit_update(); /* to simulate key repetition */
    if (!paused && update) {
@@ -793,6 +955,8 @@ void main_loop( int update )
 #else /* SDL_VERSION_ATLEAST(2,0,0) */
    SDL_GL_SwapBuffers();
 #endif /* SDL_VERSION_ATLEAST(2,0,0) */
+
+   profile_frame( real_dt );
 }
 
 
@@ -1026,24 +1190,35 @@ static void update_all (void)
  */
 void update_routine( double dt, int enter_sys )
 {
+   double t;
+
+   t = profile_begin();
+
    if (!enter_sys) {
       hook_exclusionStart();
 
       /* Update time. */
       ntime_update( dt );
    }
+   t = profile_zone( PROFILE_TIME, t );
 
    /* Update engine stuff. */
    space_update(dt);
+   t = profile_zone( PROFILE_SPACE, t );
    weapons_update(dt);
+   t = profile_zone( PROFILE_WEAPONS, t );
    spfx_update(dt);
+   t = profile_zone( PROFILE_SPFX, t );
    pilots_update(dt);
+   t = profile_zone( PROFILE_PILOTS, t );
 
    /* Update camera. */
    cam_update( dt );
+   t = profile_zone( PROFILE_CAMERA, t );
 
    if (!enter_sys)
       hook_exclusionEnd( dt );
+   profile_zone( PROFILE_HOOKS, t );
 }
 
 
@@ -1067,8 +1242,9 @@ void update_routine( double dt, int enter_sys )
  */
 static void render_all (void)
 {
-   double dt;
+   double dt, t;
 
+   t  = profile_begin();
    dt = (paused) ? 0. : game_dt;
 
    /* setup */
@@ -1091,6 +1267,8 @@ static void render_all (void)
    gui_render(dt);
    ovr_render(dt);
    display_fps( real_dt ); /* Exception. */
+   profile_zone( PROFILE_RENDER, t );
+   profile_render();
 }
 
 
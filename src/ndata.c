@@ -37,6 +37,12 @@
 #include "glue_macos.h"
 #endif /* HAS_MACOS */
 #include <stdarg.h>
+#if HAS_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif /* HAS_POSIX */
 
 #include "SDL.h"
 #include "SDL_mutex.h"
@@ -45,6 +51,7 @@
 #include "nxml.h"
 #include "nzip.h"
 #include "nfile.h"
+#include "nhash.h"
 #include "conf.h"
 #include "npng.h"
 #include "nstring.h"
@@ -62,6 +69,8 @@
 #define NDATA_SRC_NDATADEF       2
 #define NDATA_SRC_BINARY         3
 
+#define NDATA_INDEX_ROOT   "dat/" /**< Loose files below this are indexed. */
+
 
 /*
  * ndata archive.
@@ -75,10 +84,32 @@ static int ndata_loadedfile         = 0; /**< Already loaded a file? */
 static int ndata_source             = 0;
 
 /*
- * File list.
+ * Loose files.
  */
-static char **ndata_fileList  = NULL; /**< List of files in the archive. */
-static size_t ndata_fileNList     = 0; /**< Number of files in ndata_fileList. */
+static int ndata_resolved           = 0; /**< Whether the data was looked for. */
+static char* ndata_loose            = NULL; /**< Directory loose files are read from, NULL if using the archive. */
+
+/*
+ * File index.
+ */
+/**
+ * @brief A file being indexed.
+ */
+typedef struct NdataEntry_ {
+   char *name; /**< Name of the file. */
+   int index; /**< Index in the archive, -1 for loose files. */
+} NdataEntry;
+static char **ndata_fileList  = NULL; /**< Files of the archive, or loose files below NDATA_INDEX_ROOT, sorted by name. */
+static int *ndata_fileIndex   = NULL; /**< Archive index of each file of ndata_fileList. */
+static size_t ndata_fileNList = 0; /**< Number of files in ndata_fileList. */
+static NHash *ndata_index     = NULL; /**< File name to position in ndata_fileList. */
+
+/*
+ * Mapped files.
+ */
+static void **ndata_maps            = NULL; /**< Data ndata_map() mapped instead of reading. */
+static int ndata_nmaps              = 0; /**< Number of mapped files. */
+static int ndata_mmaps              = 0; /**< Memory allocated for ndata_maps. */
 
 
 /*
@@ -92,6 +123,12 @@ static int ndata_isndata( const char *path, ... );
 static int ndata_prompt( void *data );
 #endif /* SDL_VERSION_ATLEAST(2,0,0) */
 static int ndata_notfound (void);
+static void ndata_resolve (void);
+static int ndata_indexSort( const void *p1, const void *p2 );
+static int ndata_indexBuild (void);
+static int ndata_isIndexed( const char *filename );
+static void ndata_loosePath( char *path, size_t len, const char *filename );
+static const char* ndata_canonical( char *name, size_t len, const char *filename );
 static char** ndata_listBackend( const char* path, size_t* nfiles, int dirs );
 static char **stripPath( const char **list, int nlist, const char *path );
 static char** filterList( const char** list, int nlist,
@@ -474,8 +511,10 @@ static int ndata_openFile (void)
          if (!ndata_notfound())
             exit(1);
       }
-      else
+      else {
+         SDL_mutexV(ndata_lock);
          return -1;
+      }
    }
    ndata_archive = nzip_open( ndata_filename );
    if (ndata_archive == NULL)
@@ -572,6 +611,17 @@ void ndata_close (void)
       ndata_fileList  = NULL;
       ndata_fileNList = 0;
    }
+   free(ndata_fileIndex);
+   ndata_fileIndex = NULL;
+   nhash_free(ndata_index);
+   ndata_index = NULL;
+
+   /* Forget where loose files are. */
+   free(ndata_loose);
+   ndata_loose    = NULL;
+   ndata_resolved = 0;
+
+   /* ndata_maps is kept until the mappings still alive are released. */
 
    /* Close the archive. */
    if (ndata_archive) {
@@ -627,135 +677,250 @@ const char* ndata_getDirname(void)
 
 
 /**
- * @brief Checks to see if a file is in the NDATA.
- *    @param filename Name of the file to check.
- *    @return 1 if the file exists, 0 otherwise.
+ * @brief Works out where the data is read from.
+ *
+ * Loose files are looked for in the same places and order as always, but
+ * only once: the first location with the start file is used for every file.
+ * Without one the archive is opened.
  */
-int ndata_exists( const char* filename )
+static void ndata_resolve (void)
 {
    char *buf, path[PATH_MAX];
 
-   /* See if needs to load ndata archive. */
-   if (ndata_archive == NULL) {
+   if (ndata_resolved)
+      return;
+   ndata_resolved = 1;
 
-      /* Try to read the file as locally. */
-      if (nfile_fileExists( filename ) && (ndata_source <= NDATA_SRC_LAIDOUT))
-         return 1;
+   /* Archive was given. */
+   if (ndata_archive != NULL)
+      return;
 
-      /* We can try to use the dirname path. */
-      if ((ndata_filename == NULL) && (ndata_dirname != NULL) &&
-            (ndata_source <= NDATA_SRC_DIRNAME)) {
-         nsnprintf( path, sizeof(path), "%s/%s", ndata_dirname, filename );
-         if (nfile_fileExists( path ))
-            return 1;
-      }
+   /* Laid out in the current directory. */
+   if ((ndata_source <= NDATA_SRC_LAIDOUT) && nfile_fileExists( START_DATA_PATH )) {
+      ndata_loose = strdup( "." );
+      return;
+   }
 
-      /* We can also try default location. */
-      if (ndata_source <= NDATA_SRC_NDATADEF) {
-         buf = strdup( NDATA_DEF );
-         nsnprintf( path, sizeof(path), "%s/%s", nfile_dirname(buf), filename );
-         free(buf);
-         if (nfile_fileExists( path ))
-            return 1;
-      }
+   /* We can try to use the dirname path. */
+   if ((ndata_filename == NULL) && (ndata_dirname != NULL) &&
+         (ndata_source <= NDATA_SRC_DIRNAME) &&
+         nfile_fileExists( "%s/%s", ndata_dirname, START_DATA_PATH )) {
+      ndata_source = NDATA_SRC_DIRNAME;
+      ndata_loose  = strdup( ndata_dirname );
+      return;
+   }
 
-      /* Try binary location. */
-      if (ndata_source <= NDATA_SRC_BINARY) {
-         buf = strdup( naev_binary() );
-         nsnprintf( path, sizeof(path), "%s/%s", nfile_dirname(buf), filename );
-         free(buf);
-         if (nfile_fileExists( path ))
-            return 1;
+   /* We can also try default location. */
+   if (ndata_source <= NDATA_SRC_NDATADEF) {
+      buf = strdup( NDATA_DEF );
+      nsnprintf( path, sizeof(path), "%s", nfile_dirname(buf) );
+      free(buf);
+      if (nfile_fileExists( "%s/%s", path, START_DATA_PATH )) {
+         ndata_source = NDATA_SRC_NDATADEF;
+         ndata_loose  = strdup( path );
+         return;
       }
+   }
 
-      return 0;
+   /* Try binary location. */
+   if (ndata_source <= NDATA_SRC_BINARY) {
+      buf = strdup( naev_binary() );
+      nsnprintf( path, sizeof(path), "%s", nfile_dirname(buf) );
+      free(buf);
+      if (nfile_fileExists( "%s/%s", path, START_DATA_PATH )) {
+         ndata_source = NDATA_SRC_BINARY;
+         ndata_loose  = strdup( path );
+         return;
+      }
    }
 
-   /* Try to get it from the archive. */
-   return nzip_hasFile( ndata_archive, filename );
+   /* Load the ndata archive. */
+   ndata_openFile();
 }
 
 
 /**
- * @brief Reads a file from the ndata.
+ * @brief Small qsort wrapper for index entries.
+ */
+static int ndata_indexSort( const void *p1, const void *p2 )
+{
+   const NdataEntry *e1, *e2;
+   e1 = (const NdataEntry*) p1;
+   e2 = (const NdataEntry*) p2;
+   return strcmp( e1->name, e2->name );
+}
+
+
+/**
+ * @brief Builds the index of the data files if needed.
  *
- *    @param filename Name of the file to read.
- *    @param[out] filesize Stores the size of the file.
- *    @return The file data or NULL on error.
+ * The index holds every file of the archive, or every loose file under
+ * NDATA_INDEX_ROOT, sorted by name and hashed so lookups and listings don't
+ * have to touch the disk.
+ *
+ *    @return 0 on success.
  */
-void* ndata_read( const char* filename, size_t *filesize )
+static int ndata_indexBuild (void)
 {
-   char *buf, path[PATH_MAX];
-   size_t nbuf;
+   char **files, root[PATH_MAX];
+   int *index;
+   size_t i, n, len;
+   NdataEntry *entries;
 
-   /* See if needs to load ndata archive. */
-   if (ndata_archive == NULL) {
+   if (ndata_index != NULL)
+      return 0;
 
-      /* Try to read the file as locally. */
-      if (nfile_fileExists( filename ) && (ndata_source <= NDATA_SRC_LAIDOUT)) {
-         buf = nfile_readFile( &nbuf, filename );
-         if (buf != NULL) {
-            ndata_loadedfile = 1;
-            *filesize = nbuf;
-            return buf;
-         }
-      }
+   /* Opening the archive reads its version, which builds the index. */
+   ndata_resolve();
+   if (ndata_index != NULL)
+      return 0;
 
-      /* We can try to use the dirname path. */
-      if ((ndata_filename == NULL) && (ndata_dirname != NULL) &&
-            (ndata_source <= NDATA_SRC_DIRNAME)) {
-         nsnprintf( path, sizeof(path), "%s/%s", ndata_dirname, filename );
-         if (nfile_fileExists( path )) {
-            buf = nfile_readFile( &nbuf, path );
-            if (buf != NULL) {
-               ndata_source = NDATA_SRC_DIRNAME;
-               ndata_loadedfile = 1;
-               *filesize = nbuf;
-               return buf;
-            }
-         }
+   /* Get the files. */
+   index = NULL;
+   len   = 0;
+   if (ndata_archive != NULL)
+      files = nzip_listFiles( ndata_archive, &n, &index );
+   else if (ndata_loose != NULL) {
+      nsnprintf( root, sizeof(root), "%s/%s", ndata_loose, NDATA_INDEX_ROOT );
+      files = nfile_readDirRecursive( &n, root );
+      len   = strlen( ndata_loose ) + 1; /* Strip the directory and slash. */
+   }
+   else
+      return -1;
+   if (files == NULL)
+      n = 0;
+
+   /* Sort them by name. */
+   entries = malloc( sizeof(NdataEntry) * MAX(n,1) );
+   for (i=0; i<n; i++) {
+      entries[i].name  = files[i];
+      entries[i].index = (index != NULL) ? index[i] : -1;
+   }
+   qsort( entries, n, sizeof(NdataEntry), ndata_indexSort );
+
+   /* Hash them. */
+   ndata_fileList  = malloc( sizeof(char*) * MAX(n,1) );
+   ndata_fileIndex = malloc( sizeof(int) * MAX(n,1) );
+   ndata_fileNList = n;
+   ndata_index     = nhash_create( n );
+   for (i=0; i<n; i++) {
+      if (len > 0) {
+         ndata_fileList[i] = strdup( &entries[i].name[len] );
+         free( entries[i].name );
       }
+      else
+         ndata_fileList[i] = entries[i].name;
+      ndata_fileIndex[i] = entries[i].index;
+      nhash_set( ndata_index, ndata_fileList[i], i );
+   }
 
-      /* We can also try default location. */
-      if (ndata_source <= NDATA_SRC_NDATADEF) {
-         buf = strdup( NDATA_DEF );
-         nsnprintf( path, sizeof(path), "%s/%s", nfile_dirname(buf), filename );
-         free(buf);
-         if (nfile_fileExists( path )) {
-            buf = nfile_readFile( &nbuf, path );
-            if (buf != NULL) {
-               ndata_source = NDATA_SRC_NDATADEF;
-               ndata_loadedfile = 1;
-               *filesize = nbuf;
-               return buf;
-            }
-         }
-      }
+   free( entries );
+   free( files );
+   free( index );
+   return 0;
+}
 
-      /* Try binary location. */
-      if (ndata_source <= NDATA_SRC_BINARY) {
-         buf = strdup( naev_binary() );
-         nsnprintf( path, sizeof(path), "%s/%s", nfile_dirname(buf), filename );
-         free(buf);
-         if (nfile_fileExists( path )) {
-            buf = nfile_readFile( &nbuf, path );
-            if (buf != NULL) {
-               ndata_source = NDATA_SRC_BINARY;
-               ndata_loadedfile = 1;
-               *filesize = nbuf;
-               return buf;
-            }
-         }
-      }
 
-      /* Load the ndata archive. */
-      ndata_openFile();
+/**
+ * @brief Checks to see if a file name is covered by the index.
+ */
+static int ndata_isIndexed( const char *filename )
+{
+   return (ndata_archive != NULL) ||
+      (strncmp( filename, NDATA_INDEX_ROOT, strlen(NDATA_INDEX_ROOT) )==0);
+}
+
+
+/**
+ * @brief Gets the path of a loose file.
+ *
+ *    @param[out] path Where to write the path.
+ *    @param len Size of path.
+ *    @param filename Name of the file in the data.
+ */
+static void ndata_loosePath( char *path, size_t len, const char *filename )
+{
+   if (strcmp( ndata_loose, "." )==0)
+      nsnprintf( path, len, "%s", filename );
+   else
+      nsnprintf( path, len, "%s/%s", ndata_loose, filename );
+}
+
+
+/**
+ * @brief Gets the name a file has in the index.
+ *
+ * Drops leading "./" and collapses repeated separators, so paths built by
+ * joining a slash terminated directory still find the file.
+ *
+ *    @param[out] name Where to write the name if it needs changing.
+ *    @param len Size of name.
+ *    @param filename Name of the file as asked for.
+ *    @return The name to look up, either filename or name.
+ */
+static const char* ndata_canonical( char *name, size_t len, const char *filename )
+{
+   const char *c;
+   size_t i;
+
+   /* Nothing to change in the common case. */
+   if ((strncmp( filename, "./", 2 ) != 0) && (strstr( filename, "//" ) == NULL))
+      return filename;
+
+   c = filename;
+   while (strncmp( c, "./", 2 )==0)
+      for (c+=2; *c == '/'; c++);
+   for (i=0; (*c != '\0') && (i+1 < len); c++) {
+      if ((*c == '/') && (i > 0) && (name[i-1] == '/'))
+         continue;
+      name[i++] = *c;
    }
+   name[i] = '\0';
+   return name;
+}
+
+
+/**
+ * @brief Checks to see if a file is in the NDATA.
+ *    @param filename Name of the file to check.
+ *    @return 1 if the file exists, 0 otherwise.
+ */
+int ndata_exists( const char* filename )
+{
+   char path[PATH_MAX], name[PATH_MAX];
 
-   /* Wasn't able to open the file. */
-   if (ndata_archive == NULL) {
+   if (ndata_indexBuild())
+      return 0;
+
+   /* Look it up. */
+   filename = ndata_canonical( name, sizeof(name), filename );
+   if (ndata_isIndexed( filename ))
+      return (nhash_get( ndata_index, filename ) >= 0);
+
+   /* Not something the index knows about. */
+   ndata_loosePath( path, sizeof(path), filename );
+   return nfile_fileExists( "%s", path );
+}
+
+
+/**
+ * @brief Reads a file from the ndata.
+ *
+ *    @param filename Name of the file to read.
+ *    @param[out] filesize Stores the size of the file.
+ *    @return The file data or NULL on error.
+ */
+void* ndata_read( const char* filename, size_t *filesize )
+{
+   char path[PATH_MAX], name[PATH_MAX];
+   void *buf;
+   int i;
+
+   *filesize = 0;
+   filename  = ndata_canonical( name, sizeof(name), filename );
+   if (ndata_indexBuild() ||
+         (ndata_isIndexed( filename ) && !ndata_exists( filename ))) {
       WARN(_("Unable to open file '%s': not found."), filename);
-      *filesize = 0;
       return NULL;
    }
 
@@ -763,76 +928,122 @@ void* ndata_read( const char* filename, size_t *filesize )
    ndata_loadedfile = 1;
 
    /* Get data from ndata archive. */
-   return nzip_readFile( ndata_archive, filename, filesize );
+   if (ndata_archive != NULL) {
+      i = nhash_get( ndata_index, filename );
+      return nzip_readIndex( ndata_archive, ndata_fileIndex[i], filesize );
+   }
+
+   /* Get data from the loose files. */
+   ndata_loosePath( path, sizeof(path), filename );
+   buf = nfile_readFile( filesize, "%s", path );
+   if (buf == NULL)
+      WARN(_("Unable to open file '%s': not found."), filename);
+   return buf;
 }
 
 
 /**
- * @brief Creates an rwops from a file in the ndata.
+ * @brief Maps a file from the ndata into memory without copying it.
  *
- *    @param filename Name of the file to create rwops of.
- *    @return rwops that accesses the file in the ndata.
+ * Loose files are mapped read-only from the disk, anything else is read like
+ * ndata_read() does. Either way the data must be released with
+ * ndata_unmap() and not written to.
+ *
+ *    @param filename Name of the file to map.
+ *    @param[out] filesize Stores the size of the file.
+ *    @return The file data or NULL on error.
  */
-SDL_RWops *ndata_rwops( const char* filename )
+const void* ndata_map( const char* filename, size_t *filesize )
 {
-   char path[PATH_MAX], *tmp;
-   SDL_RWops *rw;
-
-   if (ndata_archive == NULL) {
+#if HAS_POSIX
+   char path[PATH_MAX];
+   struct stat sb;
+   void *data;
+   int fd;
+
+   if ((ndata_indexBuild() == 0) && (ndata_archive == NULL) &&
+         (!ndata_isIndexed( filename ) || ndata_exists( filename ))) {
+      ndata_loosePath( path, sizeof(path), filename );
+      fd = open( path, O_RDONLY );
+      if (fd >= 0) {
+         data = MAP_FAILED;
+         if ((fstat( fd, &sb ) == 0) && (sb.st_size > 0))
+            data = mmap( NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+         close( fd );
+
+         if (data != MAP_FAILED) {
+            /* Remember it so ndata_unmap() knows not to free it. */
+            SDL_mutexP( ndata_lock );
+            if (ndata_nmaps >= ndata_mmaps) {
+               ndata_mmaps = MAX( 16, 2*ndata_mmaps );
+               ndata_maps  = realloc( ndata_maps, sizeof(void*) * ndata_mmaps );
+            }
+            ndata_maps[ ndata_nmaps++ ] = data;
+            SDL_mutexV( ndata_lock );
 
-      /* Try to open from file. */
-      if (ndata_source <= NDATA_SRC_LAIDOUT) {
-         rw = SDL_RWFromFile( filename, "rb" );
-         if (rw != NULL) {
             ndata_loadedfile = 1;
-            return rw;
+            *filesize = sb.st_size;
+            return data;
          }
       }
+   }
+#endif /* HAS_POSIX */
 
-      /* Try to open from dirname. */
-      if ((ndata_filename == NULL) && (ndata_dirname != NULL) &&
-            (ndata_source <= NDATA_SRC_DIRNAME)) {
-         nsnprintf( path, sizeof(path), "%s/%s", ndata_dirname, filename );
-         rw = SDL_RWFromFile( path, "rb" );
-         if (rw != NULL) {
-            ndata_source = NDATA_SRC_DIRNAME;
-            ndata_loadedfile = 1;
-            return rw;
-         }
-      }
+   return ndata_read( filename, filesize );
+}
 
-      /* Try to open from def. */
-      if (ndata_source <= NDATA_SRC_NDATADEF) {
-         tmp = strdup( NDATA_DEF );
-         nsnprintf( path, sizeof(path), "%s/%s", nfile_dirname(tmp), filename );
-         free(tmp);
-         rw = SDL_RWFromFile( path, "rb" );
-         if (rw != NULL) {
-            ndata_source = NDATA_SRC_NDATADEF;
-            ndata_loadedfile = 1;
-            return rw;
-         }
-      }
 
-      /* Try to open from binary. */
-      if (ndata_source <= NDATA_SRC_BINARY) {
-         tmp = strdup( naev_binary() );
-         nsnprintf( path, sizeof(path), "%s/%s", nfile_dirname(tmp), filename );
-         free(tmp);
-         rw = SDL_RWFromFile( path, "rb" );
-         if (rw != NULL) {
-            ndata_source = NDATA_SRC_BINARY;
-            ndata_loadedfile = 1;
-            return rw;
+/**
+ * @brief Releases data gotten with ndata_map().
+ *
+ *    @param data Data to release, can be NULL.
+ *    @param filesize Size ndata_map() gave for it.
+ */
+void ndata_unmap( const void* data, size_t filesize )
+{
+#if HAS_POSIX
+   int i;
+
+   if (data == NULL)
+      return;
+
+   SDL_mutexP( ndata_lock );
+   for (i=ndata_nmaps-1; i>=0; i--) {
+      if (ndata_maps[i] == data) {
+         ndata_maps[i] = ndata_maps[ --ndata_nmaps ];
+         if (ndata_nmaps == 0) {
+            free( ndata_maps );
+            ndata_maps  = NULL;
+            ndata_mmaps = 0;
          }
+         SDL_mutexV( ndata_lock );
+         munmap( (void*)data, filesize );
+         return;
       }
-
-      /* Load the ndata archive. */
-      ndata_openFile();
    }
+   SDL_mutexV( ndata_lock );
+#else /* HAS_POSIX */
+   (void) filesize;
+#endif /* HAS_POSIX */
+
+   free( (void*)data );
+}
+
+
+/**
+ * @brief Creates an rwops from a file in the ndata.
+ *
+ *    @param filename Name of the file to create rwops of.
+ *    @return rwops that accesses the file in the ndata.
+ */
+SDL_RWops *ndata_rwops( const char* filename )
+{
+   char path[PATH_MAX], name[PATH_MAX];
+   SDL_RWops *rw;
 
-   /* Wasn't able to open the file. */
-   if (ndata_archive == NULL) {
+   filename = ndata_canonical( name, sizeof(name), filename );
+   if (ndata_indexBuild() ||
+         (ndata_isIndexed( filename ) && !ndata_exists( filename ))) {
       WARN(_("Unable to open file '%s': not found."), filename);
       return NULL;
    }
@@ -840,7 +1051,14 @@ SDL_RWops *ndata_rwops( const char* filename )
    /* Mark that we loaded a file. */
    ndata_loadedfile = 1;
 
-   return nzip_rwops( ndata_archive, filename );
+   if (ndata_archive != NULL)
+      return nzip_rwops( ndata_archive, filename );
+
+   ndata_loosePath( path, sizeof(path), filename );
+   rw = SDL_RWFromFile( path, "rb" );
+   if (rw == NULL)
+      WARN(_("Unable to open file '%s': not found."), filename);
+   return rw;
 }
 
 
@@ -939,87 +1157,56 @@ static char** filterList( const char** list, int nlist,
  */
 static char** ndata_listBackend( const char* path, size_t* nfiles, int recursive )
 {
-   (void) path;
-   char **files, **tfiles, buf[PATH_MAX], *tmp;
-   size_t n;
+   char **files, **tfiles, buf[PATH_MAX];
+   size_t i, n, lo, hi, mid, len;
    char** (*nfile_readFunc) ( size_t* nfiles, const char* path, ... ) = NULL;
 
-   if (recursive)
-      nfile_readFunc = nfile_readDirRecursive;
-   else
-      nfile_readFunc = nfile_readDir;
-
-   /* Already loaded the list. */
-   if (ndata_fileList != NULL)
-      return filterList( (const char**) ndata_fileList, ndata_fileNList, path, nfiles, recursive );
-
-   /* See if can load from local directory. */
-   if (ndata_archive == NULL) {
-
-      /* Local search. */
-      if (ndata_source <= NDATA_SRC_LAIDOUT) {
-         files = nfile_readFunc( &n, path );
-         if (files != NULL) {
-            *nfiles = n;
-            return files;
-         }
-      }
-
-      /* Dirname search. */
-      if ((ndata_filename == NULL) && (ndata_dirname != NULL) &&
-            (ndata_source <= NDATA_SRC_DIRNAME)) {
-         nsnprintf( buf, sizeof(buf), "%s/%s", ndata_dirname, path );
-         tfiles = nfile_readFunc( &n, buf );
-         files = stripPath( (const char**)tfiles, n, ndata_dirname );
-         free(tfiles);
-         if (files != NULL) {
-            *nfiles = n;
-            return files;
-         }
-      }
-
-      /* NDATA_DEF. */
-      if (ndata_source <= NDATA_SRC_NDATADEF) {
-         tmp = strdup( NDATA_DEF );
-         nsnprintf( buf, sizeof(buf), "%s/%s", nfile_dirname(tmp), path );
-         tfiles = nfile_readFunc( &n, buf );
-         files = stripPath( (const char**)tfiles, n, tmp );
-         free(tmp);
-         free(tfiles);
-         if (files != NULL) {
-            *nfiles = n;
-            return files;
-         }
-      }
+   *nfiles = 0;
+   if (ndata_indexBuild())
+      return NULL;
 
-      /* Binary. */
-      if (ndata_source <= NDATA_SRC_BINARY) {
-         tmp = strdup( naev_binary() );
-         nsnprintf( buf, sizeof(buf), "%s/%s", nfile_dirname(tmp), path );
-         tfiles = nfile_readFunc( &n, buf );
-         files = stripPath( (const char**)tfiles, n, nfile_dirname(tmp) );
-         free(tmp);
-         free(tfiles);
-         if (files != NULL) {
-            *nfiles = n;
-            return files;
-         }
+   if (ndata_isIndexed( path )) {
+      /* Directories are always slash terminated in the index. */
+      len = strlen( path );
+      if ((len > 0) && !nfile_isSeparator( path[len-1] ))
+         nsnprintf( buf, sizeof(buf), "%s/", path );
+      else
+         nsnprintf( buf, sizeof(buf), "%s", path );
+      len = strlen( buf );
+
+      /* The index is sorted, so the files below path are all together. */
+      lo = 0;
+      hi = ndata_fileNList;
+      while (lo < hi) {
+         mid = (lo+hi) / 2;
+         if (strcmp( ndata_fileList[mid], buf ) < 0)
+            lo = mid+1;
+         else
+            hi = mid;
       }
+      for (hi=lo; (hi<ndata_fileNList) && (strncmp( ndata_fileList[hi], buf, len )==0); hi++);
 
-      /* Open ndata archive. */
-      ndata_openFile();
+      return filterList( (const char**) &ndata_fileList[lo], hi-lo, buf, nfiles, recursive );
    }
 
-   /* Wasn't able to open the file. */
-   if (ndata_archive == NULL) {
-      *nfiles = 0;
-      return NULL;
+   /* Not in the index, read the directory. */
+   if (recursive)
+      nfile_readFunc = nfile_readDirRecursive;
+   else
+      nfile_readFunc = nfile_readDir;
+   if (strcmp( ndata_loose, "." )==0)
+      files = nfile_readFunc( &n, path );
+   else {
+      nsnprintf( buf, sizeof(buf), "%s/%s", ndata_loose, path );
+      tfiles = nfile_readFunc( &n, buf );
+      files  = stripPath( (const char**)tfiles, n, ndata_loose );
+      for (i=0; i<n; i++)
+         free( tfiles[i] );
+      free( tfiles );
    }
-
-   /* Load list. */
-   ndata_fileList = nzip_listFiles( ndata_archive, &ndata_fileNList );
-
-   return filterList( (const char**) ndata_fileList, ndata_fileNList, path, nfiles, recursive );
+   if (files != NULL)
+      *nfiles = n;
+   return files;
 }
 
 /**
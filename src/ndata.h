@@ -54,6 +54,7 @@
 #define MUSIC_LUA_PATH           "dat/snd/music.lua" /**< Lua music control file. */
 
 #define START_DATA_PATH          "dat/start.xml" /**< Path to module start file. */
+#define SCENARIO_DATA_PATH       "dat/scenarios/" /**< Path to headless benchmark scenarios. */
 
 #define FONT_DEFAULT_PATH        "dat/font.ttf" /**< Default font path. */
 #define FONT_MONOSPACE_PATH      "dat/mono.ttf" /**< Default monospace font path. */
@@ -81,6 +82,8 @@ const char* ndata_name (void);
  */
 int ndata_exists( const char* filename );
 void* ndata_read( const char* filename, size_t *filesize );
+const void* ndata_map( const char* filename, size_t *filesize );
+void ndata_unmap( const void* data, size_t filesize );
 char** ndata_list( const char *path, size_t* nfiles );
 char** ndata_listRecursive( const char *path, size_t* nfiles );
 void ndata_sortName( char **files, size_t nfiles );
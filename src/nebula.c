@@ -29,6 +29,7 @@
 #include "camera.h"
 #include "nstring.h"
 #include "ndata.h"
+#include "profile.h"
 
 
 #define NEBULA_Z             16 /**< Z plane */
@@ -420,6 +421,7 @@ static void nebu_renderMultitexture( const double dt )
          sizeof(GL_FLOAT) * 1*2*4, 2, GL_FLOAT, 0 );
    gl_vboActivateOffset( nebu_vboBG, GL_TEXTURE1,
          sizeof(GL_FLOAT) * 2*2*4, 2, GL_FLOAT, 0 );
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
    gl_vboDeactivate();
 
@@ -611,6 +613,7 @@ void nebu_renderOverlay( const double dt )
    gl_vboActivateOffset( nebu_vboOverlay, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
    gl_vboActivateOffset( nebu_vboOverlay, GL_COLOR_ARRAY,
          sizeof(GLfloat)*2*18, 4, GL_FLOAT, 0 );
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_TRIANGLE_FAN, 0, 18 );
 
 
@@ -624,18 +627,22 @@ void nebu_renderOverlay( const double dt )
    /* Top left. */
    gl_vboActivateOffset( nebu_vboOverlay, GL_VERTEX_ARRAY,
          sizeof(GLfloat)*((2+4)*18 + 0*2*7), 2, GL_FLOAT, 0 );
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_TRIANGLE_FAN, 0, 7 );
    /* Top right. */
    gl_vboActivateOffset( nebu_vboOverlay, GL_VERTEX_ARRAY,
          sizeof(GLfloat)*((2+4)*18 + 1*2*7), 2, GL_FLOAT, 0 );
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_TRIANGLE_FAN, 0, 7 );
    /* Bottom right. */
    gl_vboActivateOffset( nebu_vboOverlay, GL_VERTEX_ARRAY,
          sizeof(GLfloat)*((2+4)*18 + 2*2*7), 2, GL_FLOAT, 0 );
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_TRIANGLE_FAN, 0, 7 );
    /* Bottom left. */
    gl_vboActivateOffset( nebu_vboOverlay, GL_VERTEX_ARRAY,
          sizeof(GLfloat)*((2+4)*18 + 3*2*7), 2, GL_FLOAT, 0 );
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_TRIANGLE_FAN, 0, 7 );
 
    gl_vboDeactivate();
@@ -0,0 +1,297 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file nhash.c
+ *
+ * @brief Name to index hash tables.
+ *
+ * Open addressing with linear probing over a power of two sized table kept
+ * at most half full. Removed slots are left as tombstones so probe chains
+ * stay intact, they get reused on insertion and dropped when the table
+ * grows.
+ */
+
+#include "nhash.h"
+
+#include "naev.h"
+
+#include <stdint.h>
+#include "nstring.h"
+
+#include "log.h"
+
+
+#define NHASH_MIN       32 /**< Smallest table. */
+
+#define FNV_OFFSET      2166136261u /**< FNV-1a offset basis. */
+#define FNV_PRIME       16777619u /**< FNV-1a prime. */
+
+
+/**
+ * @brief A slot of the table.
+ */
+typedef struct NHashSlot_ {
+   char *name; /**< Key, NULL if empty or removed. */
+   uint32_t hash; /**< Hash of the key. */
+   int index; /**< Value, -1 if empty and -2 if removed. */
+} NHashSlot;
+
+
+/**
+ * @brief A name to index table.
+ */
+struct NHash_ {
+   NHashSlot *slots; /**< Slots, mask+1 of them. */
+   uint32_t mask; /**< Table size minus one. */
+   int n; /**< Keys in the table. */
+   int used; /**< Slots that are not empty, including tombstones. */
+};
+
+
+/*
+ * Prototypes.
+ */
+static uint32_t nhash_hash( const char *name );
+static NHashSlot* nhash_find( const NHash *h, const char *name, uint32_t hash );
+static void nhash_resize( NHash *h, uint32_t size );
+
+
+/**
+ * @brief Hashes a name with FNV-1a.
+ */
+static uint32_t nhash_hash( const char *name )
+{
+   const unsigned char *c;
+   uint32_t hash;
+
+   hash = FNV_OFFSET;
+   for (c=(const unsigned char*)name; *c != '\0'; c++) {
+      hash ^= *c;
+      hash *= FNV_PRIME;
+   }
+   return hash;
+}
+
+
+/**
+ * @brief Creates a table.
+ *
+ *    @param size Number of names expected, it grows as needed.
+ *    @return The new table.
+ */
+NHash* nhash_create( int size )
+{
+   NHash *h;
+   uint32_t n;
+
+   h = calloc( 1, sizeof(NHash) );
+   for (n=NHASH_MIN; (int)n < 2*size; n *= 2);
+   nhash_resize( h, n );
+   return h;
+}
+
+
+/**
+ * @brief Frees a table.
+ *
+ *    @param h Table to free, can be NULL.
+ */
+void nhash_free( NHash *h )
+{
+   if (h == NULL)
+      return;
+   nhash_clear( h );
+   free( h->slots );
+   free( h );
+}
+
+
+/**
+ * @brief Removes all the names from a table.
+ *
+ *    @param h Table to clear.
+ */
+void nhash_clear( NHash *h )
+{
+   uint32_t i;
+
+   for (i=0; i<=h->mask; i++) {
+      free( h->slots[i].name );
+      h->slots[i].name  = NULL;
+      h->slots[i].index = -1;
+   }
+   h->n     = 0;
+   h->used  = 0;
+}
+
+
+/**
+ * @brief Gets the number of names in a table.
+ */
+int nhash_size( const NHash *h )
+{
+   return h->n;
+}
+
+
+/**
+ * @brief Finds the slot holding a name.
+ *
+ *    @return The slot or NULL if the name is not in the table.
+ */
+static NHashSlot* nhash_find( const NHash *h, const char *name, uint32_t hash )
+{
+   NHashSlot *s;
+   uint32_t i;
+
+   for (i=hash & h->mask; ; i=(i+1) & h->mask) {
+      s = &h->slots[i];
+      if (s->index == -1)
+         return NULL;
+      if ((s->name != NULL) && (s->hash == hash) && (strcmp(s->name, name)==0))
+         return s;
+   }
+}
+
+
+/**
+ * @brief Rehashes a table into a new size, dropping the tombstones.
+ */
+static void nhash_resize( NHash *h, uint32_t size )
+{
+   NHashSlot *old, *s;
+   uint32_t i, j, oldsize;
+
+   old      = h->slots;
+   oldsize  = (old != NULL) ? h->mask+1 : 0;
+
+   h->slots = malloc( sizeof(NHashSlot) * size );
+   h->mask  = size-1;
+   h->used  = h->n;
+   for (i=0; i<size; i++) {
+      h->slots[i].name  = NULL;
+      h->slots[i].index = -1;
+   }
+
+   for (i=0; i<oldsize; i++) {
+      if (old[i].name == NULL)
+         continue;
+      for (j=old[i].hash & h->mask; h->slots[j].index != -1; j=(j+1) & h->mask);
+      s  = &h->slots[j];
+      *s = old[i];
+   }
+   free( old );
+}
+
+
+/**
+ * @brief Maps a name to an index, replacing any previous mapping.
+ *
+ *    @param h Table to set in.
+ *    @param name Name to map.
+ *    @param index Index to map it to.
+ */
+void nhash_set( NHash *h, const char *name, int index )
+{
+   NHashSlot *s, *tomb;
+   uint32_t hash, i;
+
+   if (name == NULL) {
+      WARN(_("Trying to hash NULL name."));
+      return;
+   }
+
+   hash  = nhash_hash( name );
+   tomb  = NULL;
+   for (i=hash & h->mask; ; i=(i+1) & h->mask) {
+      s = &h->slots[i];
+      if (s->index == -1)
+         break;
+      if (s->name == NULL) {
+         if (tomb == NULL)
+            tomb = s;
+      }
+      else if ((s->hash == hash) && (strcmp(s->name, name)==0)) {
+         s->index = index;
+         return;
+      }
+   }
+
+   /* New name, reuse a tombstone if one was on the way. */
+   if (tomb != NULL)
+      s = tomb;
+   else
+      h->used++;
+   s->name  = strdup( name );
+   s->hash  = hash;
+   s->index = index;
+   h->n++;
+
+   if (2*h->used > (int)(h->mask+1))
+      nhash_resize( h, (2*h->n > (int)(h->mask+1)/2) ? 2*(h->mask+1) : h->mask+1 );
+}
+
+
+/**
+ * @brief Gets the index a name maps to.
+ *
+ *    @param h Table to look in, can be NULL.
+ *    @param name Name to look up.
+ *    @return The index or -1 if the name is not in the table.
+ */
+int nhash_get( const NHash *h, const char *name )
+{
+   NHashSlot *s;
+
+   if ((h == NULL) || (name == NULL))
+      return -1;
+
+   s = nhash_find( h, name, nhash_hash( name ) );
+   return (s != NULL) ? s->index : -1;
+}
+
+
+/**
+ * @brief Removes a name.
+ *
+ *    @param h Table to remove from.
+ *    @param name Name to remove.
+ *    @return The index it mapped to or -1 if it was not in the table.
+ */
+int nhash_remove( NHash *h, const char *name )
+{
+   NHashSlot *s;
+   int index;
+
+   if (name == NULL)
+      return -1;
+
+   s = nhash_find( h, name, nhash_hash( name ) );
+   if (s == NULL)
+      return -1;
+
+   index    = s->index;
+   free( s->name );
+   s->name  = NULL;
+   s->index = -2;
+   h->n--;
+   return index;
+}
+
+
+/**
+ * @brief Changes the name an index is mapped under.
+ *
+ *    @param h Table to rename in.
+ *    @param oldname Previous name, can be NULL for a new object.
+ *    @param newname New name.
+ *    @param index Index of the object.
+ */
+void nhash_rename( NHash *h, const char *oldname, const char *newname, int index )
+{
+   if ((oldname != NULL) && (nhash_get( h, oldname ) == index))
+      nhash_remove( h, oldname );
+   nhash_set( h, newname, index );
+}
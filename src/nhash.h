@@ -0,0 +1,29 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+#ifndef NHASH_H
+#  define NHASH_H
+
+
+/*
+ * Maps names to indexes into the stack that owns the named objects, so name
+ * lookups don't have to scan the stack. Keys are copied into the table so it
+ * never points into memory the stack might free or move.
+ */
+typedef struct NHash_ NHash;
+
+
+NHash* nhash_create( int size );
+void nhash_free( NHash *h );
+void nhash_clear( NHash *h );
+int nhash_size( const NHash *h );
+
+void nhash_set( NHash *h, const char *name, int index );
+int nhash_get( const NHash *h, const char *name );
+int nhash_remove( NHash *h, const char *name );
+void nhash_rename( NHash *h, const char *oldname, const char *newname, int index );
+
+
+#endif /* NHASH_H */
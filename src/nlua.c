@@ -32,16 +32,30 @@
 #include "nlua_commodity.h"
 #include "nlua_cli.h"
 #include "nstring.h"
+#include "profile.h"
 
 
 lua_State *naevL = NULL;
 nlua_env __NLUA_CURENV = LUA_NOREF;
+static int nlua_chunks = LUA_NOREF; /**< Registry table of compiled chunks by path. */
+
+
+/**
+ * @brief Growable buffer lua_dump() writes to.
+ */
+typedef struct nlua_DumpBuf_ {
+   char *data; /**< Bytecode. */
+   size_t size; /**< Bytes written. */
+   size_t max; /**< Bytes allocated. */
+} nlua_DumpBuf;
 
 
 /*
  * prototypes
  */
 static int nlua_packfileLoader( lua_State* L );
+static int nlua_dumpWriter( lua_State *L, const void *p, size_t sz, void *ud );
+static int nlua_loadChunk( lua_State *L, const char *path );
 static lua_State *nlua_newState (void); /* creates a new state */
 static int nlua_loadBasic( lua_State* L );
 static int nlua_errTrace( lua_State *L );
@@ -98,6 +112,9 @@ static int nlua_ngettext( lua_State *L )
 void lua_init(void) {
    naevL = nlua_newState();
    nlua_loadBasic(naevL);
+
+   lua_newtable(naevL);
+   nlua_chunks = luaL_ref(naevL, LUA_REGISTRYINDEX);
 }
 
 
@@ -107,6 +124,7 @@ void lua_init(void) {
 void lua_exit(void) {
    lua_close(naevL);
    naevL = NULL;
+   nlua_chunks = LUA_NOREF;
 }
 
 
@@ -132,6 +150,114 @@ int nlua_dobufenv(nlua_env env,
 }
 
 
+/*
+ * @brief Run a Lua file from the ndata in Lua environment.
+ *
+ * Unlike nlua_dobufenv() the file is only read and compiled the first time,
+ *  later runs reuse the bytecode.
+ *
+ *    @param env Lua environment.
+ *    @param path Path of the file in the ndata.
+ *    @return 0 on success, -1 on error with the message on the stack or -2
+ *            if the file was not found.
+ */
+int nlua_dochunkenv(nlua_env env, const char *path) {
+   int ret;
+
+   ret = nlua_loadChunk(naevL, path);
+   if (ret == LUA_ERRFILE)
+      return -2;
+   if (ret != 0)
+      return -1;
+   nlua_pushenv(env);
+   lua_setfenv(naevL, -2);
+   if (nlua_pcall(env, 0, LUA_MULTRET) != 0)
+      return -1;
+   return 0;
+}
+
+
+/**
+ * @brief Appends the output of lua_dump() to a nlua_DumpBuf.
+ */
+static int nlua_dumpWriter( lua_State *L, const void *p, size_t sz, void *ud )
+{
+   nlua_DumpBuf *db;
+   char *data;
+   (void) L;
+
+   db = (nlua_DumpBuf*) ud;
+   if (db->size + sz > db->max) {
+      data = realloc( db->data, MAX( 2*db->max, db->size + sz ) );
+      if (data == NULL)
+         return 1;
+      db->data = data;
+      db->max  = MAX( 2*db->max, db->size + sz );
+   }
+   memcpy( &db->data[ db->size ], p, sz );
+   db->size += sz;
+   return 0;
+}
+
+
+/**
+ * @brief Pushes the compiled chunk of a Lua file in the ndata.
+ *
+ * The first load parses the source and keeps the bytecode keyed by path,
+ *  afterwards a fresh function is made from the bytecode without touching
+ *  the ndata or the parser. Bytecode keeps the debug info, so error
+ *  messages and tracebacks are unchanged.
+ *
+ *    @param L State to push the chunk in.
+ *    @param path Path of the file in the ndata.
+ *    @return 0 on success, LUA_ERRFILE if the file was not found (nothing is
+ *            pushed) or the luaL_loadbuffer() error with the message pushed.
+ */
+static int nlua_loadChunk( lua_State *L, const char *path )
+{
+   nlua_DumpBuf db;
+   const char *bc;
+   char *buf;
+   size_t size;
+   int ret;
+
+   /* Already compiled. */
+   lua_rawgeti(L, LUA_REGISTRYINDEX, nlua_chunks); /* c */
+   lua_getfield(L, -1, path); /* c, bc */
+   if (lua_isstring(L, -1)) {
+      bc  = lua_tolstring(L, -1, &size);
+      ret = luaL_loadbuffer(L, bc, size, path); /* c, bc, f */
+      lua_replace(L, -3); /* f, bc */
+      lua_pop(L, 1); /* f */
+      return ret;
+   }
+   lua_pop(L, 1); /* c */
+
+   /* Compile the source. */
+   buf = ndata_read( path, &size );
+   if (buf == NULL) {
+      lua_pop(L, 1); /* */
+      return LUA_ERRFILE;
+   }
+   ret = luaL_loadbuffer(L, buf, size, path); /* c, f */
+   free(buf);
+   if (ret != 0) {
+      lua_remove(L, -2); /* err */
+      return ret;
+   }
+
+   /* Keep the bytecode, a failed dump only means it gets compiled again. */
+   memset( &db, 0, sizeof(db) );
+   if (lua_dump(L, nlua_dumpWriter, &db) == 0) {
+      lua_pushlstring(L, db.data, db.size); /* c, f, bc */
+      lua_setfield(L, -3, path); /* c, f */
+   }
+   free(db.data);
+   lua_remove(L, -2); /* f */
+   return 0;
+}
+
+
 /*
  * @brief Run code a file in Lua environment.
  *
@@ -339,9 +465,7 @@ static int nlua_packfileLoader( lua_State* L )
 {
    const char *filename;
    char *path_filename;
-   char *buf;
-   int len;
-   size_t bufsize;
+   int len, ret;
    int envtab;
 
    /* Environment table to load module into */
@@ -368,28 +492,28 @@ static int nlua_packfileLoader( lua_State* L )
    }
 
    /* Try to locate the data directly */
-   buf = NULL;
+   ret = LUA_ERRFILE;
    if (ndata_exists( filename ))
-      buf = ndata_read( filename, &bufsize );
+      ret = nlua_loadChunk( L, filename );
    /* If failed to load or doesn't exist try again with INCLUDE_PATH prefix. */
-   if (buf == NULL) {
+   if (ret == LUA_ERRFILE) {
       /* Try to locate the data in the data path */
       len           = strlen(LUA_INCLUDE_PATH)+strlen(filename)+2;
       path_filename = malloc( len );
       nsnprintf( path_filename, len, "%s%s", LUA_INCLUDE_PATH, filename );
       if (ndata_exists( path_filename ))
-         buf = ndata_read( path_filename, &bufsize );
+         ret = nlua_loadChunk( L, path_filename );
       free( path_filename );
    }
 
-   /* Must have buf by now. */
-   if (buf == NULL) {
+   /* Must have the chunk by now. */
+   if (ret == LUA_ERRFILE) {
       DEBUG(_("include(): %s not found in ndata."), filename);
       luaL_error(L, _("include(): %s not found in ndata."), filename);
       return 1;
    }
 
-   if (luaL_loadbuffer(L, buf, bufsize, filename) != 0) {
+   if (ret != 0) {
       lua_error(L);
       return 1;
    }
@@ -415,8 +539,7 @@ static int nlua_packfileLoader( lua_State* L )
    lua_setfield(L, -2, filename);   /* val, t */
    lua_pop(L, 1); /* val */
 
-   /* cleanup, success */
-   free(buf);
+   /* success */
    return 1;
 }
 
@@ -527,6 +650,7 @@ int nlua_pcall( nlua_env env, int nargs, int nresults ) {
    prev_env = __NLUA_CURENV;
    __NLUA_CURENV = env;
 
+   profile_count( PROFILE_LUA, 1 );
    ret = lua_pcall(naevL, nargs, nresults, errf);
 
    __NLUA_CURENV = prev_env;
@@ -18,6 +18,7 @@
 #include "nlua_vec2.h"
 #include "nlua_system.h"
 #include "land_outfits.h"
+#include "map.h"
 #include "log.h"
 
 
@@ -450,8 +451,10 @@ static int jumpL_setKnown( lua_State *L )
       jp_rmFlag( jp, JP_KNOWN );
 
    /* Update outfits image array. */
-   if (changed)
+   if (changed) {
       outfits_updateEquipmentOutfits();
+      map_jumpDistInvalidate( 1 );
+   }
 
    return 0;
 }
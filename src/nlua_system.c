@@ -383,31 +383,28 @@ static int systemL_nebula( lua_State *L )
  */
 static int systemL_jumpdistance( lua_State *L )
 {
-   StarSystem *sys, *sysp;
-   StarSystem **s;
+   StarSystem *sys, *goal;
    int jumps;
-   const char *start, *goal;
    int h, k;
 
    sys = luaL_validsystem(L,1);
-   start = sys->name;
    h   = lua_toboolean(L,3);
    k   = !lua_toboolean(L,4);
 
    if (lua_gettop(L) > 1) {
       if (lua_isstring(L,2))
-         goal = lua_tostring(L,2);
-      else if (lua_issystem(L,2)) {
-         sysp = luaL_validsystem(L,2);
-         goal = sysp->name;
-      }
+         goal = system_get( lua_tostring(L,2) );
+      else if (lua_issystem(L,2))
+         goal = luaL_validsystem(L,2);
       else NLUA_INVALID_PARAMETER(L);
    }
    else
-      goal = cur_system->name;
+      goal = cur_system;
 
-   s = map_getJumpPath( &jumps, start, goal, k, h, NULL );
-   free(s);
+   if (goal == NULL)
+      jumps = 0;
+   else
+      jumps = map_getJumpDist( sys, goal, k, h );
 
    lua_pushnumber(L,jumps);
    return 1;
@@ -797,6 +794,7 @@ static int systemL_setknown( lua_State *L )
             jp_rmFlag( &sys->jumps[i], JP_KNOWN );
      }
    }
+   map_jumpDistInvalidate( 1 );
 
    /* Update outfits image array. */
    outfits_updateEquipmentOutfits();
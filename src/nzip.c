@@ -92,6 +92,31 @@ int nzip_hasFile ( struct zip* arc, const char* filename )
  *    @return A pointer to the file contents in memory
  */
 void* nzip_readFile ( struct zip* arc, const char* filename, size_t* size )
+{
+   int index;
+   int flags = 0;
+
+   index = zip_name_locate ( arc, filename, flags );
+   if ( index < 0 ) {
+      WARN ( _("Error reading %s from archive"), filename );
+      WARN ( "%s", zip_strerror ( arc ) );
+      return NULL;
+   }
+
+   return nzip_readIndex ( arc, index, size );
+}
+
+/**
+ * @brief Read the contents of a file from an archive by its index
+ *
+ * Saves looking the name up when the index is already known.
+ *
+ *    @param arc Archive to look in
+ *    @param index Index of the file in the archive
+ *    @param[out] size Size of returned buffer
+ *    @return A pointer to the file contents in memory
+ */
+void* nzip_readIndex ( struct zip* arc, int index, size_t* size )
 {
    struct zip_file* file;
    struct zip_stat stats;
@@ -102,19 +127,19 @@ void* nzip_readFile ( struct zip* arc, const char* filename, size_t* size )
 
    // Get info about file
    zip_stat_init ( &stats );
-   err = zip_stat ( arc, filename, flags, &stats );
+   err = zip_stat_index ( arc, index, flags, &stats );
 
    if ( err ) {
-      WARN ( _("Error reading %s from archive"), filename );
+      WARN ( _("Error reading entry %d from archive"), index );
       WARN ( "%s", zip_strerror ( arc ) );
       return NULL;
    }
 
    // Open the file
-   file = zip_fopen_index ( arc, stats.index, flags );
+   file = zip_fopen_index ( arc, index, flags );
 
    if ( file == NULL ) {
-      WARN ( _("Error reading %s from archive"), filename );
+      WARN ( _("Error reading %s from archive"), stats.name );
       WARN ( "%s", zip_strerror ( arc ) );
       return NULL;
    }
@@ -127,7 +152,7 @@ void* nzip_readFile ( struct zip* arc, const char* filename, size_t* size )
 
    // If we read less than the reported file size, something probably went wrong
    if ( read < stats.size ) {
-      WARN ( _("Error reading %s from archive"), filename );
+      WARN ( _("Error reading %s from archive"), stats.name );
       WARN ( "%s", zip_strerror ( arc ) );
       free ( data );
       zip_fclose ( file );
@@ -147,9 +172,10 @@ void* nzip_readFile ( struct zip* arc, const char* filename, size_t* size )
  *
  *    @param arc Archive to look through
  *    @param[out] nfiles Number of files found
+ *    @param[out] index Archive index of each file found, can be NULL
  *    @return List of file names found
  */
-char** nzip_listFiles ( struct zip* arc, size_t* nfiles )
+char** nzip_listFiles ( struct zip* arc, size_t* nfiles, int **index )
 {
    struct zip_stat stats;
    char **filelist, **shrunk;
@@ -161,6 +187,8 @@ char** nzip_listFiles ( struct zip* arc, size_t* nfiles )
    *nfiles = zip_get_num_entries ( arc, flags );
 
    filelist = malloc ( sizeof ( char* ) * ( *nfiles ) );
+   if ( index != NULL )
+      *index = malloc ( sizeof ( int ) * ( *nfiles ) );
 
    // Get stats for each file, and store the name
    for ( i = 0, j = 0; i < *nfiles; i++ ) {
@@ -170,13 +198,23 @@ char** nzip_listFiles ( struct zip* arc, size_t* nfiles )
       if ( err ) {
          WARN ( _("Error getting file list from archive") );
          WARN ( "%s", zip_strerror ( arc ) );
+         while ( j > 0 )
+            free ( filelist[--j] );
          free ( filelist );
+         if ( index != NULL ) {
+            free ( *index );
+            *index = NULL;
+         }
+         *nfiles = 0;
          return NULL;
       }
 
       // If the name ends with a forward slash, it's a directory
-      if (!nfile_isSeparator( stats.name[strlen(stats.name) - 1] ))
+      if (!nfile_isSeparator( stats.name[strlen(stats.name) - 1] )) {
+         if ( index != NULL )
+            (*index)[j] = i;
          filelist[j++] = strdup(stats.name);
+      }
    }
 
    // Number of files excluding directories
@@ -16,7 +16,8 @@ void nzip_close ( struct zip* arc );
 
 int nzip_hasFile ( struct zip* arc, const char* filename );
 void* nzip_readFile ( struct zip* arc, const char* filename, size_t* size );
-char** nzip_listFiles ( struct zip* arc, size_t* nfiles );
+void* nzip_readIndex ( struct zip* arc, int index, size_t* size );
+char** nzip_listFiles ( struct zip* arc, size_t* nfiles, int **index );
 
 SDL_RWops* nzip_rwops ( struct zip* arc, const char* filename );
 
@@ -28,7 +29,8 @@ SDL_RWops* nzip_rwops ( struct zip* arc, const char* filename );
 
 #define nzip_hasFile(a, b) 0
 #define nzip_readFile(a, b, c) NULL
-#define nzip_listFiles(a, b) NULL
+#define nzip_readIndex(a, b, c) NULL
+#define nzip_listFiles(a, b, c) NULL
 
 #define nzip_rwops(a, b) NULL
 
@@ -317,6 +317,10 @@ void gl_checkHandleError( const char *func, int line )
    GLenum err;
    const char* errstr;
 
+   /* No context to ask. */
+   if (gl_has(OPENGL_HEADLESS))
+      return;
+
    err = glGetError();
 
    /* No error. */
@@ -793,6 +797,41 @@ int gl_init (void)
    return 0;
 }
 
+/**
+ * @brief Sets up gl_screen without a window or an OpenGL context.
+ *
+ * Textures only get their dimensions and transparency maps, so the game can
+ * be simulated (collisions included) on machines without a display.
+ *
+ *    @return 0 on success.
+ */
+int gl_initHeadless (void)
+{
+   int dw, dh;
+
+   /* desktop_w and desktop_h get set in naev.c when initializing. */
+   dw = gl_screen.desktop_w;
+   dh = gl_screen.desktop_h;
+   memset( &gl_screen, 0, sizeof(gl_screen) );
+   gl_screen.desktop_w = dw;
+   gl_screen.desktop_h = dh;
+   gl_screen.flags     = OPENGL_HEADLESS;
+
+   /* Nominal screen, things like the camera and nebula puffs still use it. */
+   gl_screen.rw    = conf.width;
+   gl_screen.rh    = conf.height;
+   gl_screen.scale = 1./conf.scalefactor;
+   gl_setupScaling();
+
+   /* Without nglGenBuffers the VBOs fall back to client memory. */
+   gl_initVBO();
+
+   DEBUG(_("Running headless with a %dx%d nominal screen"), gl_screen.w, gl_screen.h);
+   DEBUG("");
+
+   return 0;
+}
+
 /**
  * @brief Handles a window resize and resets gl_screen parametes.
  *
@@ -891,6 +930,14 @@ void gl_screenToWindowPos( int *wx, int *wy, int sx, int sy )
  */
 void gl_exit (void)
 {
+   /* Headless only set up the VBOs and textures. */
+   if (gl_has(OPENGL_HEADLESS)) {
+      gl_exitVBO();
+      gl_exitTextures();
+      SDL_QuitSubSystem(SDL_INIT_VIDEO);
+      return;
+   }
+
    /* Exit the OpenGL subsystems. */
    gl_exitRender();
    gl_exitVBO();
@@ -47,6 +47,7 @@
 #define OPENGL_FULLSCREEN  (1<<0) /**< Fullscreen. */
 #define OPENGL_DOUBLEBUF   (1<<1) /**< Doublebuffer. */
 #define OPENGL_VSYNC       (1<<2) /**< Sync to monitor vertical refresh rate. */
+#define OPENGL_HEADLESS    (1<<3) /**< No window or context, nothing gets uploaded or rendered. */
 #define gl_has(f)    (gl_screen.flags & (f)) /**< Check for the flag */
 /**
  * @brief Stores data about the current opengl environment.
@@ -103,6 +104,7 @@ extern glInfo gl_screen; /* local structure set with gl_init and co */
  * initialization / cleanup
  */
 int gl_init (void);
+int gl_initHeadless (void);
 void gl_exit (void);
 void gl_resize( int w, int h );
 
@@ -36,6 +36,7 @@
 #include "conf.h"
 #include "camera.h"
 #include "nstring.h"
+#include "profile.h"
 
 
 #define OPENGL_RENDER_VBO_SIZE      256 /**< Size of VBO. */
@@ -116,6 +117,7 @@ void gl_renderRect( double x, double y, double w, double h, const glColour *c )
          gl_renderVBOcolOffset, 4, GL_FLOAT, 0 );
 
    /* Draw. */
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
 
    /* Clear state. */
@@ -186,6 +188,7 @@ void gl_renderRectEmpty( double x, double y, double w, double h, const glColour
          gl_renderVBOcolOffset, 4, GL_FLOAT, 0 );
 
    /* Draw. */
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_LINE_STRIP, 0, 5 );
 
    /* Clear state. */
@@ -238,6 +241,7 @@ void gl_renderCross( double x, double y, double r, const glColour *c )
    gl_vboActivateOffset( gl_renderVBO, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
    gl_vboActivateOffset( gl_renderVBO, GL_COLOR_ARRAY,
          gl_renderVBOcolOffset, 4, GL_FLOAT, 0 );
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_LINES, 0, 4 );
    gl_vboDeactivate();
 }
@@ -320,6 +324,7 @@ void gl_blitTexture(  const glTexture* texture,
          gl_renderVBOcolOffset, 4, GL_FLOAT, 0 );
 
    /* Draw. */
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
 
    /* Clear state. */
@@ -491,6 +496,7 @@ static void gl_blitTextureInterpolate(  const glTexture* ta,
          gl_renderVBOtexOffset, 2, GL_FLOAT, 0 );
 
    /* Draw. */
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
 
    /* Clear state. */
@@ -822,6 +828,7 @@ void gl_drawCircleLoop( const double cx, const double cy,
          gl_renderVBOcolOffset, 4, GL_FLOAT, 0 );
 
    /* Draw. */
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_LINE_LOOP, 0, points );
 
    /* Clear state. */
@@ -906,6 +913,7 @@ static void gl_drawCircleEmpty( const double cx, const double cy,
          gl_renderVBOcolOffset, 4, GL_FLOAT, 0 );
 
    /* Draw. */
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_POINTS, 0, i );
 
    /* Clear state. */
@@ -1085,6 +1093,7 @@ void gl_drawCircleInRect( const double cx, const double cy, const double r,
          gl_renderVBOcolOffset, 4, GL_FLOAT, 0 );
 
    /* Draw. */
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_POINTS, 0, i );
 
    /* Clear state. */
@@ -25,20 +25,50 @@
 #include "conf.h"
 #include "npng.h"
 #include "md5.h"
+#include "nhash.h"
+#include "threadpool.h"
 
 
 /*
  * graphic list
  */
 /**
- * @brief Represents a node in the texture list.
+ * @brief Represents an entry in the texture list.
  */
 typedef struct glTexList_ {
-   struct glTexList_ *next; /**< Next in linked list */
    glTexture *tex; /**< associated texture */
    int used; /**< counts how many times texture is being used */
 } glTexList;
 static glTexList* texture_list = NULL; /**< Texture list. */
+static int texture_nlist      = 0; /**< Textures in the list. */
+static int texture_mlist      = 0; /**< Memory allocated for the list. */
+static NHash* texture_hash    = NULL; /**< Texture name to index in the list. */
+
+
+/*
+ * Background loading.
+ */
+/**
+ * @brief An image being decoded by the threadpool.
+ *
+ * The worker only touches the job until it sets done, everything else is
+ *  owned by the main thread.
+ */
+typedef struct glTexJob_ {
+   struct glTexJob_ *next; /**< Next job. */
+   glTexture *tex; /**< Texture to fill, NULL if it got freed while loading. */
+   char *data; /**< Raw png data. */
+   size_t size; /**< Size of the png data. */
+   unsigned int flags; /**< Flags it was requested with. */
+   int pad; /**< Whether to pad the surface to power of two. */
+   SDL_Surface *surface; /**< Decoded surface, NULL if decoding failed. */
+   glTexture res; /**< Dimensions, transparency map and collision masks. */
+   int done; /**< Set by the worker when it's finished. */
+} glTexJob;
+static glTexJob *texture_jobs    = NULL; /**< Images being decoded. */
+static SDL_mutex *texture_lock   = NULL; /**< Protects the done flag of the jobs. */
+static SDL_cond *texture_cond    = NULL; /**< Signaled when a job is done. */
+static GLuint texture_placeholder = 0; /**< Transparent texture shown until an image is loaded. */
 
 
 /*
@@ -55,12 +85,22 @@ static int gl_tex_ext_npot = 0; /**< Support for GL_ARB_texture_non_power_of_two
 static int SDL_IsTrans( SDL_Surface* s, int x, int y );
 static uint8_t* SDL_MapTrans( SDL_Surface* s, int w, int h );
 static size_t gl_transSize( const int w, const int h );
+static void gl_mapCollision( glTexture *texture );
 /* glTexture */
 static GLuint gl_loadSurface( SDL_Surface* surface, int *rw, int *rh, unsigned int flags, int freesur );
+static uint8_t* gl_loadTrans( const char *name, SDL_Surface* surface, SDL_RWops *rw,
+      int w, int h );
 static glTexture* gl_loadNewImage( const char* path, unsigned int flags );
+static void gl_texFree( glTexture *texture );
 /* List. */
-static glTexture* gl_texExists( const char* path );
+static glTexture* gl_texExists( const char* path, int wait );
+static int gl_texFind( const glTexture *tex );
 static int gl_texAdd( glTexture *tex );
+static void gl_texRemove( int i );
+/* Background loading. */
+static int gl_texDecode( void *data );
+static void gl_texFinish( glTexJob *job );
+static void gl_texWait( glTexture *tex );
 
 
 /**
@@ -214,6 +254,60 @@ static size_t gl_transSize( const int w, const int h )
 }
 
 
+/**
+ * @brief Packs the transparency map of a texture into collision masks.
+ *
+ * Every sprite gets its own rows so CollideSprite() can AND whole words of
+ *  two sprites at once, and a coarse mask to reject most checks early.
+ *
+ *    @param texture Texture with its transparency map set.
+ */
+static void gl_mapCollision( glTexture *texture )
+{
+   int x, y, fx, fy, sw, sh, sx, sy;
+   int words, cwords, crows;
+   uint64_t *row, *crow;
+
+   sw     = (int)texture->sw;
+   sh     = (int)texture->sh;
+   sx     = (int)texture->sx;
+   sy     = (int)texture->sy;
+   words  = (sw+63) / 64;
+   cwords = ((sw+7)/8 + 63) / 64;
+   crows  = (sh+7) / 8;
+
+   /* The extra word per row lets rows be read 64 bits at a time from any pixel. */
+   texture->collide        = calloc( (size_t)sx*sy*sh*(words+1), sizeof(uint64_t) );
+   texture->collide_coarse = calloc( (size_t)sx*sy*crows*cwords, sizeof(uint64_t) );
+   if ((texture->collide == NULL) || (texture->collide_coarse == NULL)) {
+      WARN(_("Out of Memory"));
+      free(texture->collide);
+      free(texture->collide_coarse);
+      texture->collide        = NULL;
+      texture->collide_coarse = NULL;
+      return;
+   }
+   texture->collide_words  = words;
+   texture->collide_cwords = cwords;
+
+   /* Sprites are laid out like in the transparency map, row by row. */
+   for (fy=0; fy<sy; fy++) {
+      for (fx=0; fx<sx; fx++) {
+         for (y=0; y<sh; y++) {
+            row  = &texture->collide[ ((size_t)(fy*sx+fx)*sh + y) * (words+1) ];
+            crow = &texture->collide_coarse[ ((size_t)(fy*sx+fx)*crows + y/8) * cwords ];
+            for (x=0; x<sw; x++) {
+               if (gl_isTrans( texture, fx*sw + x, fy*sh + y ))
+                  continue;
+               row[ x/64 ]      |= (uint64_t)1 << (x%64);
+               crow[ (x/8)/64 ] |= (uint64_t)1 << ((x/8)%64);
+            }
+         }
+      }
+   }
+}
+
+
 /**
  * @brief Prepares the surface to be loaded as a texture.
  *
@@ -324,6 +418,14 @@ static GLuint gl_loadSurface( SDL_Surface* surface, int *rw, int *rh, unsigned i
    if (rh != NULL)
       (*rh) = surface->h;
 
+   /* Without a context there is nothing to upload to, callers still get the
+    * dimensions and build transparency maps from the surface. */
+   if (gl_has(OPENGL_HEADLESS)) {
+      if (freesur)
+         SDL_FreeSurface( surface );
+      return 0;
+   }
+
    /* opengl texture binding */
    glGenTextures( 1, &texture ); /* Creates the texture */
    glBindTexture( GL_TEXTURE_2D, texture ); /* Loads the texture */
@@ -380,23 +482,21 @@ static GLuint gl_loadSurface( SDL_Surface* surface, int *rw, int *rh, unsigned i
 
 
 /**
- * @brief Wrapper for gl_loadImagePad that includes transparency mapping.
+ * @brief Gets the transparency map of an image, from the cache if possible.
  *
- *    @param name Name to load with.
- *    @param surface Surface to load.
+ * Safe to call from the threadpool as long as the surface and rwops belong to
+ *  the caller.
+ *
+ *    @param name Name of the image, for warnings.
+ *    @param surface Surface to map.
  *    @param rw RWops containing data to hash.
- *    @param flags Flags to use.
  *    @param w Non-padded width.
  *    @param h Non-padded height.
- *    @param sx X sprites.
- *    @param sy Y sprites.
- *    @param freesur Whether or not to free the surface.
- *    @return The glTexture for surface.
+ *    @return The transparency map.
  */
-glTexture* gl_loadImagePadTrans( const char *name, SDL_Surface* surface, SDL_RWops *rw,
-      unsigned int flags, int w, int h, int sx, int sy, int freesur )
+static uint8_t* gl_loadTrans( const char *name, SDL_Surface* surface, SDL_RWops *rw,
+      int w, int h )
 {
-   glTexture *texture;
    size_t i, filesize;
    size_t cachesize, pngsize;
    uint8_t *trans;
@@ -405,15 +505,6 @@ glTexture* gl_loadImagePadTrans( const char *name, SDL_Surface* surface, SDL_RWo
    md5_state_t md5;
    md5_byte_t *md5val;
 
-   if (name != NULL) {
-      texture = gl_texExists( name );
-      if (texture != NULL)
-         return texture;
-   }
-
-   if (flags & OPENGL_TEX_MAPTRANS)
-      flags ^= OPENGL_TEX_MAPTRANS;
-
    /* Appropriate size for the transparency map, see SDL_MapTrans */
    cachesize = gl_transSize(w, h);
 
@@ -481,8 +572,45 @@ glTexture* gl_loadImagePadTrans( const char *name, SDL_Surface* surface, SDL_RWo
       }
    }
 
+   return trans;
+}
+
+
+/**
+ * @brief Wrapper for gl_loadImagePad that includes transparency mapping.
+ *
+ *    @param name Name to load with.
+ *    @param surface Surface to load.
+ *    @param rw RWops containing data to hash.
+ *    @param flags Flags to use.
+ *    @param w Non-padded width.
+ *    @param h Non-padded height.
+ *    @param sx X sprites.
+ *    @param sy Y sprites.
+ *    @param freesur Whether or not to free the surface.
+ *    @return The glTexture for surface.
+ */
+glTexture* gl_loadImagePadTrans( const char *name, SDL_Surface* surface, SDL_RWops *rw,
+      unsigned int flags, int w, int h, int sx, int sy, int freesur )
+{
+   glTexture *texture;
+   uint8_t *trans;
+
+   if (name != NULL) {
+      texture = gl_texExists( name, 1 );
+      if (texture != NULL)
+         return texture;
+   }
+
+   if (flags & OPENGL_TEX_MAPTRANS)
+      flags ^= OPENGL_TEX_MAPTRANS;
+
+   trans = gl_loadTrans( name, surface, rw, w, h );
+
    texture = gl_loadImagePad( name, surface, flags, w, h, sx, sy, freesur );
    texture->trans = trans;
+   if (trans != NULL)
+      gl_mapCollision( texture );
    return texture;
 }
 
@@ -508,7 +636,7 @@ glTexture* gl_loadImagePad( const char *name, SDL_Surface* surface,
 
    /* Make sure doesn't already exist. */
    if (name != NULL) {
-      texture = gl_texExists( name );
+      texture = gl_texExists( name, 1 );
       if (texture != NULL)
          return texture;
    }
@@ -562,52 +690,85 @@ glTexture* gl_loadImage( SDL_Surface* surface, unsigned int flags )
  * @brief Check to see if a texture matching a path already exists.
  *
  *    @param path Path to the texture.
+ *    @param wait Whether to finish loading the texture if it's still being
+ *                decoded in the background.
  *    @return The texture, or NULL if none was found.
  */
-static glTexture* gl_texExists( const char* path )
+static glTexture* gl_texExists( const char* path, int wait )
 {
-   glTexList *cur;
+   int i;
 
    /* check to see if it already exists */
-   if (texture_list != NULL) {
-      for (cur=texture_list; cur!=NULL; cur=cur->next) {
-         if (strcmp(path,cur->tex->name)==0) {
-            cur->used += 1;
-            return cur->tex;
-         }
-      }
-   }
+   i = nhash_get( texture_hash, path );
+   if (i < 0)
+      return NULL;
 
-   return NULL;
+   texture_list[i].used += 1;
+   if (wait)
+      gl_texWait( texture_list[i].tex );
+   return texture_list[i].tex;
 }
 
 
 /**
- * @brief Adds a texture to the list under the name of path.
+ * @brief Finds a texture in the list.
+ *
+ *    @param tex Texture to find.
+ *    @return Index of the texture in the list or -1 if it's not in it.
  */
-static int gl_texAdd( glTexture *tex )
+static int gl_texFind( const glTexture *tex )
 {
-   glTexList *new, *cur, *last;
+   int i;
 
-   /* Create the new node */
-   new = malloc( sizeof(glTexList) );
-   new->next = NULL;
-   new->used = 1;
-   new->tex  = tex;
+   if (tex->name == NULL)
+      return -1;
+
+   i = nhash_get( texture_hash, tex->name );
+   if ((i < 0) || (texture_list[i].tex != tex))
+      return -1;
+   return i;
+}
 
-   if (texture_list == NULL) /* special condition - creating new list */
-      texture_list = new;
-   else {
-      for (cur=texture_list; cur!=NULL; cur=cur->next)
-         last = cur;
 
-      last->next = new;
+/**
+ * @brief Adds a texture to the list under the name of path.
+ */
+static int gl_texAdd( glTexture *tex )
+{
+   /* Grow memory if needed. */
+   if (texture_nlist >= texture_mlist) {
+      texture_mlist = MAX( 2*texture_mlist, 128 );
+      texture_list  = realloc( texture_list, sizeof(glTexList) * texture_mlist );
    }
+   if (texture_hash == NULL)
+      texture_hash = nhash_create( texture_mlist );
+
+   /* Create the new entry. */
+   texture_list[ texture_nlist ].used = 1;
+   texture_list[ texture_nlist ].tex  = tex;
+   nhash_set( texture_hash, tex->name, texture_nlist );
+   texture_nlist++;
 
    return 0;
 }
 
 
+/**
+ * @brief Removes an entry from the texture list, moving the last one in its place.
+ *
+ *    @param i Index of the entry to remove.
+ */
+static void gl_texRemove( int i )
+{
+   nhash_remove( texture_hash, texture_list[i].tex->name );
+   texture_nlist--;
+   if (i < texture_nlist) {
+      texture_list[i] = texture_list[ texture_nlist ];
+      nhash_set( texture_hash, texture_list[i].tex->name, i );
+   }
+}
+
+
 /**
  * @brief Loads an image as a texture.
  *
@@ -622,7 +783,7 @@ glTexture* gl_newImage( const char* path, const unsigned int flags )
    glTexture *t;
 
    /* Check if it already exists. */
-   t = gl_texExists( path );
+   t = gl_texExists( path, 1 );
    if (t != NULL)
       return t;
 
@@ -631,6 +792,232 @@ glTexture* gl_newImage( const char* path, const unsigned int flags )
 }
 
 
+/**
+ * @brief Loads an image as a texture, decoding it in the background.
+ *
+ * The texture is returned with its final dimensions right away but draws as
+ *  fully transparent until gl_texUpdate() uploads the decoded image. Images
+ *  that are already loaded or being loaded are shared like with gl_newImage().
+ *
+ *    @param path Image to load.
+ *    @param flags Flags to control image parameters.
+ *    @return Texture that will hold the image.
+ */
+glTexture* gl_newImageAsync( const char* path, const unsigned int flags )
+{
+   glTexture *texture;
+   glTexJob *job;
+   SDL_RWops *rw;
+   npng_t *npng;
+   png_uint_32 w, h;
+   char *data, *str;
+   size_t size;
+   int len, sx, sy, pw, ph;
+
+   /* Check if it already exists. */
+   texture = gl_texExists( path, 0 );
+   if (texture != NULL)
+      return texture;
+
+   /* Without a context or a lock there's nothing to do it in the background with. */
+   if (texture_lock == NULL)
+      return gl_loadNewImage( path, flags );
+
+   /* Reading from ndata isn't thread safe, only decoding is left to the threadpool. */
+   data = ndata_read( path, &size );
+   if (data == NULL) {
+      WARN(_("Failed to load surface '%s' from ndata."), path);
+      return NULL;
+   }
+
+   /* The header is enough to set up the texture. */
+   rw    = SDL_RWFromConstMem( data, size );
+   npng  = npng_open( rw );
+   if (npng == NULL) {
+      WARN(_("File '%s' is not a png."), path );
+      SDL_RWclose( rw );
+      free( data );
+      return NULL;
+   }
+   npng_dim( npng, &w, &h );
+   len = npng_metadata( npng, "sx", &str );
+   sx  = (len > 0) ? atoi(str) : 1;
+   len = npng_metadata( npng, "sy", &str );
+   sy  = (len > 0) ? atoi(str) : 1;
+   npng_close( npng );
+   SDL_RWclose( rw );
+
+   pw = gl_needPOT() ? gl_pot(w) : (int)w;
+   ph = gl_needPOT() ? gl_pot(h) : (int)h;
+
+   texture = calloc( 1, sizeof(glTexture) );
+   texture->name  = strdup( path );
+   texture->w     = (double) w;
+   texture->h     = (double) h;
+   texture->rw    = (double) pw;
+   texture->rh    = (double) ph;
+   texture->sx    = (double) sx;
+   texture->sy    = (double) sy;
+   texture->sw    = texture->w / texture->sx;
+   texture->sh    = texture->h / texture->sy;
+   texture->srw   = texture->sw / texture->rw;
+   texture->srh   = texture->sh / texture->rh;
+   texture->texture = texture_placeholder;
+   gl_texAdd( texture );
+
+   /* Queue the decoding. */
+   job         = calloc( 1, sizeof(glTexJob) );
+   job->tex    = texture;
+   job->data   = data;
+   job->size   = size;
+   job->flags  = flags;
+   job->pad    = gl_needPOT();
+   job->res    = *texture;
+   job->res.name = strdup( path ); /* The texture may be gone before the worker is done. */
+   job->next   = texture_jobs;
+   texture_jobs = job;
+   if (threadpool_newJob( gl_texDecode, job ))
+      gl_texDecode( job );
+
+   return texture;
+}
+
+
+/**
+ * @brief Decodes the image of a job, runs in the threadpool.
+ *
+ *    @param data Job to decode.
+ *    @return 0 always.
+ */
+static int gl_texDecode( void *data )
+{
+   glTexJob *job;
+   SDL_RWops *rw;
+   npng_t *npng;
+
+   job  = (glTexJob*) data;
+   rw   = SDL_RWFromConstMem( job->data, job->size );
+   npng = npng_open( rw );
+   if (npng != NULL) {
+      job->surface = npng_readSurface( npng, job->pad, 1 );
+      npng_close( npng );
+   }
+
+   /* Transparency and collisions are the expensive part after inflating. */
+   if ((job->surface != NULL) && (job->flags & OPENGL_TEX_MAPTRANS)) {
+      job->res.trans = gl_loadTrans( job->res.name, job->surface, rw,
+            (int)job->res.w, (int)job->res.h );
+      if (job->res.trans != NULL)
+         gl_mapCollision( &job->res );
+   }
+
+   SDL_RWclose( rw );
+   free( job->data );
+   job->data = NULL;
+
+   SDL_mutexP( texture_lock );
+   job->done = 1;
+   SDL_CondBroadcast( texture_cond );
+   SDL_mutexV( texture_lock );
+   return 0;
+}
+
+
+/**
+ * @brief Uploads the image of a finished job and frees the job.
+ *
+ * The job must already be removed from the job list.
+ *
+ *    @param job Job to finish.
+ */
+static void gl_texFinish( glTexJob *job )
+{
+   glTexture *tex;
+
+   tex = job->tex;
+   free( job->res.name );
+
+   /* Texture was freed while it was loading. */
+   if (tex == NULL) {
+      if (job->surface != NULL)
+         SDL_FreeSurface( job->surface );
+      free( job->res.trans );
+      free( job->res.collide );
+      free( job->res.collide_coarse );
+      free( job );
+      return;
+   }
+
+   if (job->surface == NULL)
+      WARN(_("'%s' could not be opened"), tex->name );
+   else {
+      tex->texture = gl_loadSurface( job->surface, NULL, NULL,
+            job->flags & ~OPENGL_TEX_MAPTRANS, 1 );
+      tex->trans          = job->res.trans;
+      tex->collide        = job->res.collide;
+      tex->collide_coarse = job->res.collide_coarse;
+      tex->collide_words  = job->res.collide_words;
+      tex->collide_cwords = job->res.collide_cwords;
+   }
+   free( job );
+}
+
+
+/**
+ * @brief Blocks until a texture is done loading in the background.
+ *
+ *    @param tex Texture to wait for, nothing is done if it's not loading. NULL
+ *               waits for a load whose texture was already freed.
+ */
+static void gl_texWait( glTexture *tex )
+{
+   glTexJob **prev, *job;
+
+   for (prev=&texture_jobs; *prev!=NULL; prev=&(*prev)->next) {
+      job = *prev;
+      if (job->tex != tex)
+         continue;
+
+      SDL_mutexP( texture_lock );
+      while (!job->done)
+         SDL_CondWait( texture_cond, texture_lock );
+      SDL_mutexV( texture_lock );
+
+      *prev = job->next;
+      gl_texFinish( job );
+      return;
+   }
+}
+
+
+/**
+ * @brief Uploads the textures that finished decoding in the background.
+ *
+ * Must be called from the main thread, preferably once a frame.
+ */
+void gl_texUpdate (void)
+{
+   glTexJob **prev, *job;
+   int done;
+
+   prev = &texture_jobs;
+   while (*prev != NULL) {
+      job = *prev;
+
+      SDL_mutexP( texture_lock );
+      done = job->done;
+      SDL_mutexV( texture_lock );
+
+      if (!done) {
+         prev = &job->next;
+         continue;
+      }
+      *prev = job->next;
+      gl_texFinish( job );
+   }
+}
+
+
 /**
  * @brief Only loads the image, does not add to stack unlike gl_newImage.
  *
@@ -717,6 +1104,32 @@ glTexture* gl_newSprite( const char* path, const int sx, const int sy,
 }
 
 
+/**
+ * @brief Frees the data of a texture.
+ *
+ *    @param texture Texture to free.
+ */
+static void gl_texFree( glTexture *texture )
+{
+   glTexJob *job;
+
+   /* Let a pending load know it has nowhere to go. */
+   for (job=texture_jobs; job!=NULL; job=job->next)
+      if (job->tex == texture)
+         job->tex = NULL;
+
+   if ((texture->texture != 0) && (texture->texture != texture_placeholder))
+      glDeleteTextures( 1, &texture->texture );
+   if (texture->trans != NULL)
+      free(texture->trans);
+   free(texture->collide);
+   free(texture->collide_coarse);
+   if (texture->name != NULL)
+      free(texture->name);
+   free(texture);
+}
+
+
 /**
  * @brief Frees a texture.
  *
@@ -724,7 +1137,7 @@ glTexture* gl_newSprite( const char* path, const int sx, const int sy,
  */
 void gl_freeTexture( glTexture* texture )
 {
-   glTexList *cur, *last;
+   int i;
 
    /* Shouldn't be NULL (won't segfault though) */
    if (texture == NULL) {
@@ -733,33 +1146,14 @@ void gl_freeTexture( glTexture* texture )
    }
 
    /* see if we can find it in stack */
-   last = NULL;
-   for (cur=texture_list; cur!=NULL; cur=cur->next) {
-      if (cur->tex == texture) { /* found it */
-         cur->used--;
-         if (cur->used <= 0) { /* not used anymore */
-            /* free the texture */
-            glDeleteTextures( 1, &texture->texture );
-            if (texture->trans != NULL)
-               free(texture->trans);
-            if (texture->name != NULL)
-               free(texture->name);
-            free(texture);
-
-            /* free the list node */
-            if (last == NULL) { /* case there's no texture before it */
-               if (cur->next != NULL)
-                  texture_list = cur->next;
-               else /* case it's the last texture */
-                  texture_list = NULL;
-            }
-            else
-               last->next = cur->next;
-            free(cur);
-         }
-         return; /* we already found it so we can exit */
+   i = gl_texFind( texture );
+   if (i >= 0) {
+      texture_list[i].used--;
+      if (texture_list[i].used <= 0) { /* not used anymore */
+         gl_texRemove( i );
+         gl_texFree( texture );
       }
-      last = cur;
+      return; /* we already found it so we can exit */
    }
 
    /* Not found */
@@ -767,12 +1161,7 @@ void gl_freeTexture( glTexture* texture )
       WARN(_("Attempting to free texture '%s' not found in stack!"), texture->name);
 
    /* Free anyways */
-   glDeleteTextures( 1, &texture->texture );
-   if (texture->trans != NULL)
-      free(texture->trans);
-   if (texture->name != NULL)
-      free(texture->name);
-   free(texture);
+   gl_texFree( texture );
 
    gl_checkErr();
 }
@@ -786,20 +1175,17 @@ void gl_freeTexture( glTexture* texture )
  */
 glTexture* gl_dupTexture( glTexture *texture )
 {
-   glTexList *cur;
+   int i;
 
    /* No segfaults kthxbye. */
    if (texture == NULL)
       return NULL;
 
    /* check to see if it already exists */
-   if (texture_list != NULL) {
-      for (cur=texture_list; cur!=NULL; cur=cur->next) {
-         if (texture == cur->tex) {
-            cur->used += 1;
-            return cur->tex;
-         }
-      }
+   i = gl_texFind( texture );
+   if (i >= 0) {
+      texture_list[i].used += 1;
+      return texture;
    }
 
    /* Invalid texture. */
@@ -891,9 +1277,22 @@ int gl_needPOT (void)
  */
 int gl_initTextures (void)
 {
+   static const GLubyte blank[4] = { 0, 0, 0, 0 };
+
    if (gl_hasVersion(2,0) || gl_hasExt("GL_ARB_texture_non_power_of_two"))
       gl_tex_ext_npot = 1;
 
+   /* Background loading. */
+   texture_lock = SDL_CreateMutex();
+   texture_cond = SDL_CreateCond();
+   glGenTextures( 1, &texture_placeholder );
+   glBindTexture( GL_TEXTURE_2D, texture_placeholder );
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+   glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA,
+         GL_UNSIGNED_BYTE, blank );
+   gl_checkErr();
+
    return 0;
 }
 
@@ -903,13 +1302,36 @@ int gl_initTextures (void)
  */
 void gl_exitTextures (void)
 {
-   glTexList *tex;
+   int i;
+
+   /* Let background loads finish so their memory gets freed. */
+   while (texture_jobs != NULL)
+      gl_texWait( texture_jobs->tex );
 
    /* Make sure there's no texture leak */
-   if (texture_list != NULL) {
+   if (texture_nlist > 0) {
       DEBUG(_("Texture leak detected!"));
-      for (tex=texture_list; tex!=NULL; tex=tex->next)
-         DEBUG(_("   '%s' opened %d times"), tex->tex->name, tex->used );
+      for (i=0; i<texture_nlist; i++)
+         DEBUG(_("   '%s' opened %d times"), texture_list[i].tex->name, texture_list[i].used );
    }
-}
 
+   free( texture_list );
+   texture_list  = NULL;
+   texture_nlist = 0;
+   texture_mlist = 0;
+   nhash_free( texture_hash );
+   texture_hash  = NULL;
+
+   if (texture_placeholder != 0) {
+      glDeleteTextures( 1, &texture_placeholder );
+      texture_placeholder = 0;
+   }
+   if (texture_cond != NULL) {
+      SDL_DestroyCond( texture_cond );
+      texture_cond = NULL;
+   }
+   if (texture_lock != NULL) {
+      SDL_DestroyMutex( texture_lock );
+      texture_lock = NULL;
+   }
+}
@@ -64,6 +64,10 @@ typedef struct glTexture_ {
    /* data */
    GLuint texture; /**< the opengl texture itself */
    uint8_t* trans; /**< maps the transparency */
+   uint64_t* collide; /**< Opaque pixels of every sprite as rows of collide_words+1 words, the last one always 0. */
+   uint64_t* collide_coarse; /**< Same at 1/8 resolution, a bit per 8x8 block with any opaque pixel. */
+   int collide_words; /**< Words needed for a sprite row in collide. */
+   int collide_cwords; /**< Words per row in collide_coarse. */
 
    /* properties */
    uint8_t flags; /**< flags used for texture properties */
@@ -92,9 +96,11 @@ glTexture* gl_loadImagePadTrans( const char *name, SDL_Surface* surface, SDL_RWo
       unsigned int flags, int w, int h, int sx, int sy, int freesur );
 glTexture* gl_loadImage( SDL_Surface* surface, const unsigned int flags ); /* Frees the surface. */
 glTexture* gl_newImage( const char* path, const unsigned int flags );
+glTexture* gl_newImageAsync( const char* path, const unsigned int flags );
 glTexture* gl_newSprite( const char* path, const int sx, const int sy,
       const unsigned int flags );
 glTexture* gl_dupTexture( glTexture *texture );
+void gl_texUpdate (void);
 
 /*
  * Clean up.
@@ -36,6 +36,7 @@
 #include "damagetype.h"
 #include "slots.h"
 #include "mapData.h"
+#include "nhash.h"
 
 
 #define outfit_setProp(o,p)      ((o)->properties |= p) /**< Checks outfit property. */
@@ -49,6 +50,7 @@
  * the stack
  */
 static Outfit* outfit_stack = NULL; /**< Stack of outfits. */
+static NHash* outfit_hash = NULL; /**< Outfit name to index in the stack. */
 
 
 /*
@@ -88,9 +90,9 @@ Outfit* outfit_get( const char* name )
 {
    int i;
 
-   for (i=0; i<array_size(outfit_stack); i++)
-      if (strcmp(name,outfit_stack[i].name)==0)
-         return &outfit_stack[i];
+   i = nhash_get( outfit_hash, name );
+   if (i >= 0)
+      return &outfit_stack[i];
 
    WARN(_("Outfit '%s' not found in stack."), name);
    return NULL;
@@ -106,10 +108,8 @@ Outfit* outfit_get( const char* name )
 Outfit* outfit_getW( const char* name )
 {
    int i;
-   for (i=0; i<array_size(outfit_stack); i++)
-      if (strcmp(name,outfit_stack[i].name)==0)
-         return &outfit_stack[i];
-   return NULL;
+   i = nhash_get( outfit_hash, name );
+   return (i >= 0) ? &outfit_stack[i] : NULL;
 }
 
 
@@ -2267,6 +2267,11 @@ int outfit_load (void)
    array_shrink(&outfit_stack);
    noutfits = array_size(outfit_stack);
 
+   /* Index the names, backwards so the first of duplicates wins like a scan. */
+   outfit_hash = nhash_create( noutfits );
+   for (i=noutfits-1; i>=0; i--)
+      nhash_set( outfit_hash, outfit_stack[i].name, i );
+
    /* Second pass, sets up ammunition relationships. */
    for (i=0; i<noutfits; i++) {
       o = &outfit_stack[i];
@@ -2338,7 +2343,7 @@ int outfit_mapParse (void)
 {
    Outfit *o;
    size_t i, len, bufsize, nfiles;
-   char *buf;
+   const char *buf;
    xmlNodePtr node, cur;
    xmlDocPtr doc;
    char **map_files;
@@ -2351,7 +2356,7 @@ int outfit_mapParse (void)
       file = malloc( len );
       nsnprintf( file, len, "%s%s", MAP_DATA_PATH, map_files[i] );
 
-      buf = ndata_read( file, &bufsize );
+      buf = ndata_map( file, &bufsize );
       doc = xmlParseMemory( buf, bufsize );
 
       node = doc->xmlChildrenNode; /* first system node */
@@ -2359,7 +2364,7 @@ int outfit_mapParse (void)
          WARN( _("Malformed '%s' file: does not contain elements"), OUTFIT_DATA_PATH );
          free(file);
          xmlFreeDoc(doc);
-         free(buf);
+         ndata_unmap( buf, bufsize );
          return -1;
       }
 
@@ -2369,7 +2374,7 @@ int outfit_mapParse (void)
       if (!outfit_isMap(o)) { /* If its not a map, we don't care. */
          free(file);
          xmlFreeDoc(doc);
-         free(buf);
+         ndata_unmap( buf, bufsize );
          continue;
       }
 
@@ -2386,7 +2391,7 @@ int outfit_mapParse (void)
       /* Clean up. */
       free(file);
       xmlFreeDoc(doc);
-      free(buf);
+      ndata_unmap( buf, bufsize );
    }
 
    /* Clean up. */
@@ -2488,5 +2493,7 @@ void outfit_free (void)
    }
 
    array_free(outfit_stack);
+   nhash_free(outfit_hash);
+   outfit_hash = NULL;
 }
 
@@ -88,6 +88,7 @@ void solid_init( Solid* dest, const double mass, const double dir,
 Solid* solid_create( const double mass, const double dir,
       const Vector2d* pos, const Vector2d* vel, int update );
 void solid_free( Solid* src );
+void solid_updateBatch( Solid **solids, int n, const double dt );
 
 
 #endif /* PHYSICS_H */
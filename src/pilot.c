@@ -51,6 +51,9 @@
 #define PILOT_CHUNK_MAX 2048 /**< Maximum chunks to increment pilot_stack by */
 #define CHUNK_SIZE      32 /**< Size to allocate memory by. */
 
+#define PILOT_RTREE_MARGIN       8. /**< Minimum padding of a pilot's box in the rtree. */
+#define PILOT_RTREE_MARGIN_TIME  0.25 /**< Seconds of travel a pilot's box in the rtree is padded by. */
+
 /* ID Generators. */
 static unsigned int pilot_id = PLAYER_ID; /**< Stack of pilot ids to assure uniqueness */
 
@@ -60,7 +63,7 @@ Pilot** pilot_stack = NULL; /**< Not static, used in player.c, weapon.c, pause.c
 int pilot_nstack = 0; /**< same */
 static int pilot_mstack = 0; /**< Memory allocated for pilot_stack. */
 
-struct rtree *pilot_rtree = NULL;
+struct rtree *pilot_rtree = NULL; /**< Spatial index of the pilots, kept current by pilots_update(). */
 
 
 /* misc */
@@ -73,6 +76,7 @@ static double pilot_commFade     = 5.; /**< Time for text above pilot to fade ou
  * Prototypes
  */
 /* Update. */
+static void pilot_rtreeUpdate( Pilot *p );
 static void pilot_hyperspace( Pilot* pilot, double dt );
 static void pilot_refuel( Pilot *p, double dt );
 /* Clean up. */
@@ -2636,6 +2640,9 @@ Pilot* pilot_copy( Pilot* src )
    dest->solid = malloc(sizeof(Solid));
    *dest->solid = *src->solid;
 
+   /* Copy isn't indexed. */
+   dest->rtree_leaf = NULL;
+
    /* Copy outfits. */
    dest->noutfits = src->noutfits;
    dest->outfits  = malloc( sizeof(PilotOutfitSlot*) * dest->noutfits );
@@ -2787,6 +2794,9 @@ void pilot_free( Pilot* p )
    /* If hostile, must remove counter. */
    pilot_rmHostile(p);
 
+   /* Stop indexing. */
+   pilot_rtreeRemove(p);
+
    /* Free weapon sets. */
    pilot_weapSetFree(p);
 
@@ -2887,6 +2897,12 @@ void pilots_free (void)
    pilot_stack = NULL;
    player.p = NULL;
    pilot_nstack = 0;
+
+   /* Free the index, should be empty by now. */
+   if (pilot_rtree != NULL) {
+      rtree_free(pilot_rtree);
+      pilot_rtree = NULL;
+   }
 }
 
 
@@ -2991,31 +3007,70 @@ void pilots_update( double dt )
          p->think(p, dt);
    }
 
-   if (pilot_rtree != NULL)
-      rtree_free(pilot_rtree);
-   pilot_rtree = rtree_create();
-
    /* Now update all the pilots. */
    for (i=0; i<pilot_nstack; i++) {
       p = pilot_stack[i];
 
       /* Ignore. */
-      if (pilot_isFlag(p, PILOT_DELETE))
+      if (pilot_isFlag(p, PILOT_DELETE)) {
+         pilot_rtreeRemove( p );
          continue;
+      }
 
       /* Invisible, not doing anything. */
-      if (pilot_isFlag(p, PILOT_INVISIBLE))
+      if (pilot_isFlag(p, PILOT_INVISIBLE)) {
+         pilot_rtreeRemove( p );
          continue;
+      }
 
       /* Just update the pilot. */
       if (p->update) /* update */
          p->update( p, dt );
 
-      rtree_insert(pilot_rtree, p);
+      pilot_rtreeUpdate( p );
    }
 }
 
 
+/**
+ * @brief Keeps the pilot's entry in the pilot rtree current.
+ *
+ * The pilot is indexed with a padded box, so it only has to be moved in the
+ * tree once it leaves it instead of every frame.
+ *
+ *    @param p Pilot to update.
+ */
+static void pilot_rtreeUpdate( Pilot *p )
+{
+   double x, y, w, h, margin;
+
+   if (pilot_rtree == NULL)
+      pilot_rtree = rtree_create();
+
+   x = VX(p->solid->pos);
+   y = VY(p->solid->pos);
+   w = p->ship->gfx_space->sw / 2.;
+   h = p->ship->gfx_space->sh / 2.;
+   margin = PILOT_RTREE_MARGIN + PILOT_RTREE_MARGIN_TIME * VMOD(p->solid->vel);
+
+   rtree_update( pilot_rtree, p, &p->rtree_leaf, x-w, x+w, y-h, y+h, margin );
+}
+
+
+/**
+ * @brief Removes a pilot from the pilot rtree.
+ *
+ *    @param p Pilot to remove.
+ */
+void pilot_rtreeRemove( Pilot *p )
+{
+   if (p->rtree_leaf == NULL)
+      return;
+
+   rtree_remove( pilot_rtree, p, &p->rtree_leaf );
+}
+
+
 /**
  * @brief Renders all the pilots.
  *
@@ -283,6 +283,7 @@ typedef struct Pilot_ {
    double mass_outfit; /**< Amount of outfit mass added. */
    int tsx;          /**< current sprite x position, calculated on update. */
    int tsy;          /**< current sprite y position, calculated on update. */
+   struct rtree_node *rtree_leaf; /**< Leaf of the pilot rtree holding the pilot, NULL if not indexed. */
 
    /* Properties. */
    int cpu;       /**< Amount of CPU the pilot has left. */
@@ -515,6 +516,7 @@ void pilots_clean (void);
 void pilots_clear (void);
 void pilots_cleanAll (void);
 void pilot_free( Pilot* p );
+void pilot_rtreeRemove( Pilot *p );
 
 
 /*
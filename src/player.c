@@ -597,6 +597,7 @@ void player_swapShip( char* shipname )
       pilot_calcStats( player.p );
 
       /* now swap the players */
+      pilot_rtreeRemove( player.p );
       player_stack[i].p = player.p;
       for (j=0; j<pilot_nstack; j++) /* find pilot in stack to swap */
          if (pilot_stack[j] == player.p) {
@@ -0,0 +1,416 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file profile.c
+ *
+ * @brief Per frame profiler.
+ *
+ * update_routine() and render_all() charge the time spent in each of their
+ * phases to a zone, while the hot paths bump counters for Lua calls, rtree
+ * queries, collision tests and draw calls. Every frame is pushed into a
+ * short history drawn as a stacked graph. With --profile-csv every frame is
+ * also appended to a CSV file in the cache path, which rotates once it gets
+ * too large.
+ *
+ * Nothing is measured unless the profiler is active, the counters then cost
+ * a single branch.
+ */
+
+#include "profile.h"
+
+#include "naev.h"
+
+#include <stdio.h>
+#include "nstring.h"
+
+#include "log.h"
+#include "opengl.h"
+#include "font.h"
+#include "nfile.h"
+#include "conf.h"
+#include "player.h"
+
+
+#define PROFILE_HISTORY    240 /**< Frames kept for the graph. */
+#define PROFILE_CSV_ROWS   36000 /**< Rows written before the CSV rotates. */
+#define PROFILE_CSV        "profile.csv" /**< Name of the CSV in the cache path. */
+#define PROFILE_CSV_OLD    "profile.old.csv" /**< Name of the rotated CSV. */
+
+#define PROFILE_GRAPH_H    100. /**< Height of the graph. */
+#define PROFILE_GRAPH_MS   (1000./30.) /**< Frame length at the top of the graph. */
+
+
+/**
+ * @brief A profiled frame.
+ */
+typedef struct ProfileFrame_ {
+   double dt; /**< Real length of the frame. */
+   double zone[PROFILE_ZONES]; /**< Time spent in each zone. */
+   unsigned long counter[PROFILE_COUNTERS]; /**< Counts of the frame. */
+} ProfileFrame;
+
+
+int profile_active = 0; /**< Whether the profiler is measuring. */
+unsigned long profile_counter[PROFILE_COUNTERS]; /**< Counters of the current frame. */
+
+static double profile_cur[PROFILE_ZONES]; /**< Zone times of the current frame. */
+static ProfileFrame profile_hist[PROFILE_HISTORY]; /**< Ring of past frames. */
+static int profile_head       = 0; /**< Next slot of the ring. */
+static int profile_nhist      = 0; /**< Frames in the ring. */
+
+static int profile_frames     = 0; /**< Frames since the profiler was enabled. */
+static double profile_tzone[PROFILE_ZONES]; /**< Zone totals since enabled. */
+static unsigned long profile_tcounter[PROFILE_COUNTERS]; /**< Counter totals since enabled. */
+
+static FILE *profile_csv      = NULL; /**< CSV being written. */
+static int profile_csvRows    = 0; /**< Rows in the CSV. */
+
+static gl_vbo *profile_vbo    = NULL; /**< Graph vertices and colours. */
+
+static const char *profile_zoneNames[PROFILE_ZONES] = {
+   "time", "space", "weapons", "spfx", "pilots", "camera", "hooks", "render"
+}; /**< Names of the zones. */
+static const char *profile_counterNames[PROFILE_COUNTERS] = {
+   "lua", "rtree", "collide", "draws", "cond"
+}; /**< Names of the counters. */
+static const glColour *profile_zoneColours[PROFILE_ZONES] = {
+   &cGrey70, &cBlue, &cRed, &cPurple, &cGreen, &cAqua, &cOrange, &cYellow
+}; /**< Colours of the zones in the graph. */
+
+
+/*
+ * Prototypes.
+ */
+static void profile_reset (void);
+static void profile_csvOpen (void);
+static void profile_csvClose (void);
+static void profile_csvWrite( const ProfileFrame *f );
+
+
+/**
+ * @brief Clears all the measurements.
+ */
+static void profile_reset (void)
+{
+   memset( profile_cur, 0, sizeof(profile_cur) );
+   memset( profile_counter, 0, sizeof(profile_counter) );
+   memset( profile_tzone, 0, sizeof(profile_tzone) );
+   memset( profile_tcounter, 0, sizeof(profile_tcounter) );
+   profile_head   = 0;
+   profile_nhist  = 0;
+   profile_frames = 0;
+}
+
+
+/**
+ * @brief Turns the profiler on or off.
+ *
+ * Enabling starts from scratch and starts a new CSV if they were asked for.
+ *
+ *    @param enable Whether to enable it.
+ */
+void profile_enable( int enable )
+{
+   if (enable == profile_active)
+      return;
+
+   profile_active = enable;
+   if (enable) {
+      profile_reset();
+      if (conf.profile_csv)
+         profile_csvOpen();
+   }
+   else
+      profile_csvClose();
+}
+
+
+/**
+ * @brief Toggles the profiler.
+ */
+void profile_toggle (void)
+{
+   profile_enable( !profile_active );
+   player_message( profile_active ? _("Profiler enabled.") : _("Profiler disabled.") );
+}
+
+
+/**
+ * @brief Cleans up the profiler.
+ */
+void profile_exit (void)
+{
+   profile_enable( 0 );
+   if (profile_vbo != NULL)
+      gl_vboDestroy( profile_vbo );
+   profile_vbo = NULL;
+}
+
+
+/**
+ * @brief Gets a high resolution time stamp.
+ *
+ *    @return Time in seconds from an arbitrary origin.
+ */
+double profile_now (void)
+{
+#if SDL_VERSION_ATLEAST(2,0,0)
+   return (double)SDL_GetPerformanceCounter() / (double)SDL_GetPerformanceFrequency();
+#else /* SDL_VERSION_ATLEAST(2,0,0) */
+   return (double)SDL_GetTicks() / 1000.;
+#endif /* SDL_VERSION_ATLEAST(2,0,0) */
+}
+
+
+/**
+ * @brief Starts timing a sequence of zones.
+ *
+ *    @return Time stamp to pass to profile_zone().
+ */
+double profile_begin (void)
+{
+   return profile_active ? profile_now() : 0.;
+}
+
+
+/**
+ * @brief Charges the time since t to a zone.
+ *
+ *    @param zone Zone to charge.
+ *    @param t Time stamp the zone started at.
+ *    @return Time stamp for the next zone.
+ */
+double profile_zone( ProfileZone zone, double t )
+{
+   double now;
+
+   if (!profile_active)
+      return 0.;
+
+   now = profile_now();
+   profile_cur[zone] += now - t;
+   return now;
+}
+
+
+/**
+ * @brief Closes the current frame.
+ *
+ *    @param dt Real length of the frame.
+ */
+void profile_frame( double dt )
+{
+   ProfileFrame *f;
+   int i;
+
+   if (!profile_active)
+      return;
+
+   f = &profile_hist[ profile_head ];
+   f->dt = dt;
+   memcpy( f->zone, profile_cur, sizeof(f->zone) );
+   memcpy( f->counter, profile_counter, sizeof(f->counter) );
+   profile_head = (profile_head+1) % PROFILE_HISTORY;
+   profile_nhist = MIN( profile_nhist+1, PROFILE_HISTORY );
+
+   profile_frames++;
+   for (i=0; i<PROFILE_ZONES; i++)
+      profile_tzone[i] += f->zone[i];
+   for (i=0; i<PROFILE_COUNTERS; i++)
+      profile_tcounter[i] += f->counter[i];
+
+   profile_csvWrite( f );
+
+   memset( profile_cur, 0, sizeof(profile_cur) );
+   memset( profile_counter, 0, sizeof(profile_counter) );
+}
+
+
+/**
+ * @brief Gets the name of a zone.
+ */
+const char* profile_zoneName( ProfileZone zone )
+{
+   return profile_zoneNames[zone];
+}
+
+
+/**
+ * @brief Gets the name of a counter.
+ */
+const char* profile_counterName( ProfileCounter counter )
+{
+   return profile_counterNames[counter];
+}
+
+
+/**
+ * @brief Gets the totals since the profiler was enabled.
+ *
+ *    @param[out] zones Seconds spent in each zone, can be NULL.
+ *    @param[out] counters Total of each counter, can be NULL.
+ *    @return Number of frames profiled.
+ */
+int profile_totals( double *zones, unsigned long *counters )
+{
+   if (zones != NULL)
+      memcpy( zones, profile_tzone, sizeof(profile_tzone) );
+   if (counters != NULL)
+      memcpy( counters, profile_tcounter, sizeof(profile_tcounter) );
+   return profile_frames;
+}
+
+
+/**
+ * @brief Starts a new CSV, rotating out the previous one.
+ */
+static void profile_csvOpen (void)
+{
+   char path[PATH_MAX], old[PATH_MAX];
+   int i;
+
+   profile_csvClose();
+
+   nsnprintf( path, sizeof(path), "%s"PROFILE_CSV, nfile_cachePath() );
+   nsnprintf( old, sizeof(old), "%s"PROFILE_CSV_OLD, nfile_cachePath() );
+   if (nfile_fileExists( path )) {
+      if (nfile_fileExists( old ))
+         nfile_delete( old );
+      nfile_rename( path, old );
+   }
+
+   profile_csv = fopen( path, "w" );
+   if (profile_csv == NULL) {
+      WARN( _("Unable to open '%s' for writing!"), path );
+      return;
+   }
+   profile_csvRows = 0;
+
+   /* Times are in milliseconds. */
+   fprintf( profile_csv, "frame,dt" );
+   for (i=0; i<PROFILE_ZONES; i++)
+      fprintf( profile_csv, ",%s", profile_zoneNames[i] );
+   for (i=0; i<PROFILE_COUNTERS; i++)
+      fprintf( profile_csv, ",%s", profile_counterNames[i] );
+   fprintf( profile_csv, "\n" );
+}
+
+
+/**
+ * @brief Closes the CSV.
+ */
+static void profile_csvClose (void)
+{
+   if (profile_csv != NULL)
+      fclose( profile_csv );
+   profile_csv = NULL;
+}
+
+
+/**
+ * @brief Appends a frame to the CSV.
+ *
+ *    @param f Frame to append.
+ */
+static void profile_csvWrite( const ProfileFrame *f )
+{
+   int i;
+
+   if (profile_csvRows >= PROFILE_CSV_ROWS)
+      profile_csvOpen();
+   if (profile_csv == NULL)
+      return;
+
+   fprintf( profile_csv, "%d,%.3f", profile_frames, f->dt * 1000. );
+   for (i=0; i<PROFILE_ZONES; i++)
+      fprintf( profile_csv, ",%.3f", f->zone[i] * 1000. );
+   for (i=0; i<PROFILE_COUNTERS; i++)
+      fprintf( profile_csv, ",%lu", f->counter[i] );
+   fprintf( profile_csv, "\n" );
+   profile_csvRows++;
+}
+
+
+/**
+ * @brief Renders the profiler graph and legend.
+ *
+ * Every frame in the history is a column stacking its zones, the legend has
+ * the averages over the history.
+ */
+void profile_render (void)
+{
+   GLfloat *vertex, *col;
+   const ProfileFrame *f;
+   const glColour *c;
+   double x, y, h, s, avg[PROFILE_ZONES];
+   unsigned long cnt[PROFILE_COUNTERS];
+   int i, j, k, n;
+
+   if (!profile_active || (profile_nhist == 0) ||
+         (gl_screen.flags & OPENGL_HEADLESS))
+      return;
+
+   /* Each zone of each frame is a line. */
+   n = PROFILE_HISTORY * PROFILE_ZONES * 2;
+   if (profile_vbo == NULL)
+      profile_vbo = gl_vboCreateStream( sizeof(GLfloat) * n*(2+4), NULL );
+
+   x = SCREEN_W - PROFILE_HISTORY - 20.;
+   y = SCREEN_H - PROFILE_GRAPH_H - 20.;
+   s = PROFILE_GRAPH_H / PROFILE_GRAPH_MS * 1000.;
+   gl_renderRect( x, y, PROFILE_HISTORY, PROFILE_GRAPH_H, &cBlackHilight );
+
+   /* Build the columns, oldest first. */
+   vertex = gl_vboMap( profile_vbo );
+   col    = &vertex[ n*2 ];
+   memset( avg, 0, sizeof(avg) );
+   memset( cnt, 0, sizeof(cnt) );
+   k = 0;
+   for (i=0; i<profile_nhist; i++) {
+      f = &profile_hist[ (profile_head - profile_nhist + i + PROFILE_HISTORY) % PROFILE_HISTORY ];
+      h = y;
+      for (j=0; j<PROFILE_ZONES; j++) {
+         avg[j] += f->zone[j];
+         c = profile_zoneColours[j];
+         vertex[4*k+0] = x + i + 0.5;
+         vertex[4*k+1] = h;
+         h = MIN( h + f->zone[j] * s, y + PROFILE_GRAPH_H );
+         vertex[4*k+2] = vertex[4*k+0];
+         vertex[4*k+3] = h;
+         col[8*k+0] = c->r;
+         col[8*k+1] = c->g;
+         col[8*k+2] = c->b;
+         col[8*k+3] = c->a;
+         col[8*k+4] = c->r;
+         col[8*k+5] = c->g;
+         col[8*k+6] = c->b;
+         col[8*k+7] = c->a;
+         k++;
+      }
+      for (j=0; j<PROFILE_COUNTERS; j++)
+         cnt[j] += f->counter[j];
+   }
+   gl_vboUnmap( profile_vbo );
+
+   gl_vboActivateOffset( profile_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
+   gl_vboActivateOffset( profile_vbo, GL_COLOR_ARRAY,
+         sizeof(GLfloat) * n*2, 4, GL_FLOAT, 0 );
+   profile_count( PROFILE_DRAWS, 1 );
+   glDrawArrays( GL_LINES, 0, k*2 );
+   gl_vboDeactivate();
+
+   /* Legend, averaged over the history. */
+   y -= gl_smallFont.h + 5.;
+   for (j=0; j<PROFILE_ZONES; j++) {
+      gl_print( &gl_smallFont, x, y, profile_zoneColours[j], "%-8s %6.2f ms",
+            profile_zoneNames[j], avg[j] / profile_nhist * 1000. );
+      y -= gl_smallFont.h + 3.;
+   }
+   for (j=0; j<PROFILE_COUNTERS; j++) {
+      gl_print( &gl_smallFont, x, y, NULL, "%-8s %6lu",
+            profile_counterNames[j], cnt[j] / profile_nhist );
+      y -= gl_smallFont.h + 3.;
+   }
+}
@@ -0,0 +1,74 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+#ifndef PROFILE_H
+#  define PROFILE_H
+
+
+/**
+ * @brief Timed phases of a frame.
+ */
+typedef enum ProfileZone_ {
+   PROFILE_TIME, /**< ntime_update() and the hook exclusion start. */
+   PROFILE_SPACE, /**< space_update(). */
+   PROFILE_WEAPONS, /**< weapons_update(). */
+   PROFILE_SPFX, /**< spfx_update(). */
+   PROFILE_PILOTS, /**< pilots_update(). */
+   PROFILE_CAMERA, /**< cam_update(). */
+   PROFILE_HOOKS, /**< Hooks deferred to the end of the update. */
+   PROFILE_RENDER, /**< render_all(). */
+   PROFILE_ZONES /**< Number of zones. */
+} ProfileZone;
+
+
+/**
+ * @brief Things counted every frame.
+ */
+typedef enum ProfileCounter_ {
+   PROFILE_LUA, /**< Lua calls through nlua_pcall(). */
+   PROFILE_RTREE, /**< rtree queries. */
+   PROFILE_COLLIDE, /**< Collision tests. */
+   PROFILE_DRAWS, /**< Draw calls. */
+   PROFILE_COND, /**< Conditions evaluated through cond_check(). */
+   PROFILE_COUNTERS /**< Number of counters. */
+} ProfileCounter;
+
+
+extern int profile_active; /**< Whether the profiler is measuring. */
+extern unsigned long profile_counter[PROFILE_COUNTERS]; /**< Counters of the current frame. */
+
+
+/**
+ * @brief Adds n to a counter of the current frame, free when not profiling.
+ */
+#define profile_count(c,n) \
+   do { if (profile_active) profile_counter[c] += (n); } while (0)
+
+
+/*
+ * Control.
+ */
+void profile_enable( int enable );
+void profile_toggle (void);
+void profile_exit (void);
+
+/*
+ * Measuring.
+ */
+double profile_now (void);
+double profile_begin (void);
+double profile_zone( ProfileZone zone, double t );
+void profile_frame( double dt );
+
+/*
+ * Results.
+ */
+const char* profile_zoneName( ProfileZone zone );
+const char* profile_counterName( ProfileCounter counter );
+int profile_totals( double *zones, unsigned long *counters );
+void profile_render (void);
+
+
+#endif /* PROFILE_H */
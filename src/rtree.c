@@ -1,23 +1,24 @@
 #define NODE_LENGTH 5
+#define NODE_MIN 2 /* Minimum values each side of a split gets. */
+#define REBUILD_FACTOR 4 /* Reinserts per value tolerated before rebuilding. */
+#define REBUILD_MIN 64 /* Reinserts always tolerated before rebuilding. */
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <assert.h>
 #include "rtree.h"
-#include "physics.h"
+#include "naev.h"
 #include "opengl_render.h"
 
-struct bounding_rectangle {
-   double x1, x2, y1, y2;
-};
-
 const glColour cInternal = { .r=1., .g=0., .b=0., .a=.25 };
 const glColour cLeaf = { .r=0., .g=1., .b=0., .a=.25 };
 const glColour cPilot = { .r=1., .g=1., .b=1., .a=1. };
 
 struct rtree_value {
    struct bounding_rectangle mbr;
-   void *value; /* Pilot if leaf, rtree_node if internal  */
+   void *value; /* Object if leaf, rtree_node if internal  */
+   struct rtree_node **ref; /* Object's reference to its leaf, NULL if internal */
 };
 
 struct rtree_node {
@@ -27,35 +28,55 @@ struct rtree_node {
    } type;
    int length;
    struct bounding_rectangle mbr;
+   struct rtree_node *parent; /* NULL if root, next unused node if pooled */
    struct rtree_value values[NODE_LENGTH];
 };
 
 struct rtree {
    struct rtree_node *root;
    int height;
+   int count; /* Number of objects indexed. */
+   int degradation; /* Reinserts since the last rebuild. */
+   struct rtree_node *pool; /* Unused nodes kept around for reuse. */
+   struct rtree_value *scratch; /* Buffer used when rebuilding. */
+   int scratch_size;
+   int *batch; /* Box indices per level used by batch queries. */
+   int batch_size;
 };
 
-struct rtree_iter_item {
+static struct rtree_node *rtree_node_new(struct rtree *tree, int type) {
    struct rtree_node *node;
-   int index;
-};
 
-struct rtree_iter {
-   struct rtree_iter_item *items;
-   int count;
-};
+   if (tree->pool != NULL) {
+      node = tree->pool;
+      tree->pool = node->parent;
+   } else
+      node = malloc(sizeof(struct rtree_node));
 
-struct rtree *rtree_create() {
-   struct rtree_node *root;
+   node->type = type;
+   node->length = 0;
+   node->parent = NULL;
+   return node;
+}
+
+static void rtree_node_release(struct rtree *tree, struct rtree_node *node) {
+   node->parent = tree->pool;
+   tree->pool = node;
+}
+
+struct rtree *rtree_create (void) {
    struct rtree *tree;
-      
-   root = malloc(sizeof(struct rtree_node));
-   root->type = LEAF_NODE;
-   root->length = 0;
 
    tree = malloc(sizeof(struct rtree));
-   tree->root = root;
+   tree->pool = NULL;
+   tree->scratch = NULL;
+   tree->scratch_size = 0;
+   tree->batch = NULL;
+   tree->batch_size = 0;
+   tree->root = rtree_node_new(tree, LEAF_NODE);
    tree->height = 0;
+   tree->count = 0;
+   tree->degradation = 0;
 
    return tree;
 }
@@ -65,13 +86,52 @@ static void rtree_free_node(struct rtree_node *node) {
    if (node->type == INTERNAL_NODE) {
       for (i=0; i < node->length; i++)
          rtree_free_node(node->values[i].value);
+   } else {
+      for (i=0; i < node->length; i++)
+         *node->values[i].ref = NULL;
    }
 
    free(node);
 }
 
 void rtree_free(struct rtree *tree) {
+   struct rtree_node *node;
+
    rtree_free_node(tree->root);
+   while (tree->pool != NULL) {
+      node = tree->pool;
+      tree->pool = node->parent;
+      free(node);
+   }
+   free(tree->scratch);
+   free(tree->batch);
+   free(tree);
+}
+
+/* Moves a subtree to the pool, detaching every object in it. */
+static void rtree_node_recycle(struct rtree *tree, struct rtree_node *node) {
+   int i;
+   if (node->type == INTERNAL_NODE) {
+      for (i=0; i < node->length; i++)
+         rtree_node_recycle(tree, node->values[i].value);
+   } else {
+      for (i=0; i < node->length; i++)
+         *node->values[i].ref = NULL;
+   }
+
+   rtree_node_release(tree, node);
+}
+
+void rtree_clear(struct rtree *tree) {
+   rtree_node_recycle(tree, tree->root);
+   tree->root = rtree_node_new(tree, LEAF_NODE);
+   tree->height = 0;
+   tree->count = 0;
+   tree->degradation = 0;
+}
+
+int rtree_count(struct rtree *tree) {
+   return tree->count;
 }
 
 static struct bounding_rectangle mbr_add(struct bounding_rectangle mbr1, struct bounding_rectangle mbr2) {
@@ -97,26 +157,62 @@ static int mbr_interesect(struct bounding_rectangle mbr1, struct bounding_rectan
             mbr1.y2 < mbr2.y1 || mbr2.y2 < mbr1.y1);
 }
 
-static struct rtree_node *rtree_node_split(struct rtree_node *node, struct bounding_rectangle mbr, void *value) {
-   int i, j, distance, best_distance, best_i, best_j;
-   struct rtree_node *new_node;
+static int mbr_contains(struct bounding_rectangle outer, struct bounding_rectangle inner) {
+   return outer.x1 <= inner.x1 && inner.x2 <= outer.x2 &&
+          outer.y1 <= inner.y1 && inner.y2 <= outer.y2;
+}
+
+/* Recalculates a node's mbr from its values. */
+static void rtree_node_mbr(struct rtree_node *node) {
+   int i;
+
+   if (node->length == 0)
+      return;
+
+   node->mbr = node->values[0].mbr;
+   for (i = 1; i < node->length; i++)
+      node->mbr = mbr_add(node->mbr, node->values[i].mbr);
+}
+
+/* Points the values of a node back at it. */
+static void rtree_node_adopt(struct rtree_node *node) {
+   int i;
+   for (i = 0; i < node->length; i++) {
+      if (node->type == INTERNAL_NODE)
+         ((struct rtree_node*)node->values[i].value)->parent = node;
+      else
+         *node->values[i].ref = node;
+   }
+}
+
+static int rtree_node_index(struct rtree_node *node, void *value) {
+   int i;
+   for (i = 0; i < node->length; i++)
+      if (node->values[i].value == value)
+         return i;
+   return -1;
+}
+
+static struct rtree_node *rtree_node_split(struct rtree *tree, struct rtree_node *node, const struct rtree_value *value) {
+   int i, j, best_i, best_j, left;
+   double distance, best_distance, grow1, grow2;
+   struct rtree_value values[NODE_LENGTH + 1];
+   struct rtree_node *new_node, *target;
    struct bounding_rectangle mbr1, mbr2;
-   struct rtree_value tmp_value;
 
    assert(node->length == NODE_LENGTH);
 
-   new_node = malloc(sizeof(struct rtree_node));
-   new_node->type = node->type;
-   
+   memcpy(values, node->values, sizeof(node->values));
+   values[NODE_LENGTH] = *value;
+
+   /* Seed both nodes with the two values furthest apart. */
    // TODO handle ties
-   best_distance = -1;
-   for (i = -1; i < NODE_LENGTH - 1; i++) {
-      for (j = i+1; j < NODE_LENGTH; j++) {
-         /* Use -1 to represent the value being inserted */
-         if (i == -1)
-            distance = mbr_distance(mbr, node->values[j].mbr);
-         else
-            distance = mbr_distance(node->values[i].mbr, node->values[j].mbr);
+   best_i = 0;
+   best_j = 1;
+   best_distance = -1.;
+   for (i = 0; i < NODE_LENGTH; i++) {
+      for (j = i+1; j < NODE_LENGTH + 1; j++) {
+         distance = mbr_distance(values[i].mbr, values[j].mbr);
          if (distance > best_distance) {
             best_i = i;
             best_j = j;
@@ -125,129 +221,332 @@ static struct rtree_node *rtree_node_split(struct rtree_node *node, struct bound
       }
    }
 
-   if (best_j == -1) {
-      new_node->values[0].mbr = mbr;
-      new_node->values[0].value = value;
-   } else {
-      new_node->values[0] = node->values[best_j];
-
-      node->values[best_j].mbr = mbr;
-      node->values[best_j].value = value;
-
-      if (best_i == -1)
-         best_i = best_j;
-   }
-
-   /* swap node->values[0] and node->values[best_i] */
-   tmp_value = node->values[0];
-   node->values[0] = node->values[best_i];
-   node->values[best_i] = tmp_value;
-
-   new_node->mbr = new_node->values[0].mbr;
+   new_node = rtree_node_new(tree, node->type);
+   new_node->values[0] = values[best_j];
+   new_node->mbr = values[best_j].mbr;
    new_node->length = 1;
-   node->mbr = node->values[0].mbr;
+   node->values[0] = values[best_i];
+   node->mbr = values[best_i].mbr;
    node->length = 1;
 
-   for (i = 1; i < NODE_LENGTH; i++) {
-      mbr1 = mbr_add(node->mbr, node->values[i].mbr);
-      mbr2 = mbr_add(new_node->mbr, node->values[i].mbr);
-      if (mbr_area(mbr2) - mbr_area(new_node->mbr) < mbr_area(mbr1) - mbr_area(node->mbr)) {
-         new_node->values[new_node->length++] = node->values[i];
-         new_node->mbr = mbr2;
-      } else {
-         node->values[node->length++] = node->values[i];
+   /* Hand out the rest by least area increase, keeping both nodes usable. */
+   left = NODE_LENGTH - 1;
+   for (i = 0; i < NODE_LENGTH + 1; i++) {
+      if (i == best_i || i == best_j)
+         continue;
+
+      mbr1 = mbr_add(node->mbr, values[i].mbr);
+      mbr2 = mbr_add(new_node->mbr, values[i].mbr);
+      grow1 = mbr_area(mbr1) - mbr_area(node->mbr);
+      grow2 = mbr_area(mbr2) - mbr_area(new_node->mbr);
+
+      if (NODE_MIN - node->length >= left)
+         target = node;
+      else if (NODE_MIN - new_node->length >= left)
+         target = new_node;
+      else if (grow2 < grow1 || (grow2 == grow1 && new_node->length < node->length))
+         target = new_node;
+      else
+         target = node;
+
+      if (target == node)
          node->mbr = mbr1;
-      }
+      else
+         new_node->mbr = mbr2;
+      target->values[target->length++] = values[i];
+      left--;
    }
 
+   rtree_node_adopt(node);
+   rtree_node_adopt(new_node);
+
    return new_node;
 }
 
-static struct rtree_node *rtree_node_insert(struct rtree_node *node, struct bounding_rectangle mbr, Pilot *pilot) {
+static struct rtree_node *rtree_node_insert(struct rtree *tree, struct rtree_node *node, const struct rtree_value *value) {
    int best_fit, i;
-   double best_fit_increase, increase;
-   struct rtree_node *new_node;
+   double best_fit_increase, best_fit_area, increase, area;
+   struct rtree_node *child, *new_node;
+   struct rtree_value new_value;
 
    if (node->type == LEAF_NODE) {
       if (node->length < NODE_LENGTH) {
-         node->values[node->length].mbr = mbr;
-         node->values[node->length].value = pilot;
-         node->length++;
-         node->mbr = mbr_add(node->mbr, mbr);
+         if (node->length == 0)
+            node->mbr = value->mbr;
+         else
+            node->mbr = mbr_add(node->mbr, value->mbr);
+         node->values[node->length++] = *value;
+         *value->ref = node;
          return NULL;
       } else {
-         return rtree_node_split(node, mbr, pilot);
+         return rtree_node_split(tree, node, value);
       }
    } else {
+      best_fit = 0;
       best_fit_increase = INFINITY;
-      // TODO handle ties
+      best_fit_area = INFINITY;
       for (i=0; i < node->length; i++) {
-         increase = mbr_area(mbr_add(node->values[i].mbr, mbr)) - mbr_area(node->values[i].mbr);
-         if (increase < best_fit_increase) {
+         area = mbr_area(node->values[i].mbr);
+         increase = mbr_area(mbr_add(node->values[i].mbr, value->mbr)) - area;
+         if (increase < best_fit_increase ||
+               (increase == best_fit_increase && area < best_fit_area)) {
             best_fit_increase = increase;
+            best_fit_area = area;
             best_fit = i;
          }
       }
-      new_node = rtree_node_insert(node->values[best_fit].value, mbr, pilot);
-      node->values[best_fit].mbr = ((struct rtree_node*)node->values[best_fit].value)->mbr;
+      child = node->values[best_fit].value;
+      new_node = rtree_node_insert(tree, child, value);
+      node->values[best_fit].mbr = child->mbr;
 
       if (new_node != NULL) {
+         new_value.mbr = new_node->mbr;
+         new_value.value = new_node;
+         new_value.ref = NULL;
          if (node->length < NODE_LENGTH) {
-            node->values[node->length].mbr = new_node->mbr;
-            node->values[node->length].value = new_node;
-            node->length++;
+            node->values[node->length++] = new_value;
+            new_node->parent = node;
          } else {
-            return rtree_node_split(node, mbr, new_node);
+            return rtree_node_split(tree, node, &new_value);
          }
       }
 
-      node->mbr = mbr_add(node->mbr, mbr);
+      rtree_node_mbr(node);
       return NULL;
    }
 }
 
-void rtree_insert(struct rtree *tree, Pilot *pilot) {
-   struct bounding_rectangle mbr;
-   glTexture *gfx_space;
+static void rtree_insert_value(struct rtree *tree, const struct rtree_value *value) {
    struct rtree_node *new_node, *new_root;
 
-   gfx_space = pilot->ship->gfx_space;
-   mbr.x1 = VX(pilot->solid->pos) - (gfx_space->sw / 2);
-   mbr.x2 = VX(pilot->solid->pos) + (gfx_space->sw / 2);
-   mbr.y1 = VY(pilot->solid->pos) - (gfx_space->sh / 2);
-   mbr.y2 = VY(pilot->solid->pos) + (gfx_space->sh / 2);
-
-   new_node = rtree_node_insert(tree->root, mbr, pilot);
+   new_node = rtree_node_insert(tree, tree->root, value);
    if (new_node != NULL) {
-      new_root = malloc(sizeof(struct rtree_node));
-      new_root->type = INTERNAL_NODE;
+      new_root = rtree_node_new(tree, INTERNAL_NODE);
       new_root->length = 2;
 
       new_root->values[0].value = tree->root;
       new_root->values[0].mbr = tree->root->mbr;
+      new_root->values[0].ref = NULL;
       new_root->values[1].value = new_node;
       new_root->values[1].mbr = new_node->mbr;
+      new_root->values[1].ref = NULL;
+      rtree_node_mbr(new_root);
+      rtree_node_adopt(new_root);
 
       tree->root = new_root;
       tree->height++;
+      assert(tree->height < RTREE_HEIGHT_MAX);
    }
 }
 
-struct rtree_iter *rtree_begin(struct rtree *tree) {
-   struct rtree_iter *iter = malloc(sizeof(struct rtree_iter));
-   iter->count = tree->height;
-   iter->items = malloc((tree->height + 1) * sizeof(struct rtree_iter_item));
-   iter->items[0].node = tree->root;
-   iter->items[0].index = -1;
-   return iter;
+void rtree_insert(struct rtree *tree, void *value, struct rtree_node **ref,
+      double x1, double x2, double y1, double y2) {
+   struct rtree_value v;
+
+   v.mbr.x1 = x1;
+   v.mbr.x2 = x2;
+   v.mbr.y1 = y1;
+   v.mbr.y2 = y2;
+   v.value = value;
+   v.ref = ref;
+
+   rtree_insert_value(tree, &v);
+   tree->count++;
 }
 
-void rtree_iter_free(struct rtree_iter *iter) {
-   free(iter->items);
-   free(iter);
+/* Propagates a change in node upwards, dropping nodes that became empty. */
+static void rtree_node_refit(struct rtree *tree, struct rtree_node *node) {
+   int i;
+   struct rtree_node *parent, *child;
+
+   while (node != tree->root) {
+      parent = node->parent;
+      i = rtree_node_index(parent, node);
+      assert(i >= 0);
+      if (node->length == 0) {
+         parent->values[i] = parent->values[--parent->length];
+         rtree_node_release(tree, node);
+      } else {
+         rtree_node_mbr(node);
+         parent->values[i].mbr = node->mbr;
+      }
+      node = parent;
+   }
+   rtree_node_mbr(node);
+
+   /* Shrink the tree while the root has a single child. */
+   while (tree->root->type == INTERNAL_NODE && tree->root->length <= 1) {
+      if (tree->root->length == 0) {
+         tree->root->type = LEAF_NODE;
+         tree->height = 0;
+         break;
+      }
+      child = tree->root->values[0].value;
+      rtree_node_release(tree, tree->root);
+      child->parent = NULL;
+      tree->root = child;
+      tree->height--;
+   }
 }
 
-Pilot* rtree_find(struct rtree_iter *iter, double x1, double x2, double y1, double y2) {
+void rtree_remove(struct rtree *tree, void *value, struct rtree_node **ref) {
+   int i;
+   struct rtree_node *leaf;
+
+   leaf = *ref;
+   if (leaf == NULL)
+      return;
+
+   i = rtree_node_index(leaf, value);
+   assert(i >= 0);
+   leaf->values[i] = leaf->values[--leaf->length];
+   *ref = NULL;
+   tree->count--;
+
+   rtree_node_refit(tree, leaf);
+}
+
+void rtree_update(struct rtree *tree, void *value, struct rtree_node **ref,
+      double x1, double x2, double y1, double y2, double margin) {
+   int i;
+   struct rtree_node *leaf;
+   struct bounding_rectangle mbr = {x1, x2, y1, y2};
+   struct bounding_rectangle loose = {x1 - margin, x2 + margin, y1 - margin, y2 + margin};
+
+   leaf = *ref;
+   if (leaf == NULL) {
+      rtree_insert(tree, value, ref, loose.x1, loose.x2, loose.y1, loose.y2);
+      return;
+   }
+
+   /* Still within the box it was indexed with. */
+   i = rtree_node_index(leaf, value);
+   assert(i >= 0);
+   if (mbr_contains(leaf->values[i].mbr, mbr))
+      return;
+
+   /* Small moves that stay within the leaf are refitted in place. */
+   if (mbr_contains(leaf->mbr, loose)) {
+      leaf->values[i].mbr = loose;
+      rtree_node_refit(tree, leaf);
+      return;
+   }
+
+   rtree_remove(tree, value, ref);
+   rtree_insert(tree, value, ref, loose.x1, loose.x2, loose.y1, loose.y2);
+
+   /* Reinserting leaves underfull nodes behind, start afresh once there are too many. */
+   tree->degradation++;
+   if (tree->degradation > REBUILD_FACTOR * tree->count + REBUILD_MIN)
+      rtree_rebuild(tree);
+}
+
+static void rtree_node_collect(struct rtree_node *node, struct rtree_value *values, int *n) {
+   int i;
+   if (node->type == INTERNAL_NODE) {
+      for (i = 0; i < node->length; i++)
+         rtree_node_collect(node->values[i].value, values, n);
+   } else {
+      for (i = 0; i < node->length; i++)
+         values[(*n)++] = node->values[i];
+   }
+}
+
+static int rtree_value_cmpx(const void *p1, const void *p2) {
+   const struct rtree_value *v1 = p1, *v2 = p2;
+   double c1 = v1->mbr.x1 + v1->mbr.x2;
+   double c2 = v2->mbr.x1 + v2->mbr.x2;
+   return (c1 > c2) - (c1 < c2);
+}
+
+static int rtree_value_cmpy(const void *p1, const void *p2) {
+   const struct rtree_value *v1 = p1, *v2 = p2;
+   double c1 = v1->mbr.y1 + v1->mbr.y2;
+   double c2 = v2->mbr.y1 + v2->mbr.y2;
+   return (c1 > c2) - (c1 < c2);
+}
+
+/* Packs one level of values into nodes with Sort-Tile-Recursive: the values
+ * are sorted into vertical slices by centre x, and each slice by centre y into
+ * runs of nodes. The values of the new nodes replace the packed ones at the
+ * start of the array, it returns how many there are. */
+static int rtree_pack_level(struct rtree *tree, struct rtree_value *values, int n, int type) {
+   int i, j, k, m, s, nnodes, nslices, slice, start, end, out;
+   struct rtree_node *node;
+
+   nnodes = (n + NODE_LENGTH - 1) / NODE_LENGTH;
+   nslices = (int)ceil(sqrt((double)nnodes));
+   slice = nslices * NODE_LENGTH;
+
+   qsort(values, n, sizeof(struct rtree_value), rtree_value_cmpx);
+   for (s = 0; s < n; s += slice)
+      qsort(&values[s], MIN(slice, n - s), sizeof(struct rtree_value), rtree_value_cmpy);
+
+   /* Spread each slice evenly so no node is left with a stray value. A node
+    * only overwrites values already packed, so the array is reused. */
+   out = 0;
+   for (s = 0; s < n; s += slice) {
+      m = MIN(slice, n - s);
+      k = (m + NODE_LENGTH - 1) / NODE_LENGTH;
+      for (j = 0; j < k; j++) {
+         start = s + j * m / k;
+         end = s + (j + 1) * m / k;
+         node = rtree_node_new(tree, type);
+         for (i = start; i < end; i++)
+            node->values[node->length++] = values[i];
+         rtree_node_mbr(node);
+         rtree_node_adopt(node);
+
+         values[out].mbr = node->mbr;
+         values[out].value = node;
+         values[out].ref = NULL;
+         out++;
+      }
+   }
+   return out;
+}
+
+void rtree_rebuild(struct rtree *tree) {
+   int n, type;
+
+   if (tree->scratch_size < tree->count) {
+      tree->scratch_size = MAX(tree->count, 2 * tree->scratch_size);
+      tree->scratch = realloc(tree->scratch, tree->scratch_size * sizeof(struct rtree_value));
+   }
+
+   n = 0;
+   rtree_node_collect(tree->root, tree->scratch, &n);
+   assert(n == tree->count);
+
+   rtree_node_recycle(tree, tree->root);
+   tree->degradation = 0;
+   tree->height = 0;
+   if (n == 0) {
+      tree->root = rtree_node_new(tree, LEAF_NODE);
+      return;
+   }
+
+   /* Bulk load bottom up, each level packs the nodes of the one below. */
+   type = LEAF_NODE;
+   for (;;) {
+      n = rtree_pack_level(tree, tree->scratch, n, type);
+      if (n == 1)
+         break;
+      type = INTERNAL_NODE;
+      tree->height++;
+      assert(tree->height < RTREE_HEIGHT_MAX);
+   }
+   tree->root = tree->scratch[0].value;
+   tree->root->parent = NULL;
+}
+
+void rtree_begin(struct rtree *tree, struct rtree_iter *iter) {
+   iter->count = tree->height + 1;
+   iter->items[0].node = tree->root;
+   iter->items[0].index = -1;
+}
+
+void* rtree_find(struct rtree_iter *iter, double x1, double x2, double y1, double y2) {
    int level, i;
    struct rtree_node *node;
    struct bounding_rectangle mbr = {x1, x2, y1, y2};
@@ -283,6 +582,51 @@ OUTER:
    return NULL;
 }
 
+static void rtree_node_findBatch(struct rtree_node *node, const struct bounding_rectangle *boxes, int nboxes,
+      const int *in, int nin, int *out, rtree_batch_func func, void *data) {
+   int i, k, nout;
+
+   for (i = 0; i < node->length; i++) {
+      /* Narrow down the boxes that can reach this value. */
+      nout = 0;
+      for (k = 0; k < nin; k++)
+         if (mbr_interesect(boxes[in[k]], node->values[i].mbr))
+            out[nout++] = in[k];
+      if (nout == 0)
+         continue;
+
+      if (node->type == LEAF_NODE) {
+         for (k = 0; k < nout; k++)
+            func(node->values[i].value, out[k], data);
+      } else {
+         rtree_node_findBatch(node->values[i].value, boxes, nboxes,
+               out, nout, out + nboxes, func, data);
+      }
+   }
+}
+
+/* Queries many boxes in a single traversal. Each box sees its values in the
+ * same order rtree_find() would return them. */
+void rtree_findBatch(struct rtree *tree, const struct bounding_rectangle *boxes, int nboxes,
+      rtree_batch_func func, void *data) {
+   int i, size;
+
+   if (nboxes <= 0 || tree->count == 0)
+      return;
+
+   /* One list of surviving boxes per level, plus the starting one. */
+   size = nboxes * (tree->height + 2);
+   if (tree->batch_size < size) {
+      tree->batch_size = MAX(size, 2 * tree->batch_size);
+      tree->batch = realloc(tree->batch, tree->batch_size * sizeof(int));
+   }
+   for (i = 0; i < nboxes; i++)
+      tree->batch[i] = i;
+
+   rtree_node_findBatch(tree->root, boxes, nboxes, tree->batch, nboxes,
+         tree->batch + nboxes, func, data);
+}
+
 static void mbr_draw(struct bounding_rectangle mbr, double res, const glColour *c) {
    gl_renderRectEmpty(mbr.x1 / res + SCREEN_W / 2,
 		      mbr.y1 / res + SCREEN_H / 2,
@@ -309,5 +653,6 @@ static void rtree_node_draw(struct rtree_node *node, double res) {
 }
 
 void rtree_draw(struct rtree *tree, double res) {
-   rtree_node_draw(tree->root, res);
+   if (tree->count > 0)
+      rtree_node_draw(tree->root, res);
 }
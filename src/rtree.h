@@ -6,17 +6,55 @@
 #ifndef RTREE_H
 #  define RTREE_H
 
-#include "pilot.h"
 
+#define RTREE_HEIGHT_MAX 32 /**< Deepest tree an iterator can walk. */
+
+
+/*
+ * The rtree is persistent: objects are inserted once and then kept current
+ * with rtree_update(), which only touches the tree when an object leaves the
+ * loose box it was indexed with. Every indexed object owns a struct rtree_node
+ * pointer (its reference) that the tree keeps pointed at the leaf holding it;
+ * it must be NULL while the object is not in a tree.
+ */
 struct rtree;
-struct rtree_iter;
+struct rtree_node;
+
+struct bounding_rectangle {
+   double x1, x2, y1, y2;
+};
+
+/*
+ * Query iterators are owned by the caller, usually on the stack, so walking
+ * the tree never allocates.
+ */
+struct rtree_iter_item {
+   struct rtree_node *node;
+   int index;
+};
+
+struct rtree_iter {
+   struct rtree_iter_item items[RTREE_HEIGHT_MAX];
+   int count;
+};
+
+/* Called for every value overlapping the box with index box in a batch query. */
+typedef void (*rtree_batch_func)(void *value, int box, void *data);
 
-struct rtree *rtree_create();
+struct rtree *rtree_create (void);
 void rtree_free(struct rtree *tree);
-void rtree_insert(struct rtree *tree, Pilot *pilot);
-struct rtree_iter *rtree_begin(struct rtree *tree);
-void rtree_iter_free(struct rtree_iter *iter);
-Pilot* rtree_find(struct rtree_iter *iter, double x1, double x2, double y1, double y2);
+void rtree_clear(struct rtree *tree);
+void rtree_insert(struct rtree *tree, void *value, struct rtree_node **ref,
+      double x1, double x2, double y1, double y2);
+void rtree_update(struct rtree *tree, void *value, struct rtree_node **ref,
+      double x1, double x2, double y1, double y2, double margin);
+void rtree_remove(struct rtree *tree, void *value, struct rtree_node **ref);
+void rtree_rebuild(struct rtree *tree);
+int rtree_count(struct rtree *tree);
+void rtree_begin(struct rtree *tree, struct rtree_iter *iter);
+void* rtree_find(struct rtree_iter *iter, double x1, double x2, double y1, double y2);
+void rtree_findBatch(struct rtree *tree, const struct bounding_rectangle *boxes, int nboxes,
+      rtree_batch_func func, void *data);
 void rtree_draw(struct rtree *tree, double res);
 
 #endif
@@ -0,0 +1,416 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file scenario.c
+ *
+ * @brief Reproducible headless runs used for benchmarking.
+ *
+ * A scenario pins down everything that would otherwise vary between runs: the
+ * random seed, the system, the fleets that get spawned and when, and the
+ * time compression. The tick length is fixed by the caller. Runs can also be
+ * traced, a trace being the state checksum every SCENARIO_TRACE_INTERVAL
+ * ticks, so a later run can check it replays the same simulation.
+ */
+
+#include "scenario.h"
+
+#include "naev.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "nstring.h"
+
+#include "log.h"
+#include "nxml.h"
+#include "ndata.h"
+#include "array.h"
+#include "rng.h"
+#include "space.h"
+#include "fleet.h"
+#include "pilot.h"
+
+
+#define XML_SCENARIO_ID    "scenario" /**< XML document tag of scenario files. */
+
+#define SCENARIO_SPREAD    150. /**< How far from its position a fleet member can appear. */
+
+#define FNV_OFFSET         2166136261u /**< FNV-1a offset basis. */
+#define FNV_PRIME          16777619u /**< FNV-1a prime. */
+
+
+static FILE *trace_fp      = NULL; /**< Trace being recorded or replayed. */
+static int trace_replay    = 0; /**< Whether the trace is being compared against. */
+
+
+/*
+ * Prototypes.
+ */
+static int scenario_parse( Scenario *sc, xmlNodePtr parent, const char *file );
+static void scenario_spawn( const ScenarioFleet *sf );
+static uint32_t scenario_hash( uint32_t h, const void *data, size_t len );
+
+
+/**
+ * @brief Sets up a scenario that simply runs a system.
+ *
+ *    @param sc Scenario to set up.
+ *    @param system System to simulate.
+ *    @param ticks Ticks to simulate.
+ *    @param seed Random seed.
+ */
+void scenario_init( Scenario *sc, const char *system, int ticks, uint32_t seed )
+{
+   memset( sc, 0, sizeof(Scenario) );
+   sc->name          = strdup( system );
+   sc->system        = strdup( system );
+   sc->seed          = seed;
+   sc->ticks         = ticks;
+   sc->compression   = 1.;
+   sc->scheduler     = 1;
+   sc->fleets        = array_create( ScenarioFleet );
+}
+
+
+/**
+ * @brief Loads a scenario from SCENARIO_DATA_PATH.
+ *
+ *    @param sc Scenario to load into.
+ *    @param name Name of the scenario file without extension.
+ *    @return 0 on success.
+ */
+int scenario_load( Scenario *sc, const char *name )
+{
+   char file[PATH_MAX];
+   size_t bufsize;
+   char *buf;
+   xmlNodePtr node;
+   xmlDocPtr doc;
+   int ret;
+
+   nsnprintf( file, sizeof(file), SCENARIO_DATA_PATH"%s.xml", name );
+
+   /* Try to read the file. */
+   buf = ndata_read( file, &bufsize );
+   if (buf == NULL) {
+      WARN( _("Scenario '%s' not found!"), file );
+      return -1;
+   }
+
+   /* Load the XML file. */
+   doc = xmlParseMemory( buf, bufsize );
+   free(buf);
+   if (doc == NULL) {
+      WARN( _("Unable to parse scenario '%s'!"), file );
+      return -1;
+   }
+
+   node = doc->xmlChildrenNode;
+   if (!xml_isNode(node,XML_SCENARIO_ID)) {
+      WARN( _("Malformed '%s' file: missing root element '%s'"), file, XML_SCENARIO_ID );
+      xmlFreeDoc(doc);
+      return -1;
+   }
+
+   /* Defaults. */
+   memset( sc, 0, sizeof(Scenario) );
+   sc->compression   = 1.;
+   sc->scheduler     = 1;
+   sc->fleets        = array_create( ScenarioFleet );
+   xmlr_attr( node, "name", sc->name );
+   if (sc->name == NULL)
+      sc->name = strdup( name );
+
+   ret = scenario_parse( sc, node, file );
+   xmlFreeDoc(doc);
+   if (ret != 0)
+      scenario_free( sc );
+   return ret;
+}
+
+
+/**
+ * @brief Parses the contents of a scenario.
+ *
+ *    @param sc Scenario to fill.
+ *    @param parent Root node of the scenario.
+ *    @param file File being parsed, for warnings.
+ *    @return 0 on success.
+ */
+static int scenario_parse( Scenario *sc, xmlNodePtr parent, const char *file )
+{
+   xmlNodePtr node;
+   ScenarioFleet *sf;
+   char *buf;
+
+   node = parent->xmlChildrenNode;
+   do {
+      xml_onlyNodes(node);
+
+      xmlr_strd( node, "system", sc->system );
+      xmlr_uint( node, "seed", sc->seed );
+      xmlr_int( node, "ticks", sc->ticks );
+      xmlr_float( node, "compression", sc->compression );
+      xmlr_int( node, "scheduler", sc->scheduler );
+
+      if (xml_isNode(node,"fleet")) {
+         sf = &array_grow( &sc->fleets );
+         memset( sf, 0, sizeof(ScenarioFleet) );
+         sf->fleet = xml_getStrd( node );
+         sf->count = 1;
+         xmlr_attr( node, "tick", buf );
+         if (buf != NULL) {
+            sf->tick = atoi( buf );
+            free( buf );
+         }
+         xmlr_attr( node, "x", buf );
+         if (buf != NULL) {
+            sf->x = atof( buf );
+            free( buf );
+         }
+         xmlr_attr( node, "y", buf );
+         if (buf != NULL) {
+            sf->y = atof( buf );
+            free( buf );
+         }
+         xmlr_attr( node, "count", buf );
+         if (buf != NULL) {
+            sf->count = atoi( buf );
+            free( buf );
+         }
+         if ((sf->fleet == NULL) || (fleet_get( sf->fleet ) == NULL))
+            WARN( _("Scenario '%s' has unknown fleet '%s'."), file, sf->fleet );
+         continue;
+      }
+
+      WARN( _("Scenario '%s' has unknown node '%s'."), file, node->name );
+   } while (xml_nextNode(node));
+
+   /* Sanity. */
+   if ((sc->system == NULL) || !system_exists( sc->system )) {
+      WARN( _("Scenario '%s' has invalid or no system."), file );
+      return -1;
+   }
+   if (sc->compression <= 0.) {
+      WARN( _("Scenario '%s' has invalid compression %f."), file, sc->compression );
+      sc->compression = 1.;
+   }
+
+   return 0;
+}
+
+
+/**
+ * @brief Frees a scenario.
+ *
+ *    @param sc Scenario to free.
+ */
+void scenario_free( Scenario *sc )
+{
+   int i;
+
+   for (i=0; i<array_size(sc->fleets); i++)
+      free( sc->fleets[i].fleet );
+   array_free( sc->fleets );
+   free( sc->name );
+   free( sc->system );
+   memset( sc, 0, sizeof(Scenario) );
+}
+
+
+/**
+ * @brief Seeds the random number generators and enters the scenario system.
+ *
+ *    @param sc Scenario to start.
+ *    @return 0 on success.
+ */
+int scenario_start( const Scenario *sc )
+{
+   if (!system_exists( sc->system )) {
+      WARN( _("System '%s' not found!"), sc->system );
+      return -1;
+   }
+
+   /* Lua's math.random uses the C library generator. */
+   rng_seed( sc->seed );
+   srand( sc->seed );
+
+   space_init( sc->system );
+
+   /* Only the scenario fleets take part. */
+   if (!sc->scheduler) {
+      space_spawn = 0;
+      pilots_clear();
+   }
+
+   return 0;
+}
+
+
+/**
+ * @brief Spawns the fleets due on a tick.
+ *
+ *    @param sc Scenario being run.
+ *    @param tick Tick about to be simulated.
+ */
+void scenario_update( const Scenario *sc, int tick )
+{
+   int i;
+
+   for (i=0; i<array_size(sc->fleets); i++)
+      if (sc->fleets[i].tick == tick)
+         scenario_spawn( &sc->fleets[i] );
+}
+
+
+/**
+ * @brief Spawns a scenario fleet around its position, facing the system centre.
+ *
+ *    @param sf Fleet to spawn.
+ */
+static void scenario_spawn( const ScenarioFleet *sf )
+{
+   Fleet *flt;
+   Vector2d vp, vv;
+   PilotFlags flags;
+   double a;
+   int i, j;
+
+   flt = fleet_get( sf->fleet );
+   if (flt == NULL)
+      return;
+
+   pilot_clearFlagsRaw( flags );
+   vect_cset( &vv, 0., 0. );
+   for (i=0; i<sf->count; i++) {
+      for (j=0; j<flt->npilots; j++) {
+         vect_cset( &vp, sf->x + RNGF()*2.*SCENARIO_SPREAD - SCENARIO_SPREAD,
+               sf->y + RNGF()*2.*SCENARIO_SPREAD - SCENARIO_SPREAD );
+         a = ANGLE( -vp.x, -vp.y );
+         if (a < 0.)
+            a += 2.*M_PI;
+         fleet_createPilot( flt, &flt->pilots[j], a, &vp, &vv, NULL, flags );
+      }
+   }
+}
+
+
+/**
+ * @brief Hashes data into a running FNV-1a hash.
+ */
+static uint32_t scenario_hash( uint32_t h, const void *data, size_t len )
+{
+   const unsigned char *c;
+   size_t i;
+
+   c = data;
+   for (i=0; i<len; i++) {
+      h ^= c[i];
+      h *= FNV_PRIME;
+   }
+   return h;
+}
+
+
+/**
+ * @brief Checksums the state of all the pilots.
+ *
+ * Any difference in physics, AI decisions or damage ends up in here.
+ *
+ *    @return The checksum.
+ */
+uint32_t scenario_checksum (void)
+{
+   Pilot **pilots;
+   Pilot *p;
+   int i, n;
+   uint32_t h;
+
+   pilots = pilot_getAll( &n );
+   h = scenario_hash( FNV_OFFSET, &n, sizeof(n) );
+   for (i=0; i<n; i++) {
+      p = pilots[i];
+      h = scenario_hash( h, &p->id, sizeof(p->id) );
+      h = scenario_hash( h, &p->solid->pos, sizeof(p->solid->pos) );
+      h = scenario_hash( h, &p->solid->vel, sizeof(p->solid->vel) );
+      h = scenario_hash( h, &p->solid->dir, sizeof(p->solid->dir) );
+      h = scenario_hash( h, &p->armour, sizeof(p->armour) );
+      h = scenario_hash( h, &p->shield, sizeof(p->shield) );
+      h = scenario_hash( h, &p->energy, sizeof(p->energy) );
+   }
+   return h;
+}
+
+
+/**
+ * @brief Opens a trace, replaying it if it exists and recording it otherwise.
+ *
+ *    @param path Path of the trace file.
+ *    @return 0 on success.
+ */
+int scenario_traceOpen( const char *path )
+{
+   trace_fp = fopen( path, "r" );
+   if (trace_fp != NULL) {
+      trace_replay = 1;
+      LOG( _("Replaying trace '%s'"), path );
+      return 0;
+   }
+
+   trace_fp = fopen( path, "w" );
+   if (trace_fp == NULL) {
+      WARN( _("Unable to open trace '%s' for writing!"), path );
+      return -1;
+   }
+   trace_replay = 0;
+   LOG( _("Recording trace '%s'"), path );
+   return 0;
+}
+
+
+/**
+ * @brief Records or checks the state checksum after a tick.
+ *
+ *    @param tick Tick that was just simulated.
+ *    @return 0 if the run matches the trace so far, -1 if it diverged or the
+ *            trace ended.
+ */
+int scenario_trace( int tick )
+{
+   int t;
+   unsigned int h, ref;
+
+   if ((trace_fp == NULL) || (tick % SCENARIO_TRACE_INTERVAL != 0))
+      return 0;
+
+   h = scenario_checksum();
+   if (!trace_replay) {
+      fprintf( trace_fp, "%d %08x\n", tick, h );
+      return 0;
+   }
+
+   /* A trace that ends before the run can't vouch for it. */
+   if (fscanf( trace_fp, "%d %x", &t, &ref ) != 2) {
+      WARN( _("Trace ended before tick %d, it is truncated or was recorded with fewer ticks!"),
+            tick );
+      return -1;
+   }
+   if ((t != tick) || (h != ref)) {
+      WARN( _("Run diverged from the trace at tick %d (%08x, expected %08x at tick %d)!"),
+            tick, h, ref, t );
+      return -1;
+   }
+   return 0;
+}
+
+
+/**
+ * @brief Closes the trace.
+ */
+void scenario_traceClose (void)
+{
+   if (trace_fp != NULL)
+      fclose( trace_fp );
+   trace_fp = NULL;
+}
@@ -0,0 +1,67 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+#ifndef SCENARIO_H
+#  define SCENARIO_H
+
+
+#include <stdint.h>
+
+
+#define SCENARIO_TRACE_INTERVAL  60 /**< Ticks between two checksums in a trace. */
+
+
+/**
+ * @brief A fleet spawned by a scenario.
+ */
+typedef struct ScenarioFleet_ {
+   char *fleet; /**< Name of the fleet to spawn. */
+   int tick; /**< Tick to spawn it on. */
+   double x; /**< X position to spawn around. */
+   double y; /**< Y position to spawn around. */
+   int count; /**< Times to spawn the fleet. */
+} ScenarioFleet;
+
+
+/**
+ * @brief A reproducible headless run.
+ *
+ * With the same seed, fleets and fixed tick the simulation replays bit for
+ * bit, which is what makes the timings comparable between builds.
+ */
+typedef struct Scenario_ {
+   char *name; /**< Human readable name. */
+   char *system; /**< System to simulate. */
+   uint32_t seed; /**< Random seed. */
+   int ticks; /**< Ticks to simulate. */
+   double compression; /**< Time compression, game time per tick over the tick length. */
+   int scheduler; /**< Whether the system spawns its own pilots. */
+   ScenarioFleet *fleets; /**< Fleets to spawn (array.h). */
+} Scenario;
+
+
+/*
+ * Loading.
+ */
+void scenario_init( Scenario *sc, const char *system, int ticks, uint32_t seed );
+int scenario_load( Scenario *sc, const char *name );
+void scenario_free( Scenario *sc );
+
+/*
+ * Running.
+ */
+int scenario_start( const Scenario *sc );
+void scenario_update( const Scenario *sc, int tick );
+uint32_t scenario_checksum (void);
+
+/*
+ * Traces.
+ */
+int scenario_traceOpen( const char *path );
+int scenario_trace( int tick );
+void scenario_traceClose (void);
+
+
+#endif /* SCENARIO_H */
@@ -28,6 +28,7 @@
 #include "shipstats.h"
 #include "slots.h"
 #include "nfile.h"
+#include "nhash.h"
 
 
 #define XML_SHIP  "ship" /**< XML individual ship identifier. */
@@ -47,6 +48,7 @@
 
 
 static Ship* ship_stack = NULL; /**< Stack of ships available in the game. */
+static NHash* ship_hash = NULL; /**< Ship name to index in the stack. */
 
 
 /*
@@ -64,13 +66,11 @@ static int ship_parse( Ship *temp, xmlNodePtr parent );
  */
 Ship* ship_get( const char* name )
 {
-   Ship *temp;
    int i;
 
-   temp = ship_stack;
-   for (i=0; i < array_size(ship_stack); i++)
-      if (strcmp(temp[i].name, name)==0)
-         return &temp[i];
+   i = nhash_get( ship_hash, name );
+   if (i >= 0)
+      return &ship_stack[i];
 
    WARN(_("Ship %s does not exist"), name);
    return NULL;
@@ -85,15 +85,10 @@ Ship* ship_get( const char* name )
  */
 Ship* ship_getW( const char* name )
 {
-   Ship *temp;
    int i;
 
-   temp = ship_stack;
-   for (i=0; i < array_size(ship_stack); i++)
-      if (strcmp(temp[i].name, name)==0)
-         return &temp[i];
-
-   return NULL;
+   i = nhash_get( ship_hash, name );
+   return (i >= 0) ? &ship_stack[i] : NULL;
 }
 
 
@@ -324,7 +319,7 @@ credits_t ship_buyPrice( const Ship* s )
 glTexture* ship_loadCommGFX( Ship* s )
 {
    if (s->gfx_comm != NULL)
-      return gl_newImage( s->gfx_comm, 0 );
+      return gl_newImageAsync( s->gfx_comm, 0 );
    return NULL;
 }
 
@@ -909,7 +904,8 @@ static int ship_parse( Ship *temp, xmlNodePtr parent )
 int ships_load (void)
 {
    size_t bufsize, nfiles;
-   char *buf, **ship_files, *file;
+   const char *buf;
+   char **ship_files, *file;
    int i, sl;
    xmlNodePtr node;
    xmlDocPtr doc;
@@ -931,11 +927,11 @@ int ships_load (void)
       nsnprintf( file, sl, "%s%s", SHIP_DATA_PATH, ship_files[i] );
 
       /* Load the XML. */
-      buf  = ndata_read( file, &bufsize );
+      buf  = ndata_map( file, &bufsize );
       doc  = xmlParseMemory( buf, bufsize );
 
       if (doc == NULL) {
-         free(buf);
+         ndata_unmap( buf, bufsize );
          WARN(_("%s file is invalid xml!"), file);
          free(file);
          continue;
@@ -944,7 +940,7 @@ int ships_load (void)
       node = doc->xmlChildrenNode; /* First ship node */
       if (node == NULL) {
          xmlFreeDoc(doc);
-         free(buf);
+         ndata_unmap( buf, bufsize );
          WARN(_("Malformed %s file: does not contain elements"), file);
          free(file);
          continue;
@@ -958,11 +954,17 @@ int ships_load (void)
 
       /* Clean up. */
       xmlFreeDoc(doc);
-      free(buf);
+      ndata_unmap( buf, bufsize );
    }
 
    /* Shrink stack. */
    array_shrink(&ship_stack);
+
+   /* Index the names, backwards so the first of duplicates wins like a scan. */
+   nhash_free( ship_hash );
+   ship_hash = nhash_create( array_size(ship_stack) );
+   for (i=array_size(ship_stack)-1; i>=0; i--)
+      nhash_set( ship_hash, ship_stack[i].name, i );
    DEBUG( ngettext( "Loaded %d Ship", "Loaded %d Ships", array_size(ship_stack) ), array_size(ship_stack) );
 
    /* Clean up. */
@@ -1024,4 +1026,6 @@ void ships_free (void)
 
    array_free(ship_stack);
    ship_stack = NULL;
+   nhash_free(ship_hash);
+   ship_hash = NULL;
 }
@@ -52,6 +52,7 @@
 #include "damagetype.h"
 #include "hook.h"
 #include "dev_uniedit.h"
+#include "nhash.h"
 
 
 #define XML_PLANET_TAG        "asset" /**< Individual planet xml tag. */
@@ -72,13 +73,15 @@
 
 #define DEBRIS_BUFFER         1000 /**< Buffer to smooth appearance of debris */
 
+#define ASTEROID_GRID_CELL    256. /**< Smallest size of an asteroid grid cell. */
+#define ASTEROID_GRID_MAX     64 /**< Most cells of an asteroid grid along an axis. */
+
 /*
- * planet <-> system name stack
+ * Name lookups.
  */
-static char** planetname_stack = NULL; /**< Planet name stack corresponding to system. */
-static char** systemname_stack = NULL; /**< System name stack corresponding to planet. */
-static int spacename_nstack = 0; /**< Size of planet<->system stack. */
-static int spacename_mstack = 0; /**< Size of memory in planet<->system stack. */
+static NHash *systems_hash    = NULL; /**< System name to system index. */
+static NHash *planet_hash     = NULL; /**< Planet name to planet index. */
+static NHash *planet_sysHash  = NULL; /**< Planet name to index of the system it is in. */
 
 
 /*
@@ -142,6 +145,10 @@ static int space_parseAssets( xmlNodePtr parent, StarSystem* sys );
 /* system load */
 static void system_init( StarSystem *sys );
 static void asteroid_init( Asteroid *ast, AsteroidAnchor *field );
+static void asteroid_gridInit( AsteroidAnchor *field );
+static void asteroid_gridUpdate( AsteroidAnchor *field );
+static int asteroid_gridCoord( double v, double orig, double cell, int n );
+static int asteroid_gridCell( const AsteroidAnchor *field, const Vector2d *pos );
 static void debris_init( Debris *deb );
 static int systems_load (void);
 static int asteroidTypes_load (void);
@@ -503,12 +510,12 @@ char* space_getRndPlanet( int landable, unsigned int services,
  */
 double system_getClosest( const StarSystem *sys, int *pnt, int *jp, int *ast, int *fie, double x, double y )
 {
-   int i, k;
-   double d, td;
+   int i;
+   double d, td, r;
    Planet *p;
    JumpPoint *j;
    Asteroid *as;
-   AsteroidAnchor *f;
+   AsteroidIter iter;
 
    /* Default output. */
    *pnt = -1;
@@ -529,18 +536,19 @@ double system_getClosest( const StarSystem *sys, int *pnt, int *jp, int *ast, in
       }
    }
 
-   /* Asteroids. */
-   for (i=0; i<sys->nasteroids; i++) {
-      f = &sys->asteroids[i];
-      for (k=0; k<f->nb; k++) {
-         as = &f->asteroids[k];
-         td = pow2(x-as->pos.x) + pow2(y-as->pos.y);
-         if (td < d) {
-            *pnt  = -1; /* We must clear planet target as asteroid is closer. */
-            *ast  = k;
-            *fie  = i;
-            d     = td;
-         }
+   /* Asteroids, only the ones closer than every planet and jump can win. */
+   r = d;
+   for (i=0; i<sys->njumps; i++)
+      r = MIN( r, pow2(x-sys->jumps[i].pos.x) + pow2(y-sys->jumps[i].pos.y) );
+   r = sqrt(r);
+   asteroid_queryBegin( &iter, sys, x-r, x+r, y-r, y+r );
+   while ((as = asteroid_queryNext( &iter )) != NULL) {
+      td = pow2(x-as->pos.x) + pow2(y-as->pos.y);
+      if (td < d) {
+         *pnt  = -1; /* We must clear planet target as asteroid is closer. */
+         *ast  = as->id;
+         *fie  = as->parent;
+         d     = td;
       }
    }
 
@@ -659,17 +667,14 @@ int space_sysReachable( StarSystem *sys )
  */
 int space_sysReallyReachable( char* sysname )
 {
-   int njumps;
-   StarSystem** path;
+   StarSystem *sys;
 
    if (strcmp(sysname,cur_system->name)==0)
       return 1;
-   path = map_getJumpPath( &njumps, cur_system->name, sysname, 1, 1, NULL );
-   if (path != NULL) {
-      free(path);
-      return 1;
-   }
-   return 0;
+   sys = system_get( sysname );
+   if (sys == NULL)
+      return 0;
+   return (map_getJumpDist( cur_system, sys, 1, 1 ) > 0);
 }
 
 /**
@@ -711,11 +716,7 @@ StarSystem* system_getAll( int *nsys )
  */
 int system_exists( const char* sysname )
 {
-   int i;
-   for (i=0; i<systems_nstack; i++)
-      if (strcmp(sysname, systems_stack[i].name)==0)
-         return 1;
-   return 0;
+   return (nhash_get( systems_hash, sysname ) >= 0);
 }
 
 
@@ -778,9 +779,9 @@ StarSystem* system_get( const char* sysname )
 {
    int i;
 
-   for (i=0; i<systems_nstack; i++)
-      if (strcmp(sysname, systems_stack[i].name)==0)
-         return &systems_stack[i];
+   i = nhash_get( systems_hash, sysname );
+   if (i >= 0)
+      return &systems_stack[i];
 
    WARN(_("System '%s' not found in stack"), sysname);
    return NULL;
@@ -821,9 +822,9 @@ char* planet_getSystem( const char* planetname )
 {
    int i;
 
-   for (i=0; i<spacename_nstack; i++)
-      if (strcmp(planetname_stack[i],planetname)==0)
-         return systemname_stack[i];
+   i = nhash_get( planet_sysHash, planetname );
+   if (i >= 0)
+      return systems_stack[i].name;
 
    DEBUG(_("Planet '%s' not found in planetname stack"), planetname);
    return NULL;
@@ -845,9 +846,9 @@ Planet* planet_get( const char* planetname )
       return NULL;
    }
 
-   for (i=0; i<planet_nstack; i++)
-      if (strcmp(planet_stack[i].name,planetname)==0)
-         return &planet_stack[i];
+   i = nhash_get( planet_hash, planetname );
+   if (i >= 0)
+      return &planet_stack[i];
 
    WARN(_("Planet '%s' not found in the universe"), planetname);
    return NULL;
@@ -915,11 +916,7 @@ void planet_setKnown( Planet *p )
  */
 int planet_exists( const char* planetname )
 {
-   int i;
-   for (i=0; i<planet_nstack; i++)
-      if (strcmp(planet_stack[i].name,planetname)==0)
-         return 1;
-   return 0;
+   return (nhash_get( planet_hash, planetname ) >= 0);
 }
 
 
@@ -1258,6 +1255,7 @@ void space_update( const double dt )
       for (i=0; i<cur_system->njumps; i++)
          if (( !jp_isKnown( &cur_system->jumps[i] )) && ( pilot_inRangeJump( player.p, i ))) {
             jp_setFlag( &cur_system->jumps[i], JP_KNOWN );
+            map_jumpDistInvalidate( 1 );
             player_message( _("You discovered a Jump Point.") );
             hparam[0].type  = HOOK_PARAM_STRING;
             hparam[0].u.str = "jump";
@@ -1318,6 +1316,9 @@ void space_update( const double dt )
          }
       }
 
+      /* Asteroids moved, sort them into the grid again. */
+      asteroid_gridUpdate( ast );
+
       x = 0;
       y = 0;
       pplayer = pilot_get( PLAYER_ID );
@@ -1431,6 +1432,7 @@ void space_init( const char* sysname )
          a->id = j;
          asteroid_init(a, ast);
       }
+      asteroid_gridInit( ast );
       /* Add the debris to the anchor */
       ast->debris = malloc( (ast->ndebris) * sizeof(Debris) );
       for (j=0; j<ast->ndebris; j++) {
@@ -1468,6 +1470,7 @@ void space_init( const char* sysname )
 
    /* we now know this system */
    sys_setFlag(cur_system,SYSTEM_KNOWN);
+   map_jumpDistInvalidate( 1 );
 
    /* Simulate system. */
    space_simulating = 1;
@@ -1556,6 +1559,223 @@ void asteroid_init( Asteroid *ast, AsteroidAnchor *field )
 }
 
 
+/**
+ * @brief Sets up the grid the asteroids of a field are sorted into.
+ *
+ * The grid covers the corners of the field plus a cell of padding for the
+ * asteroids drifting out while they shrink, anything further out is kept in
+ * the border cells.
+ *
+ *    @param field Field to set up the grid of, with its asteroids placed.
+ */
+static void asteroid_gridInit( AsteroidAnchor *field )
+{
+   int i, j;
+   double x1, x2, y1, y2;
+   AsteroidType *at;
+
+   /* Bounds of the field. */
+   x1 = x2 = (field->ncorners > 0) ? field->corners[0].x : field->pos.x;
+   y1 = y2 = (field->ncorners > 0) ? field->corners[0].y : field->pos.y;
+   for (i=1; i<field->ncorners; i++) {
+      x1 = MIN( x1, field->corners[i].x );
+      x2 = MAX( x2, field->corners[i].x );
+      y1 = MIN( y1, field->corners[i].y );
+      y2 = MAX( y2, field->corners[i].y );
+   }
+
+   /* Grow the cells for huge fields instead of having a huge grid. */
+   field->grid_cell = MAX( ASTEROID_GRID_CELL,
+         MAX( x2-x1, y2-y1 ) / (ASTEROID_GRID_MAX-2) );
+   field->grid_x    = x1 - field->grid_cell;
+   field->grid_y    = y1 - field->grid_cell;
+   field->grid_w    = (int)ceil( (x2-x1) / field->grid_cell ) + 2;
+   field->grid_h    = (int)ceil( (y2-y1) / field->grid_cell ) + 2;
+
+   /* Asteroids are sorted by their centre, so queries need to be padded by
+    * the largest one (and a pixel for the rounding CollideSprite does). */
+   field->grid_margin = 0.;
+   for (i=0; i<field->ntype; i++) {
+      at = &asteroid_types[ field->type[i] ];
+      for (j=0; j<at->ngfx; j++)
+         field->grid_margin = MAX( field->grid_margin,
+               MAX( at->gfxs[j]->sw, at->gfxs[j]->sh ) / 2. + 1. );
+   }
+
+   free( field->grid_start );
+   free( field->grid_ids );
+   field->grid_start = malloc( (field->grid_w*field->grid_h+1) * sizeof(int) );
+   field->grid_ids   = malloc( MAX(field->nb,1) * sizeof(int) );
+   asteroid_gridUpdate( field );
+}
+
+
+/**
+ * @brief Sorts the asteroids of a field into its grid.
+ *
+ * It's a counting sort, so asteroids stay in index order within a cell and
+ * nothing gets allocated.
+ *
+ *    @param field Field to sort the asteroids of.
+ */
+static void asteroid_gridUpdate( AsteroidAnchor *field )
+{
+   int i, c, ncells;
+   int *start;
+
+   ncells = field->grid_w * field->grid_h;
+   start  = field->grid_start;
+
+   memset( start, 0, (ncells+1) * sizeof(int) );
+   for (i=0; i<field->nb; i++)
+      start[ asteroid_gridCell( field, &field->asteroids[i].pos ) ]++;
+
+   /* Turn the counts into the end of every cell. */
+   for (c=1; c<ncells; c++)
+      start[c] += start[c-1];
+   start[ncells] = field->nb;
+
+   /* Filling backwards leaves every start at the beginning of its cell. */
+   for (i=field->nb-1; i>=0; i--) {
+      c = asteroid_gridCell( field, &field->asteroids[i].pos );
+      field->grid_ids[ --start[c] ] = i;
+   }
+}
+
+
+/**
+ * @brief Gets the grid row or column of a coordinate, clamped to the grid.
+ *
+ *    @param v Coordinate.
+ *    @param orig Coordinate of the grid's edge.
+ *    @param cell Size of a cell.
+ *    @param n Number of cells along the axis.
+ *    @return Row or column of the coordinate.
+ */
+static int asteroid_gridCoord( double v, double orig, double cell, int n )
+{
+   double c;
+
+   /* Clamp as double first, the coordinate may be infinite. */
+   c = floor( (v-orig) / cell );
+   if (c < 0.)
+      return 0;
+   if (c > (double)(n-1))
+      return n-1;
+   return (int)c;
+}
+
+
+/**
+ * @brief Gets the grid cell a position falls in.
+ *
+ *    @param field Field whose grid is used.
+ *    @param pos Position to look up.
+ *    @return Index of the cell.
+ */
+static int asteroid_gridCell( const AsteroidAnchor *field, const Vector2d *pos )
+{
+   return asteroid_gridCoord( pos->y, field->grid_y, field->grid_cell, field->grid_h ) * field->grid_w
+         + asteroid_gridCoord( pos->x, field->grid_x, field->grid_cell, field->grid_w );
+}
+
+
+/**
+ * @brief Starts walking the asteroids that may overlap a box.
+ *
+ * Returns every asteroid whose sprite could overlap the box, the actual
+ * overlap still has to be checked by the caller. Walking allocates nothing,
+ * but the asteroids must not move meanwhile.
+ *
+ * @usage
+ * asteroid_queryBegin( &iter, cur_system, x1, x2, y1, y2 );
+ * while ((a = asteroid_queryNext( &iter )) != NULL)
+ *    ...
+ *
+ *    @param[out] iter Iterator to set up.
+ *    @param sys System to walk, must have its asteroids set up (cur_system).
+ *    @param x1 Left of the box.
+ *    @param x2 Right of the box.
+ *    @param y1 Bottom of the box.
+ *    @param y2 Top of the box.
+ */
+void asteroid_queryBegin( AsteroidIter *iter, const StarSystem *sys,
+      double x1, double x2, double y1, double y2 )
+{
+   iter->sys   = sys;
+   iter->field = -1;
+   iter->x1    = x1;
+   iter->x2    = x2;
+   iter->y1    = y1;
+   iter->y2    = y2;
+   /* Out of cells, so the first call moves on to the first field. */
+   iter->cx1   = 0;
+   iter->cx2   = 0;
+   iter->cy2   = 0;
+   iter->cx    = 0;
+   iter->cy    = 0;
+   iter->k     = 0;
+   iter->end   = 0;
+}
+
+
+/**
+ * @brief Gets the next asteroid that may overlap the box of an iterator.
+ *
+ *    @param iter Iterator set up by asteroid_queryBegin().
+ *    @return The next asteroid or NULL when there are no more.
+ */
+Asteroid* asteroid_queryNext( AsteroidIter *iter )
+{
+   int c, cy1;
+   double m;
+   const AsteroidAnchor *field;
+   Asteroid *a;
+
+   for (;;) {
+      /* Entries left in the current cell. */
+      if (iter->k < iter->end) {
+         field = &iter->sys->asteroids[ iter->field ];
+         m     = field->grid_margin;
+         a     = &field->asteroids[ field->grid_ids[ iter->k++ ] ];
+         if ((a->pos.x >= iter->x1-m) && (a->pos.x <= iter->x2+m) &&
+               (a->pos.y >= iter->y1-m) && (a->pos.y <= iter->y2+m))
+            return a;
+         continue;
+      }
+
+      /* Next cell of the box. */
+      if (iter->cx < iter->cx2)
+         iter->cx++;
+      else if (iter->cy < iter->cy2) {
+         iter->cx = iter->cx1;
+         iter->cy++;
+      }
+      /* Next field. */
+      else {
+         do {
+            iter->field++;
+            if (iter->field >= iter->sys->nasteroids)
+               return NULL;
+         } while (iter->sys->asteroids[ iter->field ].grid_start == NULL);
+         field     = &iter->sys->asteroids[ iter->field ];
+         m         = field->grid_margin;
+         iter->cx1 = asteroid_gridCoord( iter->x1-m, field->grid_x, field->grid_cell, field->grid_w );
+         iter->cx2 = asteroid_gridCoord( iter->x2+m, field->grid_x, field->grid_cell, field->grid_w );
+         cy1       = asteroid_gridCoord( iter->y1-m, field->grid_y, field->grid_cell, field->grid_h );
+         iter->cy2 = asteroid_gridCoord( iter->y2+m, field->grid_y, field->grid_cell, field->grid_h );
+         iter->cx  = iter->cx1;
+         iter->cy  = cy1;
+      }
+
+      field     = &iter->sys->asteroids[ iter->field ];
+      c         = iter->cy * field->grid_w + iter->cx;
+      iter->k   = field->grid_start[c];
+      iter->end = field->grid_start[c+1];
+   }
+}
+
+
 /**
  * @brief Initializes a debris.
  *    @param deb Debris to initialize.
@@ -1613,6 +1833,30 @@ Planet *planet_new (void)
 }
 
 
+/**
+ * @brief Sets the name of a planet, keeping the name lookups current.
+ *
+ *    @param p Planet to name.
+ *    @param name Name to set, the planet takes ownership.
+ */
+void planet_setName( Planet *p, char *name )
+{
+   int sys;
+
+   if (planet_hash == NULL)
+      planet_hash = nhash_create( planet_mstack );
+   nhash_rename( planet_hash, p->name, name, p->id );
+   if ((p->name != NULL) && (planet_sysHash != NULL)) {
+      sys = nhash_remove( planet_sysHash, p->name );
+      if (sys >= 0)
+         nhash_set( planet_sysHash, name, sys );
+   }
+
+   free( p->name );
+   p->name = name;
+}
+
+
 /**
  * @brief Loads all the planets in the game.
  *
@@ -1621,7 +1865,8 @@ Planet *planet_new (void)
 static int planets_load ( void )
 {
    size_t bufsize;
-   char *buf, **planet_files, *file;
+   const char *buf;
+   char **planet_files, *file;
    xmlNodePtr node;
    xmlDocPtr doc;
    Planet *p;
@@ -1631,14 +1876,14 @@ static int planets_load ( void )
    /* Load landing stuff. */
    landing_env = nlua_newEnv(0);
    nlua_loadStandard(landing_env);
-   buf         = ndata_read( LANDING_DATA_PATH, &bufsize );
+   buf         = ndata_map( LANDING_DATA_PATH, &bufsize );
    if (nlua_dobufenv(landing_env, buf, bufsize, LANDING_DATA_PATH) != 0) {
       WARN( _("Failed to load landing file: %s\n"
             "%s\n"
             "Most likely Lua file has improper syntax, please check"),
             LANDING_DATA_PATH, lua_tostring(naevL,-1));
    }
-   free(buf);
+   ndata_unmap( buf, bufsize );
 
    /* Initialize stack if needed. */
    if (planet_stack == NULL) {
@@ -1646,6 +1891,8 @@ static int planets_load ( void )
       planet_stack = malloc( sizeof(Planet) * planet_mstack );
       planet_nstack = 0;
    }
+   if (planet_hash == NULL)
+      planet_hash = nhash_create( planet_mstack );
 
    /* Load XML stuff. */
    planet_files = ndata_list( PLANET_DATA_PATH, &nfiles );
@@ -1653,12 +1900,12 @@ static int planets_load ( void )
       len  = (strlen(PLANET_DATA_PATH)+strlen(planet_files[i])+2);
       file = malloc( len );
       nsnprintf( file, len,"%s%s",PLANET_DATA_PATH,planet_files[i]);
-      buf  = ndata_read( file, &bufsize );
+      buf  = ndata_map( file, &bufsize );
       doc  = xmlParseMemory( buf, bufsize );
       if (doc == NULL) {
          WARN(_("%s file is invalid xml!"),file);
          free(file);
-         free(buf);
+         ndata_unmap( buf, bufsize );
          continue;
       }
 
@@ -1667,19 +1914,20 @@ static int planets_load ( void )
          WARN(_("Malformed %s file: does not contain elements"),file);
          free(file);
          xmlFreeDoc(doc);
-         free(buf);
+         ndata_unmap( buf, bufsize );
          continue;
       }
 
       if (xml_isNode(node,XML_PLANET_TAG)) {
          p = planet_new();
          planet_parse( p, node );
+         nhash_set( planet_hash, p->name, p->id );
       }
 
       /* Clean up. */
       free(file);
       xmlFreeDoc(doc);
-      free(buf);
+      ndata_unmap( buf, bufsize );
    }
 
    /* Clean up. */
@@ -1823,7 +2071,7 @@ void space_gfxLoad( StarSystem *sys )
          continue;
 
       if (planet->gfx_space == NULL)
-         planet->gfx_space = gl_newImage( planet->gfx_spaceName, OPENGL_TEX_MIPMAPS );
+         planet->gfx_space = gl_newImageAsync( planet->gfx_spaceName, OPENGL_TEX_MIPMAPS );
    }
 }
 
@@ -2127,20 +2375,10 @@ int system_addPlanet( StarSystem *sys, const char *planetname )
    sys->planets[sys->nplanets-1]    = planet;
    sys->planetsid[sys->nplanets-1]  = planet->id;
 
-   /* add planet <-> star system to name stack */
-   spacename_nstack++;
-   if (spacename_nstack > spacename_mstack) {
-      if (spacename_mstack == 0)
-         spacename_mstack = CHUNK_SIZE;
-      else
-         spacename_mstack *= 2;
-      planetname_stack = realloc(planetname_stack,
-            sizeof(char*) * spacename_mstack);
-      systemname_stack = realloc(systemname_stack,
-            sizeof(char*) * spacename_mstack);
-   }
-   planetname_stack[spacename_nstack-1] = planet->name;
-   systemname_stack[spacename_nstack-1] = sys->name;
+   /* add planet <-> star system to name lookup */
+   if (planet_sysHash == NULL)
+      planet_sysHash = nhash_create( planet_nstack );
+   nhash_set( planet_sysHash, planet->name, sys->id );
 
    economy_addQueuedUpdate();
 
@@ -2167,7 +2405,7 @@ int system_addPlanet( StarSystem *sys, const char *planetname )
  */
 int system_rmPlanet( StarSystem *sys, const char *planetname )
 {
-   int i, found;
+   int i;
    Planet *planet ;
 
    if (sys == NULL) {
@@ -2195,19 +2433,8 @@ int system_rmPlanet( StarSystem *sys, const char *planetname )
    /* Remove the presence. */
    system_addPresence( sys, planet->faction, -(planet->presenceAmount), planet->presenceRange );
 
-   /* Remove from the name stack thingy. */
-   found = 0;
-   for (i=0; i<spacename_nstack; i++)
-      if (strcmp(planetname, planetname_stack[i])==0) {
-         spacename_nstack--;
-         memmove( &planetname_stack[i], &planetname_stack[i+1],
-               sizeof(char*) * (spacename_nstack-i) );
-         memmove( &systemname_stack[i], &systemname_stack[i+1],
-               sizeof(char*) * (spacename_nstack-i) );
-         found = 1;
-         break;
-      }
-   if (found == 0)
+   /* Remove from the name lookup. */
+   if (nhash_remove( planet_sysHash, planetname ) < 0)
       WARN(_("Unable to find planet '%s' and system '%s' in planet<->system stack."),
             planetname, sys->name );
 
@@ -2291,6 +2518,7 @@ int system_rmJump( StarSystem *sys, const char *jumpname )
 
    /* Remove jump from system. */
    sys->njumps--;
+   map_jumpDistInvalidate( 0 );
 
    /* Refresh presence */
    system_setFaction(sys);
@@ -2407,6 +2635,23 @@ StarSystem *system_new (void)
    return sys;
 }
 
+/**
+ * @brief Sets the name of a star system, keeping the name lookups current.
+ *
+ *    @param sys System to name.
+ *    @param name Name to set, the system takes ownership.
+ */
+void system_setName( StarSystem *sys, char *name )
+{
+   if (systems_hash == NULL)
+      systems_hash = nhash_create( systems_mstack );
+   nhash_rename( systems_hash, sys->name, name, sys->id );
+
+   free( sys->name );
+   sys->name = name;
+}
+
+
 /**
  * @brief Reconstructs the jumps for a single system.
  */
@@ -2455,6 +2700,9 @@ void systems_reconstructJumps (void)
       sys = &systems_stack[i];
       system_reconstructJumps(sys);
    }
+
+   /* Cached jump distances are stale. */
+   map_jumpDistInvalidate( 0 );
 }
 
 
@@ -3328,7 +3576,8 @@ static int asteroidTypes_load (void)
 static int systems_load (void)
 {
    size_t bufsize;
-   char *buf, **system_files, *file;
+   const char *buf;
+   char **system_files, *file;
    xmlNodePtr node;
    xmlDocPtr doc;
    StarSystem *sys;
@@ -3341,6 +3590,8 @@ static int systems_load (void)
       systems_stack = malloc( sizeof(StarSystem) * systems_mstack );
       systems_nstack = 0;
    }
+   if (systems_hash == NULL)
+      systems_hash = nhash_create( systems_mstack );
 
    system_files = ndata_list( SYSTEM_DATA_PATH, &nfiles );
 
@@ -3353,11 +3604,11 @@ static int systems_load (void)
       file = malloc( len );
       nsnprintf( file, len, "%s%s", SYSTEM_DATA_PATH, system_files[i] );
       /* Load the file. */
-      buf = ndata_read( file, &bufsize );
+      buf = ndata_map( file, &bufsize );
       doc = xmlParseMemory( buf, bufsize );
       if (doc == NULL) {
          WARN(_("%s file is invalid xml!"),file);
-         free(buf);
+         ndata_unmap( buf, bufsize );
          continue;
       }
 
@@ -3365,17 +3616,18 @@ static int systems_load (void)
       if (node == NULL) {
          WARN(_("Malformed %s file: does not contain elements"),file);
          xmlFreeDoc(doc);
-         free(buf);
+         ndata_unmap( buf, bufsize );
          continue;
       }
 
       sys = system_new();
       system_parse( sys, node );
+      nhash_set( systems_hash, sys->name, sys->id );
       system_parseAsteroids(node, sys); /* load the asteroids anchors */
 
       /* Clean up. */
       xmlFreeDoc(doc);
-      free(buf);
+      ndata_unmap( buf, bufsize );
       free( file );
    }
 
@@ -3388,18 +3640,18 @@ static int systems_load (void)
       file = malloc( len );
       nsnprintf( file, len, "%s%s", SYSTEM_DATA_PATH, system_files[i] );
       /* Load the file. */
-      buf = ndata_read( file, &bufsize );
+      buf = ndata_map( file, &bufsize );
       free( file );
       doc = xmlParseMemory( buf, bufsize );
       if (doc == NULL) {
-         free(buf);
+         ndata_unmap( buf, bufsize );
          continue;
       }
 
       node = doc->xmlChildrenNode; /* first planet node */
       if (node == NULL) {
          xmlFreeDoc(doc);
-         free(buf);
+         ndata_unmap( buf, bufsize );
          continue;
       }
 
@@ -3407,7 +3659,7 @@ static int systems_load (void)
 
       /* Clean up. */
       xmlFreeDoc(doc);
-      free(buf);
+      ndata_unmap( buf, bufsize );
    }
 
    DEBUG( ngettext( "Loaded %d Star System", "Loaded %d Star Systems", systems_nstack ), systems_nstack );
@@ -3647,11 +3899,12 @@ void space_exit (void)
    free(asteroid_gfx);
 
    /* Free the names. */
-   if (planetname_stack != NULL)
-      free(planetname_stack);
-   if (systemname_stack != NULL)
-      free(systemname_stack);
-   spacename_nstack = 0;
+   nhash_free( systems_hash );
+   nhash_free( planet_hash );
+   nhash_free( planet_sysHash );
+   systems_hash   = NULL;
+   planet_hash    = NULL;
+   planet_sysHash = NULL;
 
    /* Free the planets. */
    for (i=0; i < planet_nstack; i++) {
@@ -3716,6 +3969,8 @@ void space_exit (void)
       for (j=0; j < sys->nasteroids; j++) {
          ast = &sys->asteroids[j];
          free(ast->asteroids);
+         free(ast->grid_start);
+         free(ast->grid_ids);
          free(ast->debris);
          free(ast->subsets);
          free(ast->type);
@@ -3767,6 +4022,7 @@ void space_clearKnown (void)
    }
    for (j=0; j<planet_nstack; j++)
       planet_rmFlag(&planet_stack[j],PLANET_KNOWN);
+   map_jumpDistInvalidate( 1 );
 }
 
 
@@ -3967,6 +4223,7 @@ int space_sysLoad( xmlNodePtr parent )
          } while (xml_nextNode(cur));
       }
    } while (xml_nextNode(node));
+   map_jumpDistInvalidate( 1 );
 
    return 0;
 }
@@ -243,9 +243,40 @@ typedef struct AsteroidAnchor_ {
    int nsubsets; /**< Number of convex subsets. */
    int *type; /**< Types of asteroids. */
    int ntype; /**< Number of types. */
+   /* Uniform grid over the asteroids, re-sorted every update. */
+   double grid_x; /**< Left edge of the grid. */
+   double grid_y; /**< Bottom edge of the grid. */
+   double grid_cell; /**< Size of a grid cell. */
+   double grid_margin; /**< Largest asteroid half-size, queries are padded by it. */
+   int grid_w; /**< Width of the grid in cells. */
+   int grid_h; /**< Height of the grid in cells. */
+   int *grid_start; /**< Start of each cell in grid_ids, plus the end of the last one. */
+   int *grid_ids; /**< Asteroid indices sorted by cell. */
 } AsteroidAnchor;
 
 
+/**
+ * @brief Walks the asteroids of a system that may overlap a box.
+ *
+ * Lives on the caller's stack, see asteroid_queryBegin().
+ */
+typedef struct AsteroidIter_ {
+   const StarSystem *sys; /**< System being walked. */
+   int field; /**< Current asteroid anchor. */
+   double x1; /**< Left of the box. */
+   double x2; /**< Right of the box. */
+   double y1; /**< Bottom of the box. */
+   double y2; /**< Top of the box. */
+   int cx1; /**< First cell column of the box in the current anchor. */
+   int cx2; /**< Last cell column of the box in the current anchor. */
+   int cy2; /**< Last cell row of the box in the current anchor. */
+   int cx; /**< Current cell column. */
+   int cy; /**< Current cell row. */
+   int k; /**< Current entry in grid_ids. */
+   int end; /**< End of the current cell in grid_ids. */
+} AsteroidIter;
+
+
 /**
  * @brief Represents a star system.
  *
@@ -331,6 +362,7 @@ char* planet_getServiceName( int service );
 int planet_getService( char *name );
 credits_t planet_commodityPrice( const Planet *p, const Commodity *c );
 /* Misc modification. */
+void planet_setName( Planet *p, char *name );
 int planet_setFaction( Planet *p, int faction );
 /* Land related stuff. */
 char planet_getColourChar( Planet *p );
@@ -352,6 +384,7 @@ void system_reconstructJumps (StarSystem *sys);
 void systems_reconstructJumps (void);
 void systems_reconstructPlanets (void);
 StarSystem *system_new (void);
+void system_setName( StarSystem *sys, char *name );
 int system_addPlanet( StarSystem *sys, const char *planetname );
 int system_rmPlanet( StarSystem *sys, const char *planetname );
 int system_addJump( StarSystem *sys, xmlNodePtr node );
@@ -433,6 +466,9 @@ int space_calcJumpInPos( StarSystem *in, StarSystem *out, Vector2d *pos, Vector2
 void asteroid_hit( Asteroid *a);
 int space_isInField ( Vector2d *p );
 AsteroidType *space_getType ( int ID );
+void asteroid_queryBegin( AsteroidIter *iter, const StarSystem *sys,
+      double x1, double x2, double y1, double y2 );
+Asteroid* asteroid_queryNext( AsteroidIter *iter );
 
 
 /*
@@ -30,6 +30,8 @@
 #include "nxml.h"
 #include "debris.h"
 #include "perlin.h"
+#include "camera.h"
+#include "profile.h"
 
 
 #define SPFX_XML_ID     "spfxs" /**< XML Document tag. */
@@ -89,28 +91,37 @@ static int spfx_neffects = 0; /**< Total number of special effects. */
 
 
 /**
- * @struct SPFX
+ * @struct SPFX_Layer
  *
- * @brief An actual in-game active special effect.
+ * @brief The active special effects of a layer.
+ *
+ * Stored as parallel arrays so the update only touches the fields it needs.
+ * Effects are kept in the order they were added, expired ones are compacted
+ * out in the same pass that moves the rest.
  */
-typedef struct SPFX_ {
-   Vector2d pos; /**< Current position. */
-   Vector2d vel; /**< Current velocity. */
+typedef struct SPFX_Layer_ {
+   double *x; /**< X positions. */
+   double *y; /**< Y positions. */
+   double *vx; /**< X velocities. */
+   double *vy; /**< Y velocities. */
+   double *timer; /**< Time left. */
+   int *effect; /**< The real effects. */
+   int *lastframe; /**< Needed when paused. */
+   int n; /**< Number of active effects. */
+   int m; /**< Effects there is memory for. */
+} SPFX_Layer;
 
-   int lastframe; /**< Needed when paused */
-   int effect; /**< The real effect */
 
-   double timer; /**< Time left */
-} SPFX;
+/* front layer is for effects on player, back is for the rest */
+static SPFX_Layer spfx_front; /**< Frontal special effect layer. */
+static SPFX_Layer spfx_back; /**< Back special effect layer. */
 
 
-/* front stack is for effects on player, back is for the rest */
-static SPFX *spfx_stack_front = NULL; /**< Frontal special effect layer. */
-static int spfx_nstack_front = 0; /**< Number of special effects in front. */
-static int spfx_mstack_front = 0; /**< Memory allocated for frontal special effects. */
-static SPFX *spfx_stack_back = NULL; /**< Back special effect layer. */
-static int spfx_nstack_back = 0; /**< Number of special effects in back. */
-static int spfx_mstack_back = 0; /**< Memory allocated for special effects in back. */
+/* Batched rendering. */
+static gl_vbo *spfx_vbo = NULL; /**< Vertices and texture coordinates of a layer. */
+static GLfloat *spfx_vertex = NULL; /**< Client side copy of spfx_vbo. */
+static int spfx_mvertex = 0; /**< Quads spfx_vertex has room for. */
+static int *spfx_visible = NULL; /**< Visible effects of the layer being rendered. */
 
 
 /*
@@ -119,8 +130,11 @@ static int spfx_mstack_back = 0; /**< Memory allocated for special effects in ba
 /* General. */
 static int spfx_base_parse( SPFX_Base *temp, const xmlNodePtr parent );
 static void spfx_base_free( SPFX_Base *effect );
-static void spfx_destroy( SPFX *layer, int *nlayer, int spfx );
-static void spfx_update_layer( SPFX *layer, int *nlayer, const double dt );
+static SPFX_Layer* spfx_getLayer( int layer );
+static void spfx_layerGrow( SPFX_Layer *l );
+static void spfx_layerFree( SPFX_Layer *l );
+static void spfx_update_layer( SPFX_Layer *l, const double dt );
+static void spfx_renderGrow( int n );
 /* Haptic. */
 static int spfx_hapticInit (void);
 static void spfx_hapticRumble( double mod );
@@ -290,12 +304,18 @@ void spfx_free (void)
 
    /* get rid of all the particles and free the stacks */
    spfx_clear();
-   if (spfx_stack_front) free(spfx_stack_front);
-   spfx_stack_front = NULL;
-   spfx_mstack_front = 0;
-   if (spfx_stack_back) free(spfx_stack_back);
-   spfx_stack_back = NULL;
-   spfx_mstack_back = 0;
+   spfx_layerFree( &spfx_front );
+   spfx_layerFree( &spfx_back );
+
+   /* Clean up the batching. */
+   if (spfx_vbo != NULL)
+      gl_vboDestroy( spfx_vbo );
+   spfx_vbo = NULL;
+   free( spfx_vertex );
+   spfx_vertex = NULL;
+   spfx_mvertex = 0;
+   free( spfx_visible );
+   spfx_visible = NULL;
 
    /* now clear the effects */
    for (i=0; i<spfx_neffects; i++)
@@ -309,6 +329,61 @@ void spfx_free (void)
 }
 
 
+/**
+ * @brief Gets a layer of active effects.
+ *
+ *    @param layer Layer to get.
+ *    @return The layer or NULL if invalid.
+ */
+static SPFX_Layer* spfx_getLayer( int layer )
+{
+   if (layer == SPFX_LAYER_FRONT)
+      return &spfx_front;
+   else if (layer == SPFX_LAYER_BACK)
+      return &spfx_back;
+   return NULL;
+}
+
+
+/**
+ * @brief Makes room for more effects in a layer.
+ *
+ *    @param l Layer to grow.
+ */
+static void spfx_layerGrow( SPFX_Layer *l )
+{
+   if (l->m == 0)
+      l->m = SPFX_CHUNK_MIN;
+   else
+      l->m += MIN( l->m, SPFX_CHUNK_MAX );
+   l->x         = realloc( l->x,         l->m * sizeof(double) );
+   l->y         = realloc( l->y,         l->m * sizeof(double) );
+   l->vx        = realloc( l->vx,        l->m * sizeof(double) );
+   l->vy        = realloc( l->vy,        l->m * sizeof(double) );
+   l->timer     = realloc( l->timer,     l->m * sizeof(double) );
+   l->effect    = realloc( l->effect,    l->m * sizeof(int) );
+   l->lastframe = realloc( l->lastframe, l->m * sizeof(int) );
+}
+
+
+/**
+ * @brief Frees the memory of a layer.
+ *
+ *    @param l Layer to free.
+ */
+static void spfx_layerFree( SPFX_Layer *l )
+{
+   free( l->x );
+   free( l->y );
+   free( l->vx );
+   free( l->vy );
+   free( l->timer );
+   free( l->effect );
+   free( l->lastframe );
+   memset( l, 0, sizeof(SPFX_Layer) );
+}
+
+
 /**
  * @brief Creates a new special effect.
  *
@@ -324,10 +399,11 @@ void spfx_add( int effect,
       const double vx, const double vy,
       const int layer )
 {
-   SPFX *cur_spfx;
+   SPFX_Layer *l;
    double ttl, anim;
+   int i;
 
-   if ((effect < 0) || (effect > spfx_neffects)) {
+   if ((effect < 0) || (effect >= spfx_neffects)) {
       WARN(_("Trying to add spfx with invalid effect!"));
       return;
    }
@@ -335,44 +411,29 @@ void spfx_add( int effect,
    /*
     * Select the Layer
     */
-   if (layer == SPFX_LAYER_FRONT) { /* front layer */
-      if (spfx_mstack_front < spfx_nstack_front+1) { /* need more memory */
-         if (spfx_mstack_front == 0)
-            spfx_mstack_front = SPFX_CHUNK_MIN;
-         else
-            spfx_mstack_front += MIN( spfx_mstack_front, SPFX_CHUNK_MAX );
-         spfx_stack_front = realloc( spfx_stack_front, spfx_mstack_front*sizeof(SPFX) );
-      }
-      cur_spfx = &spfx_stack_front[spfx_nstack_front];
-      spfx_nstack_front++;
-   }
-   else if (layer == SPFX_LAYER_BACK) { /* back layer */
-      if (spfx_mstack_back < spfx_nstack_back+1) { /* need more memory */
-         if (spfx_mstack_back == 0)
-            spfx_mstack_back = SPFX_CHUNK_MIN;
-         else
-            spfx_mstack_back += MIN( spfx_mstack_back, SPFX_CHUNK_MAX );
-         spfx_stack_back = realloc( spfx_stack_back, spfx_mstack_back*sizeof(SPFX) );
-      }
-      cur_spfx = &spfx_stack_back[spfx_nstack_back];
-      spfx_nstack_back++;
-   }
-   else {
+   l = spfx_getLayer( layer );
+   if (l == NULL) {
       WARN(_("Invalid SPFX layer."));
       return;
    }
+   if (l->m < l->n+1) /* need more memory */
+      spfx_layerGrow( l );
+   i = l->n++;
 
    /* The actual adding of the spfx */
-   cur_spfx->effect = effect;
-   vect_csetmin( &cur_spfx->pos, px, py );
-   vect_csetmin( &cur_spfx->vel, vx, vy );
+   l->effect[i]    = effect;
+   l->lastframe[i] = 0;
+   l->x[i]         = px;
+   l->y[i]         = py;
+   l->vx[i]        = vx;
+   l->vy[i]        = vy;
    /* Timer magic if ttl != anim */
    ttl = spfx_effects[effect].ttl;
    anim = spfx_effects[effect].anim;
    if (ttl != anim)
-      cur_spfx->timer = ttl + RNGF()*anim;
+      l->timer[i] = ttl + RNGF()*anim;
    else
-      cur_spfx->timer = ttl;
+      l->timer[i] = ttl;
 }
 
 
@@ -381,15 +442,9 @@ void spfx_add( int effect,
  */
 void spfx_clear (void)
 {
-   int i;
-
-   /* Clear front layer */
-   for (i=spfx_nstack_front-1; i>=0; i--)
-      spfx_destroy( spfx_stack_front, &spfx_nstack_front, i );
-
-   /* Clear back layer */
-   for (i=spfx_nstack_back-1; i>=0; i--)
-      spfx_destroy( spfx_stack_back, &spfx_nstack_back, i );
+   /* Clear the layers, the memory is kept for the next effects. */
+   spfx_front.n = 0;
+   spfx_back.n  = 0;
 
    /* Clear rumble */
    shake_set = 0;
@@ -399,19 +454,6 @@ void spfx_clear (void)
    vectnull( &shake_vel );
 }
 
-/**
- * @brief Destroys an active spfx.
- *
- *    @param layer Layer the spfx is on.
- *    @param nlayer Pointer to the number of elements in the layer.
- *    @param spfx Position of the spfx in the stack.
- */
-static void spfx_destroy( SPFX *layer, int *nlayer, int spfx )
-{
-   (*nlayer)--;
-   memmove( &layer[spfx], &layer[spfx+1], (*nlayer-spfx)*sizeof(SPFX) );
-}
-
 
 /**
  * @brief Updates all the spfx.
@@ -420,35 +462,43 @@ static void spfx_destroy( SPFX *layer, int *nlayer, int spfx )
  */
 void spfx_update( const double dt )
 {
-   spfx_update_layer( spfx_stack_front, &spfx_nstack_front, dt );
-   spfx_update_layer( spfx_stack_back, &spfx_nstack_back, dt );
+   spfx_update_layer( &spfx_front, dt );
+   spfx_update_layer( &spfx_back, dt );
 }
 
 
 /**
- * @brief Updates an individual spfx.
+ * @brief Updates the effects of a layer.
+ *
+ * Expired effects are dropped while the survivors are moved down, so the
+ * layer is compacted in a single pass and keeps its order.
  *
- *    @param layer Layer the spfx is on.
- *    @param nlayer Pointer to the associated nlayer.
+ *    @param l Layer to update.
  *    @param dt Current delta tick.
  */
-static void spfx_update_layer( SPFX *layer, int *nlayer, const double dt )
+static void spfx_update_layer( SPFX_Layer *l, const double dt )
 {
-   int i;
-
-   for (i=0; i<*nlayer; i++) {
-      layer[i].timer -= dt; /* less time to live */
+   int i, j;
 
+   j = 0;
+   for (i=0; i<l->n; i++) {
       /* time to die! */
-      if (layer[i].timer < 0.) {
-         spfx_destroy( layer, nlayer, i );
-         i--;
+      if (l->timer[i] - dt < 0.)
          continue;
-      }
 
       /* actually update it */
-      vect_cadd( &layer[i].pos, dt*VX(layer[i].vel), dt*VY(layer[i].vel) );
+      l->timer[j]     = l->timer[i] - dt; /* less time to live */
+      l->x[j]         = l->x[i] + dt*l->vx[i];
+      l->y[j]         = l->y[i] + dt*l->vy[i];
+      if (i != j) {
+         l->vx[j]        = l->vx[i];
+         l->vy[j]        = l->vy[i];
+         l->effect[j]    = l->effect[i];
+         l->lastframe[j] = l->lastframe[i];
+      }
+      j++;
    }
+   l->n = j;
 }
 
 
@@ -699,56 +749,147 @@ void spfx_cinematic (void)
 }
 
 
+/**
+ * @brief Makes sure the batching buffers can hold a layer.
+ *
+ *    @param n Number of effects in the layer.
+ */
+static void spfx_renderGrow( int n )
+{
+   if (n <= spfx_mvertex)
+      return;
+   spfx_mvertex = MAX( n, 2*spfx_mvertex );
+   /* 6 vertices of 2 coordinates and 6 texture coordinates per quad. */
+   spfx_vertex  = realloc( spfx_vertex, spfx_mvertex * 24 * sizeof(GLfloat) );
+   spfx_visible = realloc( spfx_visible, spfx_mvertex * sizeof(int) );
+}
+
+
 /**
  * @brief Renders the entire spfx layer.
  *
+ * The visible effects are drawn in the same order as always, but each run
+ * of effects sharing a texture is drawn at once instead of one by one.
+ *
  *    @param layer Layer to render.
  */
 void spfx_render( const int layer )
 {
-   SPFX *spfx_stack;
-   int i, spfx_nstack;
+   SPFX_Layer *l;
    SPFX_Base *effect;
-   int sx, sy;
-   double time;
-
+   glTexture *gfx;
+   GLfloat *vertex, *tex;
+   double x, y, w, h, tx, ty, tw, th, z, time;
+   int i, j, k, n, sx, sy, frame;
 
    /* get the appropriate layer */
-   switch (layer) {
-      case SPFX_LAYER_FRONT:
-         spfx_stack = spfx_stack_front;
-         spfx_nstack = spfx_nstack_front;
-         break;
-
-      case SPFX_LAYER_BACK:
-         spfx_stack = spfx_stack_back;
-         spfx_nstack = spfx_nstack_back;
-         break;
-
-      default:
-         WARN(_("Rendering invalid SPFX layer."));
-         return;
+   l = spfx_getLayer( layer );
+   if (l == NULL) {
+      WARN(_("Rendering invalid SPFX layer."));
+      return;
    }
+   if ((l->n == 0) || (gl_screen.flags & OPENGL_HEADLESS))
+      return;
+   spfx_renderGrow( l->n );
 
-   /* Now render the layer */
-   for (i=spfx_nstack-1; i>=0; i--) {
-      effect = &spfx_effects[ spfx_stack[i].effect ];
+   /* Find the visible effects, newest first like they used to be drawn. */
+   z = cam_getZoom();
+   n = 0;
+   for (i=l->n-1; i>=0; i--) {
+      effect = &spfx_effects[ l->effect[i] ];
+      gfx    = effect->gfx;
 
       /* Simplifies */
-      sx = (int)effect->gfx->sx;
-      sy = (int)effect->gfx->sy;
+      sx = (int)gfx->sx;
+      sy = (int)gfx->sy;
 
       if (!paused) { /* don't calculate frame if paused */
-         time = 1. - fmod(spfx_stack[i].timer,effect->anim) / effect->anim;
-         spfx_stack[i].lastframe = sx * sy * MIN(time, 1.);
+         time = 1. - fmod(l->timer[i],effect->anim) / effect->anim;
+         l->lastframe[i] = sx * sy * MIN(time, 1.);
       }
 
-      /* Renders */
-      gl_blitSprite( effect->gfx,
-            VX(spfx_stack[i].pos), VY(spfx_stack[i].pos),
-            spfx_stack[i].lastframe % sx,
-            spfx_stack[i].lastframe / sx,
-            NULL );
+      /* check if inbounds */
+      gl_gameToScreenCoords( &x, &y, l->x[i] - gfx->sw/2., l->y[i] - gfx->sh/2. );
+      w = gfx->sw*z;
+      h = gfx->sh*z;
+      if ((x < -w) || (x > SCREEN_W+w) ||
+            (y < -h) || (y > SCREEN_H+h))
+         continue;
+
+      spfx_visible[n++] = i;
    }
-}
+   if (n == 0)
+      return;
 
+   /* Build the quads, they are drawn as two triangles. */
+   for (j=0; j<n; j++) {
+      i      = spfx_visible[j];
+      gfx    = spfx_effects[ l->effect[i] ].gfx;
+      frame  = l->lastframe[i];
+      sx     = (int)gfx->sx;
+
+      gl_gameToScreenCoords( &x, &y, l->x[i] - gfx->sw/2., l->y[i] - gfx->sh/2. );
+      w  = gfx->sw*z;
+      h  = gfx->sh*z;
+      tx = gfx->sw*(double)(frame % sx)/gfx->rw;
+      ty = gfx->sh*(gfx->sy-(double)(frame / sx)-1)/gfx->rh;
+      tw = gfx->srw;
+      th = gfx->srh;
+
+      vertex = &spfx_vertex[ 12*j ];
+      tex    = &spfx_vertex[ 12*(n+j) ];
+      vertex[0]  = x;
+      vertex[1]  = y;
+      vertex[2]  = x + w;
+      vertex[3]  = y;
+      vertex[4]  = x;
+      vertex[5]  = y + h;
+      vertex[6]  = x + w;
+      vertex[7]  = y;
+      vertex[8]  = x + w;
+      vertex[9]  = y + h;
+      vertex[10] = x;
+      vertex[11] = y + h;
+      tex[0]  = tx;
+      tex[1]  = ty;
+      tex[2]  = tx + tw;
+      tex[3]  = ty;
+      tex[4]  = tx;
+      tex[5]  = ty + th;
+      tex[6]  = tx + tw;
+      tex[7]  = ty;
+      tex[8]  = tx + tw;
+      tex[9]  = ty + th;
+      tex[10] = tx;
+      tex[11] = ty + th;
+   }
+
+   /* Upload the layer. */
+   if (spfx_vbo == NULL)
+      spfx_vbo = gl_vboCreateStream( 24*n*sizeof(GLfloat), spfx_vertex );
+   else
+      gl_vboData( spfx_vbo, 24*n*sizeof(GLfloat), spfx_vertex );
+   gl_vboActivateOffset( spfx_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
+   gl_vboActivateOffset( spfx_vbo, GL_TEXTURE_COORD_ARRAY,
+         12*n*sizeof(GLfloat), 2, GL_FLOAT, 0 );
+
+   /* Draw, flushing whenever the texture changes. */
+   glEnable(GL_TEXTURE_2D);
+   glColor4d( 1., 1., 1., 1. );
+   k = 0;
+   for (j=1; j<=n; j++) {
+      if ((j < n) && (l->effect[ spfx_visible[j] ] == l->effect[ spfx_visible[k] ]))
+         continue;
+      glBindTexture( GL_TEXTURE_2D, spfx_effects[ l->effect[ spfx_visible[k] ] ].gfx->texture );
+      profile_count( PROFILE_DRAWS, 1 );
+      glDrawArrays( GL_TRIANGLES, 6*k, 6*(j-k) );
+      k = j;
+   }
+
+   /* Clear state. */
+   gl_vboDeactivate();
+   glDisable(GL_TEXTURE_2D);
+
+   /* anything failed? */
+   gl_checkErr();
+}
@@ -21,6 +21,7 @@
 #include "ship.h"
 #include "economy.h"
 #include "array.h"
+#include "nhash.h"
 
 
 #define XML_TECH_ID         "Techs"          /**< Tech xml document tag. */
@@ -69,6 +70,7 @@ struct tech_group_s {
  * Group list.
  */
 static tech_group_t *tech_groups = NULL;
+static NHash *tech_hash = NULL; /**< Group name to index in the list. */
 
 
 /*
@@ -148,9 +150,15 @@ int tech_load (void)
    } while (xml_nextNode(node));
    array_shrink( &tech_groups );
 
+   /* Index the names, backwards so the first of duplicates wins like a scan. */
+   s     = array_size( tech_groups );
+   tech_hash = nhash_create( s );
+   for (i=s-1; i>=0; i--)
+      if (tech_groups[i].name != NULL)
+         nhash_set( tech_hash, tech_groups[i].name, i );
+
    /* Now we load the data. */
    node  = parent->xmlChildrenNode;
-   s     = array_size( tech_groups );
    do {
       /* Must match tag. */
       if (!xml_isNode(node, XML_TECH_TAG))
@@ -162,11 +170,9 @@ int tech_load (void)
          continue;
 
       /* Load next tech. */
-      for (i=0; i<s; i++) {
-         tech  = &tech_groups[i];
-         if (strcmp(tech->name, buf)==0)
-            tech_parseNodeData( tech, node );
-      }
+      i = tech_getID( buf );
+      if (i >= 0)
+         tech_parseNodeData( &tech_groups[i], node );
 
       /* Free memory. */
       free(buf);
@@ -197,6 +203,9 @@ void tech_free (void)
 
    /* Free the tech array. */
    array_free( tech_groups );
+   tech_groups = NULL;
+   nhash_free( tech_hash );
+   tech_hash = NULL;
 }
 
 
@@ -597,23 +606,7 @@ int tech_rmItem( const char *name, const char *value )
  */
 static int tech_getID( const char *name )
 {
-   int i, s;
-   tech_group_t *tech;
-
-   /* NULL case. */
-   if (tech_groups == NULL)
-      return -1;
-
-   s  = array_size( tech_groups );
-   for (i=0; i<s; i++) {
-      tech  = &tech_groups[i];
-      if (tech->name == NULL)
-         continue;
-      if (strcmp(tech->name, name)==0)
-         return i;
-   }
-
-   return -1L;
+   return nhash_get( tech_hash, name );
 }
 
 
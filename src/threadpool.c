@@ -570,7 +570,7 @@ static int vpool_worker( void *data )
  */
 void vpool_wait( ThreadQueue *queue )
 {
-   int i, cnt;
+   int i, cnt, cnt0;
    SDL_cond *cond;
    SDL_mutex *mutex;
    vpoolThreadData *arg;
@@ -581,6 +581,7 @@ void vpool_wait( ThreadQueue *queue )
    mutex = SDL_CreateMutex();
    /* This might be a little ugly (and inefficient?) */
    cnt   = SDL_SemValue( queue->semaphore );
+   cnt0  = cnt;
 
    /* Allocate all vpoolThreadData objects */
    arg = calloc( cnt, sizeof(vpoolThreadData) );
@@ -606,13 +607,16 @@ void vpool_wait( ThreadQueue *queue )
    }
 
    /* Wait for the threads to finish */
-   SDL_CondWait( cond, mutex );
+   while (cnt > 0)
+      SDL_CondWait( cond, mutex );
    SDL_mutexV( mutex );
 
    /* Clean up */
    SDL_DestroyMutex( mutex );
    SDL_DestroyCond( cond );
    tq_destroy( queue );
+   for (i=0; i<cnt0; i++)
+      free( arg[i].node );
    free( arg );
 }
 
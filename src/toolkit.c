@@ -24,6 +24,7 @@
 #include "nstd.h"
 #include "dialogue.h"
 #include "conf.h"
+#include "profile.h"
 
 
 #define INPUT_DELAY      conf.repeat_delay /**< Delay before starting to repeat. */
@@ -1047,6 +1048,7 @@ void toolkit_drawOutlineThick( int x, int y, int w, int h, int b,
          toolkit_vboColourOffset, 4, GL_FLOAT, 0 );
 
    /* Draw the VBO. */
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_TRIANGLE_STRIP, 0, 10 );
 
    /* Deactivate VBO. */
@@ -1107,6 +1109,7 @@ void toolkit_drawOutline( int x, int y, int w, int h, int b,
          toolkit_vboColourOffset, 4, GL_FLOAT, 0 );
 
    /* Draw the VBO. */
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_LINE_LOOP, 0, 4 );
 
    /* Deactivate VBO. */
@@ -1163,6 +1166,7 @@ void toolkit_drawRect( int x, int y, int w, int h,
          toolkit_vboColourOffset, 4, GL_FLOAT, 0 );
 
    /* Draw the VBO. */
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
 
    /* Deactivate VBO. */
@@ -1336,6 +1340,7 @@ static void window_renderBorder( Window* w )
    vertex[30] = cx + 21;
    vertex[31] = cy;
    gl_vboSubData( toolkit_vbo, 0, sizeof(GLshort) * 2*16, vertex );
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_TRIANGLE_FAN, 0, 16 );
    /* Right side vertex. */
    cx = x + w->w;
@@ -1374,6 +1379,7 @@ static void window_renderBorder( Window* w )
    vertex[30] = cx - 21;
    vertex[31] = cy;
    gl_vboSubData( toolkit_vbo, 0, sizeof(GLshort) * 2*16, vertex );
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_TRIANGLE_FAN, 0, 16 );
 
 
@@ -1475,6 +1481,7 @@ static void window_renderBorder( Window* w )
    vertex[60] = cx + 21;
    vertex[61] = cy;
    gl_vboSubData( toolkit_vbo, 0, sizeof(GLshort) * 2*31, vertex );
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_LINE_LOOP, 0, 31 );
 
 
@@ -1565,6 +1572,7 @@ static void window_renderBorder( Window* w )
    vertex[60] = cx + 21;
    vertex[61] = cy;
    gl_vboSubData( toolkit_vbo, 0, sizeof(GLshort) * 2*31, vertex );
+   profile_count( PROFILE_DRAWS, 1 );
    glDrawArrays( GL_LINE_LOOP, 0, 31 );
 
    /* Clean up. */
@@ -32,6 +32,7 @@
 #include "camera.h"
 #include "ai.h"
 #include "rtree.h"
+#include "profile.h"
 
 
 #define weapon_isSmart(w)     (w->think != NULL) /**< Checks if the weapon w is smart. */
@@ -39,6 +40,10 @@
 #define WEAPON_CHUNK_MAX      16384 /**< Maximum size to increase array with */
 #define WEAPON_CHUNK_MIN      256 /**< Minimum size to increase array with */
 
+#define WEAPON_POOL_CHUNK     256 /**< Weapons allocated at once by the pool. */
+#define WEAPON_HANDLE_BITS    20 /**< Bits of a handle holding the slot, the rest hold its generation. */
+#define WEAPON_HANDLE_SLOT    ((1u<<WEAPON_HANDLE_BITS)-1) /**< Mask of the slot in a handle. */
+
 /* Weapon status */
 #define WEAPON_STATUS_OK         0 /**< Weapon is fine */
 #define WEAPON_STATUS_JAMMED     1 /**< Got jammed */
@@ -59,8 +64,10 @@ extern struct rtree *pilot_rtree;
  * @brief In-game representation of a weapon.
  */
 typedef struct Weapon_ {
-   Solid *solid; /**< Actually has its own solid :) */
-   unsigned int ID; /**< Only used for beam weapons. */
+   Solid solid; /**< Actually has its own solid :) */
+   unsigned int ID; /**< Handle of the weapon in the pool, 0 while the slot is free. */
+   int slot; /**< Slot of the weapon in the pool. */
+   unsigned int gen; /**< Times the slot has been used, kept when it is freed. */
 
    int faction; /**< faction of pilot that shot it */
    unsigned int parent; /**< pilot that shot it */
@@ -81,6 +88,7 @@ typedef struct Weapon_ {
    double strength; /**< Calculated with falloff. */
    int sx; /**< Current X sprite to use. */
    int sy; /**< Current Y sprite to use. */
+   int query; /**< Index of the weapon in the layer's batched pilot query, -1 if not queried. */
 
    /* position update and render */
    void (*update)(struct Weapon_*, const double, WeaponLayer); /**< Updates the weapon */
@@ -90,6 +98,26 @@ typedef struct Weapon_ {
 } Weapon;
 
 
+/**
+ * @brief An active jammer, gathered once per update.
+ */
+typedef struct WeaponJammer_ {
+   Vector2d pos; /**< Position of the jamming pilot. */
+   double range2; /**< Range squared. */
+   double power; /**< Jamming power. */
+   struct rtree_node *leaf; /**< Leaf of weapon_jamtree holding it. */
+} WeaponJammer;
+
+
+/*
+ * Weapons are pooled in chunks that never move, so they can be referred to
+ * by pointer or by handle and freeing one doesn't go through malloc.
+ */
+static Weapon **weapon_pool   = NULL; /**< Chunks of WEAPON_POOL_CHUNK weapons. */
+static int weapon_npool       = 0; /**< Number of chunks. */
+static int *weapon_vacant     = NULL; /**< Stack of free slots. */
+static int weapon_nvacant     = 0; /**< Number of free slots. */
+
 /* behind pilot_nstack layer */
 static Weapon** wbackLayer = NULL; /**< behind pilots */
 static int nwbackLayer = 0; /**< number of elements */
@@ -99,14 +127,32 @@ static Weapon** wfrontLayer = NULL; /**< in front of pilots, behind player */
 static int nwfrontLayer = 0; /**< number of elements */
 static int mwfrontLayer = 0; /**< alloced memory size */
 
+/* Pilot collision candidates of the layer being updated, grouped by weapon. */
+static struct bounding_rectangle *weapon_qbox = NULL; /**< Box of each queried weapon. */
+static int weapon_mqbox       = 0; /**< Allocated boxes. */
+static int *weapon_qoff       = NULL; /**< Start of each weapon's candidates, one extra at the end. */
+static int *weapon_qbid       = NULL; /**< Box each found candidate belongs to. */
+static Pilot **weapon_qfound  = NULL; /**< Candidates in the order they were found. */
+static Pilot **weapon_qcand   = NULL; /**< Candidates grouped by box. */
+static int weapon_nqcand      = 0; /**< Number of candidates. */
+static int weapon_mqcand      = 0; /**< Allocated candidates. */
+
+/* Solids of the layer being updated, integrated together. */
+static Solid **weapon_solids  = NULL; /**< Solids of the layer's weapons. */
+static int weapon_msolids     = 0; /**< Allocated solids. */
+
+/* Jammers of the current update, indexed by their range. */
+static WeaponJammer *weapon_jammers = NULL; /**< Active jammers. */
+static int weapon_njammers      = 0; /**< Number of active jammers. */
+static int weapon_mjammers      = 0; /**< Allocated jammers. */
+static struct rtree *weapon_jamtree = NULL; /**< Range of every jammer. */
+
 /* Graphics. */
 static gl_vbo  *weapon_vbo     = NULL; /**< Weapon VBO. */
 static GLfloat *weapon_vboData = NULL; /**< Data of weapon VBO. */
 static int weapon_vboSize      = 0; /**< Size of the VBO. */
 
 
-/* Internal stuff. */
-static unsigned int beam_idgen = 0; /**< Beam identifier generator. */
 
 
 /*
@@ -126,7 +172,21 @@ static Weapon* weapon_create( const Outfit* outfit, double T,
 /* Updating. */
 static void weapon_render( Weapon* w, const double dt );
 static void weapons_updateLayer( const double dt, const WeaponLayer layer );
+static void weapons_queryLayer( Weapon **wlayer, int nlayer, const double dt );
+static void weapons_gatherJammers (void);
+static void weapons_jamLayer( Weapon **wlayer, int nlayer );
+static void weapon_queryFound( void *value, int box, void *data );
+static void weapon_getBox( Weapon *w, struct bounding_rectangle *box, const double dt );
 static void weapon_update( Weapon* w, const double dt, WeaponLayer layer );
+static int weapon_collidePilot( Weapon *w, Pilot *p, glTexture *gfx,
+      WeaponLayer layer, const double dt );
+static int weapon_collideSwept( Weapon *w, glTexture *gfx,
+      const glTexture *bt, int bsx, int bsy, const Vector2d *bp, const Vector2d *bv,
+      const double dt, Vector2d crash[2] );
+/* Pool. */
+static Weapon* weapon_poolAlloc (void);
+static void weapon_poolFree( Weapon *w );
+static Weapon* weapon_get( unsigned int handle );
 /* Destruction. */
 static void weapon_destroy( Weapon* w, WeaponLayer layer );
 static void weapon_free( Weapon* w );
@@ -183,12 +243,12 @@ void weapon_minimap( const double res, const double w,
       wp = wbackLayer[i];
 
       /* Make sure is in range. */
-      if (!pilot_inRange( player.p, wp->solid->pos.x, wp->solid->pos.y ))
+      if (!pilot_inRange( player.p, wp->solid.pos.x, wp->solid.pos.y ))
          continue;
 
       /* Get radar position. */
-      x = (wp->solid->pos.x - player.p->solid->pos.x) / res;
-      y = (wp->solid->pos.y - player.p->solid->pos.y) / res;
+      x = (wp->solid.pos.x - player.p->solid->pos.x) / res;
+      y = (wp->solid.pos.y - player.p->solid->pos.y) / res;
 
       /* Make sure in range. */
       if (shape==RADAR_RECT && (ABS(x)>w/2. || ABS(y)>h/2.))
@@ -229,12 +289,12 @@ void weapon_minimap( const double res, const double w,
       wp = wfrontLayer[i];
 
       /* Make sure is in range. */
-      if (!pilot_inRange( player.p, wp->solid->pos.x, wp->solid->pos.y ))
+      if (!pilot_inRange( player.p, wp->solid.pos.x, wp->solid.pos.y ))
          continue;
 
       /* Get radar position. */
-      x = (wp->solid->pos.x - player.p->solid->pos.x) / res;
-      y = (wp->solid->pos.y - player.p->solid->pos.y) / res;
+      x = (wp->solid.pos.x - player.p->solid->pos.x) / res;
+      y = (wp->solid.pos.y - player.p->solid->pos.y) / res;
 
       /* Make sure in range. */
       if (shape==RADAR_RECT && (ABS(x)>w/2. || ABS(y)>h/2.))
@@ -278,6 +338,7 @@ void weapon_minimap( const double res, const double w,
             4, GL_FLOAT, 0 );
 
       /* Render VBO. */
+      profile_count( PROFILE_DRAWS, 1 );
       glDrawArrays( GL_POINTS, 0, p );
 
       /* Disable VBO. */
@@ -291,7 +352,7 @@ void weapon_minimap( const double res, const double w,
  */
 static void weapon_setThrust( Weapon *w, double thrust )
 {
-   w->solid->thrust = thrust;
+   w->solid.thrust = thrust;
 }
 
 
@@ -300,7 +361,7 @@ static void weapon_setThrust( Weapon *w, double thrust )
  */
 static void weapon_setTurn( Weapon *w, double turn )
 {
-   w->solid->dir_vel = turn;
+   w->solid.dir_vel = turn;
 }
 
 
@@ -338,21 +399,21 @@ static void think_seeker( Weapon* w, const double dt )
          if (w->outfit->u.amm.ai == AMMO_AI_SMART) {
 
             /* Calculate time to reach target. */
-            vect_cset( &v, p->solid->pos.x - w->solid->pos.x,
-                  p->solid->pos.y - w->solid->pos.y );
+            vect_cset( &v, p->solid->pos.x - w->solid.pos.x,
+                  p->solid->pos.y - w->solid.pos.y );
             t = vect_odist( &v ) / w->outfit->u.amm.speed;
 
             /* Calculate target's movement. */
-            vect_cset( &v, v.x + t*(p->solid->vel.x - w->solid->vel.x),
-                  v.y + t*(p->solid->vel.y - w->solid->vel.y) );
+            vect_cset( &v, v.x + t*(p->solid->vel.x - w->solid.vel.x),
+                  v.y + t*(p->solid->vel.y - w->solid.vel.y) );
 
             /* Get the angle now. */
-            diff = angle_diff(w->solid->dir, VANGLE(v) );
+            diff = angle_diff(w->solid.dir, VANGLE(v) );
          }
          /* Other seekers are stupid. */
          else {
-            diff = angle_diff(w->solid->dir, /* Get angle to target pos */
-                  vect_angle(&w->solid->pos, &p->solid->pos));
+            diff = angle_diff(w->solid.dir, /* Get angle to target pos */
+                  vect_angle(&w->solid.pos, &p->solid->pos));
          }
 
          /* Set turn. */
@@ -372,10 +433,10 @@ static void think_seeker( Weapon* w, const double dt )
 
    /* Limit speed here */
    w->real_vel = MIN( w->outfit->u.amm.speed, w->real_vel + w->outfit->u.amm.thrust*dt );
-   vect_pset( &w->solid->vel, (1. - w->jam_power) * w->real_vel, w->solid->dir );
+   vect_pset( &w->solid.vel, (1. - w->jam_power) * w->real_vel, w->solid.dir );
 
    /* Modulate max speed. */
-   //w->solid->speed_max = w->outfit->u.amm.speed * (1. - w->jam_power);
+   //w->solid.speed_max = w->outfit->u.amm.speed * (1. - w->jam_power);
 }
 
 
@@ -409,13 +470,13 @@ static void think_beam( Weapon* w, const double dt )
 
    /* Use mount position. */
    pilot_getMount( p, w->mount, &v );
-   w->solid->pos.x = p->solid->pos.x + v.x;
-   w->solid->pos.y = p->solid->pos.y + v.y;
+   w->solid.pos.x = p->solid->pos.x + v.x;
+   w->solid.pos.y = p->solid->pos.y + v.y;
 
    /* Handle aiming. */
    switch (w->outfit->type) {
       case OUTFIT_TYPE_BEAM:
-         w->solid->dir = p->solid->dir;
+         w->solid.dir = p->solid->dir;
          break;
 
       case OUTFIT_TYPE_TURRET_BEAM:
@@ -427,10 +488,10 @@ static void think_beam( Weapon* w, const double dt )
          }
 
          if (w->target == w->parent) /* Invalid target, tries to follow shooter. */
-            diff = angle_diff(w->solid->dir, p->solid->dir);
+            diff = angle_diff(w->solid.dir, p->solid->dir);
          else
-            diff = angle_diff(w->solid->dir, /* Get angle to target pos */
-                  vect_angle(&w->solid->pos, &t->solid->pos));
+            diff = angle_diff(w->solid.dir, /* Get angle to target pos */
+                  vect_angle(&w->solid.pos, &t->solid->pos));
          weapon_setTurn( w, CLAMP( -w->outfit->u.bem.turn, w->outfit->u.bem.turn,
                   10 * diff *  w->outfit->u.bem.turn ));
          break;
@@ -448,6 +509,7 @@ static void think_beam( Weapon* w, const double dt )
  */
 void weapons_update( const double dt )
 {
+   weapons_gatherJammers();
    weapons_updateLayer(dt,WEAPON_LAYER_BG);
    weapons_updateLayer(dt,WEAPON_LAYER_FG);
 }
@@ -464,11 +526,10 @@ static void weapons_updateLayer( const double dt, const WeaponLayer layer )
    Weapon **wlayer;
    int *nlayer;
    Weapon *w;
-   int i, j, k;
+   int i;
    int spfx;
    int s;
    Pilot *p;
-   Outfit *o;
 
    /* Choose layer. */
    switch (layer) {
@@ -486,49 +547,11 @@ static void weapons_updateLayer( const double dt, const WeaponLayer layer )
          return;
    }
 
-   /** @TODO optimize me plz. */
-   /* Reset jam power. */
-   for (k=0; k < *nlayer; k++) {
-      w = wlayer[k];
-      if (!outfit_isSeeker( w->outfit ))
-         continue;
-      w->jam_power = 0.;
-   }
-   /* Iterate over all pilots. */
-   for (i=0; i<pilot_nstack; i++) {
-      p = pilot_stack[i];
+   /* Set the jamming seekers are under. */
+   weapons_jamLayer( wlayer, *nlayer );
 
-      /* Must be jamming. */
-      if (!p->jamming)
-         continue;
-
-      /* Iterate over outfits to find jammers. */
-      for (j=0; j<p->noutfits; j++) {
-         o    = p->outfits[j]->outfit;
-         if (o==NULL)
-            continue;
-         /* Must be on. */
-         if (p->outfits[j]->state != PILOT_OUTFIT_ON)
-            continue;
-         /* Must be a jammer. */
-         if (!outfit_isJammer(o))
-            continue;
-    
-         /* Apply jamming. */
-         for (k=0; k < *nlayer; k++) {
-            w = wlayer[k];
-            if (!outfit_isSeeker( w->outfit ))
-               continue;
-
-            /* Must be in range. */
-            if (o->u.jam.range2 < vect_dist2( &w->solid->pos, &p->solid->pos ))
-               continue;
-
-            /* We only consider the strongest jammer. */
-            w->jam_power = CLAMP( 0., 1., MAX( w->jam_power, (o->u.jam.power - w->outfit->u.amm.resist) ) );
-         }
-      }
-   }
+   /* Find all the pilots the layer can collide with in one go. */
+   weapons_queryLayer( wlayer, *nlayer, dt );
 
    i = 0;
    while (i < *nlayer) {
@@ -550,17 +573,17 @@ static void weapons_updateLayer( const double dt, const WeaponLayer layer )
                   spfx = outfit_spfxShield(w->outfit);
                /* Add death sprite if needed. */
                if (spfx != -1) {
-                  spfx_add( spfx, w->solid->pos.x, w->solid->pos.y,
-                        w->solid->vel.x, w->solid->vel.y,
+                  spfx_add( spfx, w->solid.pos.x, w->solid.pos.y,
+                        w->solid.vel.x, w->solid.vel.y,
                         SPFX_LAYER_BACK ); /* presume back. */
                   /* Add sound if explodes and has it. */
                   s = outfit_soundHit(w->outfit);
                   if (s != -1)
                      w->voice = sound_playPos(s,
-                           w->solid->pos.x,
-                           w->solid->pos.y,
-                           w->solid->vel.x,
-                           w->solid->vel.y);
+                           w->solid.pos.x,
+                           w->solid.pos.y,
+                           w->solid.vel.x,
+                           w->solid.vel.y);
                }
                weapon_destroy(w,layer);
                break;
@@ -580,17 +603,17 @@ static void weapons_updateLayer( const double dt, const WeaponLayer layer )
                   spfx = outfit_spfxShield(w->outfit);
                /* Add death sprite if needed. */
                if (spfx != -1) {
-                  spfx_add( spfx, w->solid->pos.x, w->solid->pos.y,
-                        w->solid->vel.x, w->solid->vel.y,
+                  spfx_add( spfx, w->solid.pos.x, w->solid.pos.y,
+                        w->solid.vel.x, w->solid.vel.y,
                         SPFX_LAYER_BACK ); /* presume back. */
                   /* Add sound if explodes and has it. */
                   s = outfit_soundHit(w->outfit);
                   if (s != -1)
                      w->voice = sound_playPos(s,
-                           w->solid->pos.x,
-                           w->solid->pos.y,
-                           w->solid->vel.x,
-                           w->solid->vel.y);
+                           w->solid.pos.x,
+                           w->solid.pos.y,
+                           w->solid.vel.x,
+                           w->solid.vel.y);
                }
                weapon_destroy(w,layer);
                break;
@@ -637,6 +660,247 @@ static void weapons_updateLayer( const double dt, const WeaponLayer layer )
             i++;
       }
    }
+
+   /* Move the weapons that are left. Moving doesn't depend on the other
+    * weapons, so it gives the same result as moving each in weapon_update(). */
+   if (*nlayer > weapon_msolids) {
+      weapon_msolids = MAX( 2*weapon_msolids, *nlayer );
+      weapon_solids  = realloc( weapon_solids, weapon_msolids * sizeof(Solid*) );
+   }
+   for (i=0; i<*nlayer; i++)
+      weapon_solids[i] = &wlayer[i]->solid;
+   solid_updateBatch( weapon_solids, *nlayer, dt );
+
+   /* Update the sound. */
+   for (i=0; i<*nlayer; i++) {
+      w = wlayer[i];
+      sound_updatePos(w->voice, w->solid.pos.x, w->solid.pos.y,
+            w->solid.vel.x, w->solid.vel.y);
+   }
+}
+
+
+/**
+ * @brief Gathers the active jammers of all pilots and indexes them by range.
+ */
+static void weapons_gatherJammers (void)
+{
+   int i, j;
+   double r;
+   Pilot *p;
+   Outfit *o;
+   WeaponJammer *jam;
+
+   /* Must be cleared before the jammers move in memory. */
+   if (weapon_jamtree == NULL)
+      weapon_jamtree = rtree_create();
+   else
+      rtree_clear( weapon_jamtree );
+   weapon_njammers = 0;
+
+   /* Iterate over all pilots. */
+   for (i=0; i<pilot_nstack; i++) {
+      p = pilot_stack[i];
+
+      /* Must be jamming. */
+      if (!p->jamming)
+         continue;
+
+      /* Iterate over outfits to find jammers. */
+      for (j=0; j<p->noutfits; j++) {
+         o    = p->outfits[j]->outfit;
+         if (o==NULL)
+            continue;
+         /* Must be on. */
+         if (p->outfits[j]->state != PILOT_OUTFIT_ON)
+            continue;
+         /* Must be a jammer. */
+         if (!outfit_isJammer(o))
+            continue;
+
+         /* Grow memory if needed. */
+         if (weapon_njammers+1 > weapon_mjammers) {
+            weapon_mjammers = MAX( 16, 2*weapon_mjammers );
+            weapon_jammers  = realloc( weapon_jammers, weapon_mjammers * sizeof(WeaponJammer) );
+         }
+
+         jam         = &weapon_jammers[ weapon_njammers++ ];
+         jam->pos    = p->solid->pos;
+         jam->range2 = o->u.jam.range2;
+         jam->power  = o->u.jam.power;
+         jam->leaf   = NULL;
+      }
+   }
+
+   /* Index them once they no longer move in memory. */
+   for (i=0; i<weapon_njammers; i++) {
+      jam = &weapon_jammers[i];
+      r   = sqrt( jam->range2 );
+      rtree_insert( weapon_jamtree, jam, &jam->leaf,
+            jam->pos.x - r, jam->pos.x + r, jam->pos.y - r, jam->pos.y + r );
+   }
+}
+
+
+/**
+ * @brief Sets the jamming power of the seekers in a layer.
+ *
+ * Seekers only look up the jammers whose range covers them.
+ *
+ *    @param wlayer Layer to jam.
+ *    @param nlayer Number of weapons in the layer.
+ */
+static void weapons_jamLayer( Weapon **wlayer, int nlayer )
+{
+   int k;
+   Weapon *w;
+   WeaponJammer *jam;
+   struct rtree_iter iter;
+
+   for (k=0; k < nlayer; k++) {
+      w = wlayer[k];
+      if (!outfit_isSeeker( w->outfit ))
+         continue;
+
+      /* Reset jam power. */
+      w->jam_power = 0.;
+      if (weapon_njammers == 0)
+         continue;
+
+      profile_count( PROFILE_RTREE, 1 );
+      rtree_begin( weapon_jamtree, &iter );
+      while ((jam = rtree_find( &iter, w->solid.pos.x, w->solid.pos.x,
+                  w->solid.pos.y, w->solid.pos.y )) != NULL) {
+         /* Must be in range. */
+         if (jam->range2 < vect_dist2( &w->solid.pos, &jam->pos ))
+            continue;
+
+         /* We only consider the strongest jammer. */
+         w->jam_power = CLAMP( 0., 1., MAX( w->jam_power, (jam->power - w->outfit->u.amm.resist) ) );
+      }
+   }
+}
+
+
+/**
+ * @brief Queries the pilot rtree with the boxes of all the weapons in a layer.
+ *
+ * Candidates are left grouped by weapon in weapon_qcand, in the same order
+ * a query for each weapon on its own would find them.
+ *
+ *    @param wlayer Layer to query.
+ *    @param nlayer Number of weapons in the layer.
+ *    @param dt Current delta tick.
+ */
+static void weapons_queryLayer( Weapon **wlayer, int nlayer, const double dt )
+{
+   int i;
+
+   weapon_nqcand = 0;
+   if (pilot_rtree == NULL) {
+      for (i=0; i<nlayer; i++)
+         wlayer[i]->query = -1;
+      return;
+   }
+
+   /* Grow memory if needed. */
+   if (nlayer+1 > weapon_mqbox) {
+      weapon_mqbox = MAX( nlayer+1, 2*weapon_mqbox );
+      weapon_qbox  = realloc( weapon_qbox, weapon_mqbox * sizeof(struct bounding_rectangle) );
+      weapon_qoff  = realloc( weapon_qoff, weapon_mqbox * sizeof(int) );
+   }
+
+   for (i=0; i<nlayer; i++) {
+      weapon_getBox( wlayer[i], &weapon_qbox[i], dt );
+      wlayer[i]->query = i;
+   }
+   profile_count( PROFILE_RTREE, nlayer );
+   rtree_findBatch( pilot_rtree, weapon_qbox, nlayer, weapon_queryFound, NULL );
+
+   /* Group by weapon, keeping the order they were found in. */
+   memset( weapon_qoff, 0, (nlayer+1) * sizeof(int) );
+   for (i=0; i<weapon_nqcand; i++)
+      weapon_qoff[ weapon_qbid[i]+1 ]++;
+   for (i=0; i<nlayer; i++)
+      weapon_qoff[i+1] += weapon_qoff[i];
+   for (i=0; i<weapon_nqcand; i++)
+      weapon_qcand[ weapon_qoff[ weapon_qbid[i] ]++ ] = weapon_qfound[i];
+   /* Placing shifted every start up to the next one, so shift them back. */
+   for (i=nlayer; i>0; i--)
+      weapon_qoff[i] = weapon_qoff[i-1];
+   weapon_qoff[0] = 0;
+}
+
+
+/**
+ * @brief Stores a pilot found by the batched query.
+ *
+ *    @param value Pilot found.
+ *    @param box Index of the weapon whose box it overlaps.
+ *    @param data Unused.
+ */
+static void weapon_queryFound( void *value, int box, void *data )
+{
+   (void) data;
+
+   /* Grow memory if needed. */
+   if (weapon_nqcand+1 > weapon_mqcand) {
+      weapon_mqcand = MAX( WEAPON_CHUNK_MIN, 2*weapon_mqcand );
+      weapon_qbid   = realloc( weapon_qbid,   weapon_mqcand * sizeof(int) );
+      weapon_qfound = realloc( weapon_qfound, weapon_mqcand * sizeof(Pilot*) );
+      weapon_qcand  = realloc( weapon_qcand,  weapon_mqcand * sizeof(Pilot*) );
+   }
+
+   weapon_qbid[ weapon_nqcand ]   = box;
+   weapon_qfound[ weapon_nqcand ] = value;
+   weapon_nqcand++;
+}
+
+
+/**
+ * @brief Gets the box a weapon can collide with pilots and asteroids in.
+ *
+ * Bolts and ammo also cover the path they will fly along during dt, see
+ *  weapon_collideSwept().
+ *
+ *    @param w Weapon to get box of.
+ *    @param[out] box Box of the weapon.
+ *    @param dt Current delta tick, 0. to only get the current sprite.
+ */
+static void weapon_getBox( Weapon *w, struct bounding_rectangle *box, const double dt )
+{
+   glTexture *gfx;
+   double x, y, ex, ey, tmp;
+
+   x = VX(w->solid.pos);
+   y = VY(w->solid.pos);
+   if (!outfit_isBeam(w->outfit)) {
+      gfx = outfit_gfx(w->outfit);
+      ex  = x + VX(w->solid.vel) * dt;
+      ey  = y + VY(w->solid.vel) * dt;
+      box->x1 = MIN( x, ex ) - (gfx->sw / 2);
+      box->x2 = MAX( x, ex ) + (gfx->sw / 2);
+      box->y1 = MIN( y, ey ) - (gfx->sh / 2);
+      box->y2 = MAX( y, ey ) + (gfx->sh / 2);
+   }
+   else {
+      box->x1 = x;
+      box->y1 = y;
+      box->x2 = x + w->outfit->u.bem.range * cos(w->solid.dir);
+      box->y2 = y + w->outfit->u.bem.range * sin(w->solid.dir);
+
+      if (box->x1 > box->x2) {
+         tmp     = box->x1;
+         box->x1 = box->x2;
+         box->x2 = tmp;
+      }
+
+      if (box->y1 > box->y2) {
+         tmp     = box->y1;
+         box->y1 = box->y2;
+         box->y2 = tmp;
+      }
+   }
 }
 
 
@@ -712,10 +976,10 @@ static void weapon_render( Weapon* w, const double dt )
             if (outfit_isBolt(w->outfit) && w->outfit->u.blt.gfx_end)
                gl_blitSpriteInterpolate( gfx, w->outfit->u.blt.gfx_end,
                      w->timer / w->life,
-                     w->solid->pos.x, w->solid->pos.y,
+                     w->solid.pos.x, w->solid.pos.y,
                      w->sprite % (int)gfx->sx, w->sprite / (int)gfx->sx, &c );
             else
-               gl_blitSprite( gfx, w->solid->pos.x, w->solid->pos.y,
+               gl_blitSprite( gfx, w->solid.pos.x, w->solid.pos.y,
                      w->sprite % (int)gfx->sx, w->sprite / (int)gfx->sx, &c );
          }
          /* Outfit faces direction. */
@@ -723,9 +987,9 @@ static void weapon_render( Weapon* w, const double dt )
             if (outfit_isBolt(w->outfit) && w->outfit->u.blt.gfx_end)
                gl_blitSpriteInterpolate( gfx, w->outfit->u.blt.gfx_end,
                      w->timer / w->life,
-                     w->solid->pos.x, w->solid->pos.y, w->sx, w->sy, &c );
+                     w->solid.pos.x, w->solid.pos.y, w->sx, w->sy, &c );
             else
-               gl_blitSprite( gfx, w->solid->pos.x, w->solid->pos.y, w->sx, w->sy, &c );
+               gl_blitSprite( gfx, w->solid.pos.x, w->solid.pos.y, w->sx, w->sy, &c );
          }
          break;
 
@@ -740,13 +1004,13 @@ static void weapon_render( Weapon* w, const double dt )
          /* Position. */
          cam_getPos( &cx, &cy );
          gui_getOffset( &gx, &gy );
-         x = (w->solid->pos.x - cx)*z + gx;
-         y = (w->solid->pos.y - cy)*z + gy;
+         x = (w->solid.pos.x - cx)*z + gx;
+         y = (w->solid.pos.y - cy)*z + gy;
 
          /* Set up the matrix. */
          glPushMatrix();
             glTranslated( SCREEN_W/2.+x, SCREEN_H/2.+y, 0. );
-            glRotated( 270. + w->solid->dir / M_PI * 180., 0., 0., 1. );
+            glRotated( 270. + w->solid.dir / M_PI * 180., 0., 0., 1. );
 
          /* Preparatives. */
          glEnable(GL_TEXTURE_2D);
@@ -754,6 +1018,7 @@ static void weapon_render( Weapon* w, const double dt )
          glShadeModel(GL_SMOOTH);
 
          /* Actual rendering. */
+         profile_count( PROFILE_DRAWS, 1 );
          glBegin(GL_QUAD_STRIP);
 
             /* Start faded. */
@@ -896,148 +1161,161 @@ static int weapon_checkCanHit( Weapon* w, Pilot *p )
  */
 static void weapon_update( Weapon* w, const double dt, WeaponLayer layer )
 {
-   int i, j, b, psx,psy;
+   int k;
    glTexture *gfx;
    Vector2d crash[2];
    Pilot *p;
-   AsteroidAnchor *ast;
    Asteroid *a;
    AsteroidType *at;
-   struct rtree_iter *iter;
-   double x1, x2, y1, y2, tmp;
+   AsteroidIter aiter;
+   struct rtree_iter iter;
+   struct bounding_rectangle box;
 
    /* Get the sprite direction to speed up calculations. */
-   b     = outfit_isBeam(w->outfit);
-   if (!b) {
+   if (!outfit_isBeam(w->outfit)) {
       gfx = outfit_gfx(w->outfit);
-      gl_getSpriteFromDir( &w->sx, &w->sy, gfx, w->solid->dir );
-
-      x1 = VX(w->solid->pos) - (gfx->sw / 2);
-      x2 = VX(w->solid->pos) + (gfx->sw / 2);
-      y1 = VY(w->solid->pos) - (gfx->sh / 2);
-      y2 = VY(w->solid->pos) + (gfx->sh / 2);
+      gl_getSpriteFromDir( &w->sx, &w->sy, gfx, w->solid.dir );
    }
-   else {
+   else
       gfx = NULL;
 
-      x1 = VX(w->solid->pos);
-      y1 = VY(w->solid->pos);
-      x2 = x1 + w->outfit->u.bem.range * cos(w->solid->dir);
-      y2 = y1 + w->outfit->u.bem.range * sin(w->solid->dir);
-
-      if (x1 > x2) {
-         tmp = x1;
-	 x1 = x2;
-	 x2 = tmp;
-      }
-
-      if (y1 > y2) {
-         tmp = y1;
-	 y1 = y2;
-	 y2 = tmp;
-      }
+   /* Candidates were found by the batched query of the layer. */
+   if (w->query >= 0) {
+      for (k=weapon_qoff[w->query]; k<weapon_qoff[w->query+1]; k++)
+         if (weapon_collidePilot( w, weapon_qcand[k], gfx, layer, dt ))
+            return; /* Weapon is destroyed. */
+      w->query = -1;
    }
-
-   iter = rtree_begin(pilot_rtree);
-
-   while ((p = rtree_find(iter, x1, x2, y1, y2)) != NULL) {
-      psx = p->tsx;
-      psy = p->tsy;
-
-      if (w->parent == p->id) continue; /* pilot is self */
-
-      /* Beam weapons have special collisions. */
-      if (b) {
-         /* Check for collision. */
-         if (weapon_checkCanHit(w,p) &&
-               CollideLineSprite( &w->solid->pos, w->solid->dir,
-                     w->outfit->u.bem.range,
-                     p->ship->gfx_space, psx, psy,
-                     &p->solid->pos,
-                     crash)) {
-            weapon_hitBeam( w, p, layer, crash, dt );
-            /* No return because beam can still think, it's not
-             * destroyed like the other weapons.*/
-         }
-      }
-      /* smart weapons only collide with their target */
-      else if (weapon_isSmart(w)) {
-
-         if ((p->id == w->target) &&
-               (w->status == WEAPON_STATUS_OK) &&
-               weapon_checkCanHit(w,p) &&
-               CollideSprite( gfx, w->sx, w->sy, &w->solid->pos,
-                     p->ship->gfx_space, psx, psy,
-                     &p->solid->pos,
-                     &crash[0] )) {
-            weapon_hit( w, p, layer, &crash[0] );
-            rtree_iter_free(iter);
+   /* Not part of the batch, query on its own. */
+   else if (pilot_rtree != NULL) {
+      weapon_getBox( w, &box, dt );
+      profile_count( PROFILE_RTREE, 1 );
+      rtree_begin( pilot_rtree, &iter );
+      while ((p = rtree_find( &iter, box.x1, box.x2, box.y1, box.y2 )) != NULL)
+         if (weapon_collidePilot( w, p, gfx, layer, dt ))
             return; /* Weapon is destroyed. */
+   }
+
+   /* Asterokiller weapons collide with asteroids. */
+   if ((outfit_isAmmo(w->outfit) && w->outfit->u.amm.dmg.asterokill) ||
+         (outfit_isBolt(w->outfit) && w->outfit->u.blt.dmg.asterokill)) {
+      weapon_getBox( w, &box, dt );
+      asteroid_queryBegin( &aiter, cur_system, box.x1, box.x2, box.y1, box.y2 );
+      while ((a = asteroid_queryNext( &aiter )) != NULL) {
+         at = space_getType ( a->type );
+         if (a->appearing==0 &&
+             weapon_collideSwept( w, gfx, at->gfxs[a->gfxID], 0, 0,
+               &a->pos, &a->vel, dt, crash ) ) {
+               weapon_hitAst( w, a, layer, &crash[0] );
+               return; /* Weapon is destroyed. */
          }
       }
-      /* dumb weapons hit anything not of the same faction */
-      else {
-         if (weapon_checkCanHit(w,p) &&
-               CollideSprite( gfx, w->sx, w->sy, &w->solid->pos,
-                     p->ship->gfx_space, psx, psy,
-                     &p->solid->pos,
-                     &crash[0] )) {
-            weapon_hit( w, p, layer, &crash[0] );
-            rtree_iter_free(iter);
-            return; /* Weapon is destroyed. */
-         }
+   }
+
+   /* smart weapons also get to think their next move */
+   if (weapon_isSmart(w))
+      (*w->think)(w,dt);
+
+   /* weapons_updateLayer() moves the weapons once they are all updated. */
+}
+
+
+/**
+ * @brief Checks a weapon for collision with a pilot and hits it if they collide.
+ *
+ *    @param w Weapon to check.
+ *    @param p Pilot to check against.
+ *    @param gfx Graphic of the weapon, NULL for beams.
+ *    @param layer Layer to which the weapon belongs.
+ *    @param dt Current delta tick.
+ *    @return 1 if the weapon was destroyed, 0 otherwise.
+ */
+static int weapon_collidePilot( Weapon *w, Pilot *p, glTexture *gfx,
+      WeaponLayer layer, const double dt )
+{
+   Vector2d crash[2];
+
+   if (w->parent == p->id)
+      return 0; /* pilot is self */
+
+   /* Beam weapons have special collisions. */
+   if (gfx == NULL) {
+      /* Check for collision. */
+      if (weapon_checkCanHit(w,p) &&
+            CollideLineSprite( &w->solid.pos, w->solid.dir,
+                  w->outfit->u.bem.range,
+                  p->ship->gfx_space, p->tsx, p->tsy,
+                  &p->solid->pos,
+                  crash)) {
+         weapon_hitBeam( w, p, layer, crash, dt );
+         /* No return because beam can still think, it's not
+          * destroyed like the other weapons.*/
       }
    }
-   rtree_iter_free(iter);
-
-   /* Asterokiller weapons collide with asteroids*/
-   if (outfit_isAmmo(w->outfit)) {
-      if ( w->outfit->u.amm.dmg.asterokill ) {
-         for (i=0; i<cur_system->nasteroids; i++) {
-            ast = &cur_system->asteroids[i];
-            for (j=0; j<ast->nb; j++) {
-               a = &ast->asteroids[j];
-               at = space_getType ( a->type );
-               if (a->appearing==0 &&
-                   CollideSprite( gfx, w->sx, w->sy, &w->solid->pos,
-                     at->gfxs[a->gfxID], 0, 0, &a->pos,
-                     &crash[0] ) ) {
-                     weapon_hitAst( w, a, layer, &crash[0] );
-                     return; /* Weapon is destroyed. */
-               }
-            }
-         }
+   /* smart weapons only collide with their target */
+   else if (weapon_isSmart(w)) {
+
+      if ((p->id == w->target) &&
+            (w->status == WEAPON_STATUS_OK) &&
+            weapon_checkCanHit(w,p) &&
+            weapon_collideSwept( w, gfx, p->ship->gfx_space, p->tsx, p->tsy,
+                  &p->solid->pos, &p->solid->vel, dt, crash )) {
+         weapon_hit( w, p, layer, &crash[0] );
+         return 1;
       }
    }
-   else if (outfit_isBolt(w->outfit)) {
-      if ( w->outfit->u.blt.dmg.asterokill ) {
-         for (i=0; i<cur_system->nasteroids; i++) {
-            ast = &cur_system->asteroids[i];
-            for (j=0; j<ast->nb; j++) {
-               a = &ast->asteroids[j];
-               at = space_getType ( a->type );
-               if (a->appearing==0 &&
-                   CollideSprite( gfx, w->sx, w->sy, &w->solid->pos,
-                     at->gfxs[a->gfxID], 0, 0, &a->pos,
-                     &crash[0] ) ) {
-                     weapon_hitAst( w, a, layer, &crash[0] );
-                     return; /* Weapon is destroyed. */
-               }
-            }
-         }
+   /* dumb weapons hit anything not of the same faction */
+   else {
+      if (weapon_checkCanHit(w,p) &&
+            weapon_collideSwept( w, gfx, p->ship->gfx_space, p->tsx, p->tsy,
+                  &p->solid->pos, &p->solid->vel, dt, crash )) {
+         weapon_hit( w, p, layer, &crash[0] );
+         return 1;
       }
    }
 
-   /* smart weapons also get to think their next move */
-   if (weapon_isSmart(w))
-      (*w->think)(w,dt);
+   return 0;
+}
 
-   /* Update the solid position. */
-   (*w->solid->update)(w->solid, dt);
 
-   /* Update the sound. */
-   sound_updatePos(w->voice, w->solid->pos.x, w->solid->pos.y,
-         w->solid->vel.x, w->solid->vel.y);
+/**
+ * @brief Checks a bolt or ammo against a target, including where it flies during dt.
+ *
+ * The sprite is only checked where it is now, so a weapon moving further
+ *  than its own size in a tick relative to the target could skip over it
+ *  between two updates. Those also get the segment they fly along relative
+ *  to the target checked.
+ *
+ *    @param w Weapon to check.
+ *    @param gfx Sprite of the weapon.
+ *    @param bt Sprite of the target.
+ *    @param bsx X sprite of the target.
+ *    @param bsy Y sprite of the target.
+ *    @param bp Position of the target.
+ *    @param bv Velocity of the target.
+ *    @param dt Current delta tick.
+ *    @param[out] crash Position of the collision in crash[0].
+ *    @return 1 if they collide.
+ */
+static int weapon_collideSwept( Weapon *w, glTexture *gfx,
+      const glTexture *bt, int bsx, int bsy, const Vector2d *bp, const Vector2d *bv,
+      const double dt, Vector2d crash[2] )
+{
+   double vx, vy, d;
+
+   if (CollideSprite( gfx, w->sx, w->sy, &w->solid.pos,
+            bt, bsx, bsy, bp, &crash[0] ))
+      return 1;
+
+   /* Slow enough relative to the target for the next update to overlap this one. */
+   vx = VX(w->solid.vel) - VX(*bv);
+   vy = VY(w->solid.vel) - VY(*bv);
+   d  = MOD( vx, vy ) * dt;
+   if (d <= MIN( gfx->sw, gfx->sh ))
+      return 0;
+
+   return CollideLineSprite( &w->solid.pos, ANGLE( vx, vy ), d,
+         bt, bsx, bsy, bp, crash );
 }
 
 
@@ -1134,13 +1412,13 @@ static void weapon_hit( Weapon* w, Pilot* p, WeaponLayer layer, Vector2d* pos )
    s = outfit_soundHit(w->outfit);
    if (s != -1)
       w->voice = sound_playPos( s,
-            w->solid->pos.x,
-            w->solid->pos.y,
-            w->solid->vel.x,
-            w->solid->vel.y);
+            w->solid.pos.x,
+            w->solid.pos.y,
+            w->solid.vel.x,
+            w->solid.vel.y);
 
    /* Have pilot take damage and get real damage done. */
-   damage = pilot_hit( p, w->solid, w->parent, &dmg, 1 );
+   damage = pilot_hit( p, &w->solid, w->parent, &dmg, 1 );
 
    /* Get the layer. */
    spfx_layer = (p==player.p) ? SPFX_LAYER_FRONT : SPFX_LAYER_BACK;
@@ -1176,10 +1454,10 @@ static void weapon_hitAst( Weapon* w, Asteroid* a, WeaponLayer layer, Vector2d*
    s = outfit_soundHit(w->outfit);
    if (s != -1)
       w->voice = sound_playPos( s,
-            w->solid->pos.x,
-            w->solid->pos.y,
-            w->solid->vel.x,
-            w->solid->vel.y);
+            w->solid.pos.x,
+            w->solid.pos.y,
+            w->solid.vel.x,
+            w->solid.vel.y);
 
    /* Add the spfx */
    spfx = outfit_spfxShield(w->outfit);
@@ -1219,7 +1497,7 @@ static void weapon_hitBeam( Weapon* w, Pilot* p, WeaponLayer layer,
    dmg.disable       = odmg->disable * dt;
 
    /* Have pilot take damage and get real damage done. */
-   damage = pilot_hit( p, w->solid, w->parent, &dmg, 1 );
+   damage = pilot_hit( p, &w->solid, w->parent, &dmg, 1 );
 
    /* Add sprite, layer depends on whether player shot or not. */
    if (w->exp_timer == -1.) {
@@ -1363,16 +1641,16 @@ static void weapon_createBolt( Weapon *w, const Outfit* outfit, double T,
    vect_cadd( &v, outfit->u.blt.speed*cos(rdir), outfit->u.blt.speed*sin(rdir));
    w->timer = outfit->u.blt.range / outfit->u.blt.speed;
    w->falloff = w->timer - outfit->u.blt.falloff / outfit->u.blt.speed;
-   w->solid = solid_create( mass, rdir, pos, &v, SOLID_UPDATE_EULER );
+   solid_init( &w->solid, mass, rdir, pos, &v, SOLID_UPDATE_EULER );
    w->voice = sound_playPos( w->outfit->u.blt.sound,
-         w->solid->pos.x,
-         w->solid->pos.y,
-         w->solid->vel.x,
-         w->solid->vel.y);
+         w->solid.pos.x,
+         w->solid.pos.y,
+         w->solid.vel.x,
+         w->solid.vel.y);
 
    /* Set facing direction. */
    gfx = outfit_gfx( w->outfit );
-   gl_getSpriteFromDir( &w->sx, &w->sy, gfx, w->solid->dir );
+   gl_getSpriteFromDir( &w->sx, &w->sy, gfx, w->solid.dir );
 }
 
 
@@ -1428,10 +1706,10 @@ static void weapon_createAmmo( Weapon *w, const Outfit* launcher, double T,
    /* Set up ammo details. */
    mass        = w->outfit->mass;
    w->timer    = ammo->u.amm.duration;
-   w->solid    = solid_create( mass, rdir, pos, &v, SOLID_UPDATE_RK4 );
+   solid_init( &w->solid, mass, rdir, pos, &v, SOLID_UPDATE_RK4 );
    if (w->outfit->u.amm.thrust != 0.) {
       weapon_setThrust( w, w->outfit->u.amm.thrust * mass );
-      w->solid->speed_max = w->outfit->u.amm.speed; /* Limit speed, we only care if it has thrust. */
+      w->solid.speed_max = w->outfit->u.amm.speed; /* Limit speed, we only care if it has thrust. */
    }
 
    /* Handle seekers. */
@@ -1447,14 +1725,85 @@ static void weapon_createAmmo( Weapon *w, const Outfit* launcher, double T,
 
    /* Play sound. */
    w->voice    = sound_playPos(w->outfit->u.amm.sound,
-         w->solid->pos.x,
-         w->solid->pos.y,
-         w->solid->vel.x,
-         w->solid->vel.y);
+         w->solid.pos.x,
+         w->solid.pos.y,
+         w->solid.vel.x,
+         w->solid.vel.y);
 
    /* Set facing direction. */
    gfx = outfit_gfx( w->outfit );
-   gl_getSpriteFromDir( &w->sx, &w->sy, gfx, w->solid->dir );
+   gl_getSpriteFromDir( &w->sx, &w->sy, gfx, w->solid.dir );
+}
+
+
+/**
+ * @brief Gets a free weapon from the pool.
+ *
+ *    @return A zeroed weapon with its handle set.
+ */
+static Weapon* weapon_poolAlloc (void)
+{
+   int i, slot;
+   unsigned int gen;
+   Weapon *w;
+
+   /* Grow the pool a chunk at a time, lowest slots are used first. */
+   if (weapon_nvacant == 0) {
+      if ((unsigned int)(weapon_npool+1)*WEAPON_POOL_CHUNK > WEAPON_HANDLE_SLOT)
+         ERR(_("Too many weapons!"));
+      weapon_pool = realloc( weapon_pool, (weapon_npool+1) * sizeof(Weapon*) );
+      weapon_pool[ weapon_npool ] = calloc( WEAPON_POOL_CHUNK, sizeof(Weapon) );
+      weapon_vacant = realloc( weapon_vacant, (weapon_npool+1) * WEAPON_POOL_CHUNK * sizeof(int) );
+      for (i=WEAPON_POOL_CHUNK-1; i>=0; i--) {
+         weapon_pool[ weapon_npool ][i].slot = weapon_npool*WEAPON_POOL_CHUNK + i;
+         weapon_vacant[ weapon_nvacant++ ] = weapon_npool*WEAPON_POOL_CHUNK + i;
+      }
+      weapon_npool++;
+   }
+
+   slot = weapon_vacant[ --weapon_nvacant ];
+   w    = &weapon_pool[ slot / WEAPON_POOL_CHUNK ][ slot % WEAPON_POOL_CHUNK ];
+
+   /* Bump the generation so old handles to the slot stop working, 0 is never a handle. */
+   gen = (w->gen + 1) & (~0u >> WEAPON_HANDLE_BITS);
+   if (gen == 0)
+      gen = 1;
+   memset( w, 0, sizeof(Weapon) );
+   w->slot = slot;
+   w->gen  = gen;
+   w->ID   = (gen << WEAPON_HANDLE_BITS) | (unsigned int)slot;
+   return w;
+}
+
+
+/**
+ * @brief Returns a weapon to the pool.
+ *
+ *    @param w Weapon to return.
+ */
+static void weapon_poolFree( Weapon *w )
+{
+   w->ID = 0;
+   weapon_vacant[ weapon_nvacant++ ] = w->slot;
+}
+
+
+/**
+ * @brief Gets a weapon by its handle.
+ *
+ *    @param handle Handle of the weapon.
+ *    @return The weapon or NULL if it has been destroyed since.
+ */
+static Weapon* weapon_get( unsigned int handle )
+{
+   unsigned int slot;
+   Weapon *w;
+
+   slot = handle & WEAPON_HANDLE_SLOT;
+   if ((handle == 0) || (slot >= (unsigned int)weapon_npool*WEAPON_POOL_CHUNK))
+      return NULL;
+   w = &weapon_pool[ slot / WEAPON_POOL_CHUNK ][ slot % WEAPON_POOL_CHUNK ];
+   return (w->ID == handle) ? w : NULL;
 }
 
 
@@ -1480,7 +1829,7 @@ static Weapon* weapon_create( const Outfit* outfit, double T,
    Weapon* w;
 
    /* Create basic features */
-   w           = calloc( 1, sizeof(Weapon) );
+   w           = weapon_poolAlloc();
    w->dam_mod  = 1.; /* Default of 100% damage. */
    w->faction  = parent->faction; /* non-changeable */
    w->parent   = parent->id; /* non-changeable */
@@ -1492,6 +1841,7 @@ static Weapon* weapon_create( const Outfit* outfit, double T,
    w->update   = weapon_update;
    w->status   = WEAPON_STATUS_OK;
    w->strength = 1.;
+   w->query    = -1;
 
    switch (outfit->type) {
 
@@ -1516,14 +1866,14 @@ static Weapon* weapon_create( const Outfit* outfit, double T,
          else if (rdir >= 2.*M_PI)
             rdir -= 2.*M_PI;
          mass = 1.; /**< Needs a mass. */
-         w->solid = solid_create( mass, rdir, pos, vel, SOLID_UPDATE_EULER );
+         solid_init( &w->solid, mass, rdir, pos, vel, SOLID_UPDATE_EULER );
          w->think = think_beam;
          w->timer = outfit->u.bem.duration;
          w->voice = sound_playPos( w->outfit->u.bem.sound,
-               w->solid->pos.x,
-               w->solid->pos.y,
-               w->solid->vel.x,
-               w->solid->vel.y);
+               w->solid.pos.x,
+               w->solid.pos.y,
+               w->solid.vel.x,
+               w->solid.vel.y);
          break;
 
       /* Treat seekers together. */
@@ -1536,7 +1886,7 @@ static Weapon* weapon_create( const Outfit* outfit, double T,
       default:
          WARN(_("Weapon of type '%s' has no create implemented yet!"),
                w->outfit->name);
-         w->solid = solid_create( 1., dir, pos, vel, SOLID_UPDATE_EULER );
+         solid_init( &w->solid, 1., dir, pos, vel, SOLID_UPDATE_EULER );
          break;
    }
 
@@ -1656,7 +2006,6 @@ unsigned int beam_start( const Outfit* outfit,
 
    layer = (parent->id==PLAYER_ID) ? WEAPON_LAYER_FG : WEAPON_LAYER_BG;
    w = weapon_create( outfit, 0., dir, pos, vel, parent, target, 0. );
-   w->ID = ++beam_idgen;
    w->mount = mount;
    w->exp_timer = 0.;
 
@@ -1717,37 +2066,15 @@ unsigned int beam_start( const Outfit* outfit,
  */
 void beam_end( const unsigned int parent, unsigned int beam )
 {
-   int i;
    WeaponLayer layer;
-   Weapon **curLayer;
-   int *nLayer;
+   Weapon *w;
 
    layer = (parent==PLAYER_ID) ? WEAPON_LAYER_FG : WEAPON_LAYER_BG;
 
-   /* set the proper layer */
-   switch (layer) {
-      case WEAPON_LAYER_BG:
-         curLayer = wbackLayer;
-         nLayer = &nwbackLayer;
-         break;
-      case WEAPON_LAYER_FG:
-         curLayer = wfrontLayer;
-         nLayer = &nwfrontLayer;
-         break;
-
-      default:
-         ERR(_("Invalid WEAPON_LAYER specified"));
-         return;
-   }
-
-
-   /* Now try to destroy the beam. */
-   for (i=0; i<*nLayer; i++) {
-      if (curLayer[i]->ID == beam) { /* Found it. */
-         weapon_destroy(curLayer[i], layer);
-         break;
-      }
-   }
+   /* Now try to destroy the beam, it may already be gone. */
+   w = weapon_get( beam );
+   if ((w != NULL) && (w->parent == parent) && outfit_isBeam(w->outfit))
+      weapon_destroy( w, layer );
 }
 
 
@@ -1813,20 +2140,13 @@ static void weapon_free( Weapon* w )
    if (outfit_isBeam(w->outfit)) {
       sound_stop( w->voice );
       sound_playPos(w->outfit->u.bem.sound_off,
-            w->solid->pos.x,
-            w->solid->pos.y,
-            w->solid->vel.x,
-            w->solid->vel.y);
+            w->solid.pos.x,
+            w->solid.pos.y,
+            w->solid.vel.x,
+            w->solid.vel.y);
    }
 
-   /* Free the solid. */
-   solid_free(w->solid);
-
-#ifdef DEBUGGING
-   memset(w, 0, sizeof(Weapon));
-#endif /* DEBUGGING */
-
-   free(w);
+   weapon_poolFree(w);
 }
 
 /**
@@ -1853,6 +2173,8 @@ void weapon_clear (void)
  */
 void weapon_exit (void)
 {
+   int i;
+
    weapon_clear();
 
    /* Destroy front layer. */
@@ -1869,6 +2191,46 @@ void weapon_exit (void)
       mwfrontLayer = 0;
    }
 
+   /* Destroy the pool. */
+   for (i=0; i<weapon_npool; i++)
+      free( weapon_pool[i] );
+   free( weapon_pool );
+   free( weapon_vacant );
+   weapon_pool    = NULL;
+   weapon_npool   = 0;
+   weapon_vacant  = NULL;
+   weapon_nvacant = 0;
+
+   /* Destroy query memory. */
+   free( weapon_qbox );
+   free( weapon_qoff );
+   free( weapon_qbid );
+   free( weapon_qfound );
+   free( weapon_qcand );
+   weapon_qbox    = NULL;
+   weapon_qoff    = NULL;
+   weapon_qbid    = NULL;
+   weapon_qfound  = NULL;
+   weapon_qcand   = NULL;
+   weapon_mqbox   = 0;
+   weapon_mqcand  = 0;
+   weapon_nqcand  = 0;
+
+   /* Destroy the solids. */
+   free( weapon_solids );
+   weapon_solids  = NULL;
+   weapon_msolids = 0;
+
+   /* Destroy jammers. */
+   if (weapon_jamtree != NULL) {
+      rtree_free( weapon_jamtree );
+      weapon_jamtree = NULL;
+   }
+   free( weapon_jammers );
+   weapon_jammers  = NULL;
+   weapon_njammers = 0;
+   weapon_mjammers = 0;
+
    /* Destroy VBO. */
    if (weapon_vbo != NULL) {
       free( weapon_vboData );
@@ -1929,8 +2291,8 @@ static void weapon_explodeLayer( WeaponLayer layer,
       if (((mode & EXPL_MODE_MISSILE) && outfit_isAmmo(curLayer[i]->outfit)) ||
             ((mode & EXPL_MODE_BOLT) && outfit_isBolt(curLayer[i]->outfit))) {
 
-         dist = pow2(curLayer[i]->solid->pos.x - x) +
-               pow2(curLayer[i]->solid->pos.y - y);
+         dist = pow2(curLayer[i]->solid.pos.x - x) +
+               pow2(curLayer[i]->solid.pos.y - y);
 
          if (dist < rad2) {
             weapon_destroy(curLayer[i], layer);
@@ -0,0 +1,24 @@
+#!/usr/bin/env bash
+#
+# Runs the headless benchmark scenarios in dat/scenarios/ and prints their
+# timings. The first run of a scenario records its trace in $TRACES, later runs
+# replay it and fail if the simulation diverged.
+#
+#    usage: run.sh [naev binary] [extra naev options]
+
+NAEV="${1:-./naev}"
+shift
+TRACES="${TRACES:-traces}"
+DIR="$(dirname "$0")/../../dat/scenarios"
+
+mkdir -p "$TRACES"
+status=0
+for file in "$DIR"/*.xml; do
+   name="$(basename "$file" .xml)"
+   echo "== $name"
+   if ! "$NAEV" --scenario "$name" --trace "$TRACES/$name.trace" "$@"; then
+      echo "!! $name failed"
+      status=1
+   fi
+done
+exit $status
@@ -0,0 +1,259 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/*
+ * Replays N objects moving for M ticks and compares rebuilding the rtree every
+ * tick (what pilots_update() used to do) with maintaining it incrementally,
+ * and querying it box by box with querying all the boxes in one traversal.
+ *
+ *    usage: rtreebench [objects] [ticks] [queries per tick]
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <math.h>
+
+#include "rtree.h"
+#include "opengl.h"
+
+
+/* logging macros */
+#define LOG(str, args...)	\
+		(fprintf(stdout,str"\n", ## args))
+#define WARN(str, args...)	\
+		(fprintf(stderr,"Warning: "str"\n", ## args))
+
+
+#define DT        (1./60.) /* Tick length. */
+#define FIELD     15000. /* Half-size of the area objects move in. */
+#define MARGIN    8. /* Same padding pilots get. */
+#define MARGIN_T  0.25
+#define QUERY_SZ  20. /* Size of a bolt. */
+
+
+typedef struct Object_ {
+   double x, y, vx, vy, w, h;
+   struct rtree_node *leaf;
+} Object;
+
+
+/* rtree_draw() is never called, these just satisfy the linker. */
+glInfo gl_screen;
+void gl_renderRectEmpty( double x, double y, double w, double h, const glColour *c )
+{
+   (void) x; (void) y; (void) w; (void) h; (void) c;
+}
+
+
+static unsigned int bench_seed; /* Deterministic so both runs replay the same scene. */
+static double bench_rand (void)
+{
+   bench_seed = bench_seed * 1103515245u + 12345u;
+   return (double)((bench_seed >> 8) & 0xffffff) / (double)0x1000000;
+}
+
+
+static double bench_now (void)
+{
+   struct timespec ts;
+   clock_gettime( CLOCK_MONOTONIC, &ts );
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static void objects_init( Object *o, int n )
+{
+   int i;
+   bench_seed = 42;
+   for (i=0; i<n; i++) {
+      o[i].x  = (2.*bench_rand()-1.) * FIELD;
+      o[i].y  = (2.*bench_rand()-1.) * FIELD;
+      o[i].vx = (2.*bench_rand()-1.) * 300.;
+      o[i].vy = (2.*bench_rand()-1.) * 300.;
+      o[i].w  = 20. + bench_rand() * 200.;
+      o[i].h  = o[i].w;
+      o[i].leaf = NULL;
+   }
+}
+
+
+static void objects_move( Object *o, int n )
+{
+   int i;
+   for (i=0; i<n; i++) {
+      o[i].vx += (2.*bench_rand()-1.) * 20.;
+      o[i].vy += (2.*bench_rand()-1.) * 20.;
+      if ((o[i].x > FIELD && o[i].vx > 0.) || (o[i].x < -FIELD && o[i].vx < 0.))
+         o[i].vx = -o[i].vx;
+      if ((o[i].y > FIELD && o[i].vy > 0.) || (o[i].y < -FIELD && o[i].vy < 0.))
+         o[i].vy = -o[i].vy;
+      o[i].x += o[i].vx * DT;
+      o[i].y += o[i].vy * DT;
+   }
+}
+
+
+/* Runs queries around random objects, returns actual overlaps found. */
+static long objects_query( struct rtree *tree, Object *o, int n, int q )
+{
+   int i;
+   long hits;
+   double x, y;
+   Object *p;
+   struct rtree_iter iter;
+
+   hits = 0;
+   for (i=0; i<q; i++) {
+      p = &o[ (int)(bench_rand() * n) % n ];
+      x = p->x + (2.*bench_rand()-1.) * p->w;
+      y = p->y + (2.*bench_rand()-1.) * p->h;
+      rtree_begin( tree, &iter );
+      while ((p = rtree_find( &iter, x-QUERY_SZ/2., x+QUERY_SZ/2., y-QUERY_SZ/2., y+QUERY_SZ/2. )) != NULL) {
+         /* Candidates are checked exactly, like CollideSprite() would. */
+         if ((p->x-p->w/2. <= x+QUERY_SZ/2.) && (x-QUERY_SZ/2. <= p->x+p->w/2.) &&
+               (p->y-p->h/2. <= y+QUERY_SZ/2.) && (y-QUERY_SZ/2. <= p->y+p->h/2.))
+            hits++;
+      }
+   }
+   return hits;
+}
+
+
+typedef struct BatchData_ {
+   const struct bounding_rectangle *boxes;
+   long hits;
+} BatchData;
+static void objects_batchFound( void *value, int box, void *data )
+{
+   Object *p = value;
+   BatchData *bd = data;
+   const struct bounding_rectangle *b = &bd->boxes[box];
+   if ((p->x-p->w/2. <= b->x2) && (b->x1 <= p->x+p->w/2.) &&
+         (p->y-p->h/2. <= b->y2) && (b->y1 <= p->y+p->h/2.))
+      bd->hits++;
+}
+
+
+/* Same queries as objects_query(), but done in a single traversal. */
+static long objects_queryBatch( struct rtree *tree, Object *o, int n, int q,
+      struct bounding_rectangle *boxes )
+{
+   int i;
+   double x, y;
+   Object *p;
+   BatchData bd;
+
+   for (i=0; i<q; i++) {
+      p = &o[ (int)(bench_rand() * n) % n ];
+      x = p->x + (2.*bench_rand()-1.) * p->w;
+      y = p->y + (2.*bench_rand()-1.) * p->h;
+      boxes[i].x1 = x-QUERY_SZ/2.;
+      boxes[i].x2 = x+QUERY_SZ/2.;
+      boxes[i].y1 = y-QUERY_SZ/2.;
+      boxes[i].y2 = y+QUERY_SZ/2.;
+   }
+   bd.boxes = boxes;
+   bd.hits  = 0;
+   rtree_findBatch( tree, boxes, q, objects_batchFound, &bd );
+   return bd.hits;
+}
+
+
+static double bench_rebuild( Object *o, int n, int m, int q, long *hits )
+{
+   int i, t;
+   double start;
+   struct rtree *tree;
+
+   objects_init( o, n );
+   *hits = 0;
+   start = bench_now();
+   for (t=0; t<m; t++) {
+      objects_move( o, n );
+      tree = rtree_create();
+      for (i=0; i<n; i++)
+         rtree_insert( tree, &o[i], &o[i].leaf,
+               o[i].x-o[i].w/2., o[i].x+o[i].w/2., o[i].y-o[i].h/2., o[i].y+o[i].h/2. );
+      *hits += objects_query( tree, o, n, q );
+      rtree_free( tree );
+   }
+   return bench_now() - start;
+}
+
+
+static double bench_incremental( Object *o, int n, int m, int q, long *hits,
+      struct bounding_rectangle *boxes )
+{
+   int i, t;
+   double start, margin, speed;
+   struct rtree *tree;
+
+   objects_init( o, n );
+   *hits = 0;
+   start = bench_now();
+   tree = rtree_create();
+   for (t=0; t<m; t++) {
+      objects_move( o, n );
+      for (i=0; i<n; i++) {
+         speed  = sqrt( o[i].vx*o[i].vx + o[i].vy*o[i].vy );
+         margin = MARGIN + MARGIN_T * speed;
+         rtree_update( tree, &o[i], &o[i].leaf,
+               o[i].x-o[i].w/2., o[i].x+o[i].w/2., o[i].y-o[i].h/2., o[i].y+o[i].h/2.,
+               margin );
+      }
+      if (boxes != NULL)
+         *hits += objects_queryBatch( tree, o, n, q, boxes );
+      else
+         *hits += objects_query( tree, o, n, q );
+   }
+   rtree_free( tree );
+   return bench_now() - start;
+}
+
+
+int main( int argc, char **argv )
+{
+   int n, m, q;
+   long hits_rebuild, hits_incremental, hits_batch;
+   double t_rebuild, t_incremental, t_batch;
+   Object *o;
+   struct bounding_rectangle *boxes;
+
+   n = (argc > 1) ? atoi(argv[1]) : 500;
+   m = (argc > 2) ? atoi(argv[2]) : 3600;
+   q = (argc > 3) ? atoi(argv[3]) : 2000;
+   if ((n <= 0) || (m <= 0) || (q < 0)) {
+      WARN("usage: %s [objects] [ticks] [queries per tick]", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   o     = malloc( n * sizeof(Object) );
+   boxes = malloc( (q+1) * sizeof(struct bounding_rectangle) );
+
+   t_rebuild     = bench_rebuild( o, n, m, q, &hits_rebuild );
+   t_incremental = bench_incremental( o, n, m, q, &hits_incremental, NULL );
+   t_batch       = bench_incremental( o, n, m, q, &hits_batch, boxes );
+
+   LOG("%d objects, %d ticks, %d queries per tick", n, m, q);
+   LOG("rebuild:     %8.3f s  (%7.2f us/tick)  %ld hits", t_rebuild, t_rebuild / m * 1e6, hits_rebuild);
+   LOG("incremental: %8.3f s  (%7.2f us/tick)  %ld hits", t_incremental, t_incremental / m * 1e6, hits_incremental);
+   LOG("batched:     %8.3f s  (%7.2f us/tick)  %ld hits", t_batch, t_batch / m * 1e6, hits_batch);
+
+   free(o);
+   free(boxes);
+
+   if (hits_rebuild != hits_incremental) {
+      WARN("Incremental tree found %ld overlaps, rebuilt tree found %ld!",
+            hits_incremental, hits_rebuild);
+      return EXIT_FAILURE;
+   }
+   if (hits_batch != hits_incremental) {
+      WARN("Batched queries found %ld overlaps, single queries found %ld!",
+            hits_batch, hits_incremental);
+      return EXIT_FAILURE;
+   }
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,170 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/*
+ * Moves the same random solids for M ticks once with their own update
+ * functions and once with solid_updateBatch(), and fails unless both end up
+ * bit for bit the same, so a trace recorded with either replays with the
+ * other.
+ *
+ *    usage: solidcheck [solids] [ticks]
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <time.h>
+#include <math.h>
+#include <string.h>
+
+#include "naev.h"
+#include "physics.h"
+
+
+/* logging macros */
+#define LOG(str, args...)	\
+		(fprintf(stdout,str"\n", ## args))
+#define WARN(str, args...)	\
+		(fprintf(stderr,"Warning: "str"\n", ## args))
+
+
+#define DT        (1./60.) /* Tick length. */
+
+
+/* physics.c only logs on bad input, this satisfies the linker. */
+int logprintf( FILE *stream, int newline, const char *fmt, ... )
+{
+   va_list ap;
+   int n;
+   va_start( ap, fmt );
+   n = vfprintf( stream, fmt, ap );
+   va_end( ap );
+   if (newline)
+      fputc( '\n', stream );
+   return n;
+}
+
+
+static unsigned int check_seed; /* Deterministic so both runs replay the same scene. */
+static double check_rand (void)
+{
+   check_seed = check_seed * 1103515245u + 12345u;
+   return (double)((check_seed >> 8) & 0xffffff) / (double)0x1000000;
+}
+
+
+static double check_now (void)
+{
+   struct timespec ts;
+   clock_gettime( CLOCK_MONOTONIC, &ts );
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static void solids_init( Solid *s, int n )
+{
+   int i;
+   Vector2d pos, vel;
+   check_seed = 42;
+   for (i=0; i<n; i++) {
+      vect_cset( &pos, (2.*check_rand()-1.) * 10000., (2.*check_rand()-1.) * 10000. );
+      vect_pset( &vel, check_rand() * 600., check_rand() * 2.*M_PI );
+      solid_init( &s[i], 10. + check_rand() * 1000., check_rand() * 2.*M_PI,
+            &pos, &vel, (i%3==0) ? SOLID_UPDATE_EULER : SOLID_UPDATE_RK4 );
+   }
+}
+
+
+/* Changes the controls like pilots and seekers would. */
+static void solids_steer( Solid *s, int n, int t )
+{
+   int i;
+   for (i=0; i<n; i++) {
+      if ((t+i) % 30 != 0)
+         continue;
+      s[i].thrust    = (check_rand() < 0.3) ? 0. : check_rand() * 50. * s[i].mass;
+      s[i].dir_vel   = (check_rand() < 0.3) ? 0. : (2.*check_rand()-1.) * 3.;
+      s[i].speed_max = (check_rand() < 0.5) ? -1. : check_rand() * 400.;
+   }
+}
+
+
+static double check_scalar( Solid *s, int n, int m )
+{
+   int i, t;
+   double start;
+
+   solids_init( s, n );
+   start = check_now();
+   for (t=0; t<m; t++) {
+      solids_steer( s, n, t );
+      for (i=0; i<n; i++)
+         s[i].update( &s[i], DT );
+   }
+   return check_now() - start;
+}
+
+
+static double check_batch( Solid *s, Solid **ps, int n, int m )
+{
+   int i, t;
+   double start;
+
+   solids_init( s, n );
+   for (i=0; i<n; i++)
+      ps[i] = &s[i];
+   start = check_now();
+   for (t=0; t<m; t++) {
+      solids_steer( s, n, t );
+      solid_updateBatch( ps, n, DT );
+   }
+   return check_now() - start;
+}
+
+
+int main( int argc, char **argv )
+{
+   int i, n, m, bad;
+   double t_scalar, t_batch;
+   Solid *a, *b, **pb;
+
+   n = (argc > 1) ? atoi(argv[1]) : 2000;
+   m = (argc > 2) ? atoi(argv[2]) : 600;
+   if ((n <= 0) || (m <= 0)) {
+      WARN("usage: %s [solids] [ticks]", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   a  = malloc( n * sizeof(Solid) );
+   b  = malloc( n * sizeof(Solid) );
+   pb = malloc( n * sizeof(Solid*) );
+
+   t_scalar = check_scalar( a, n, m );
+   t_batch  = check_batch( b, pb, n, m );
+
+   bad = 0;
+   for (i=0; i<n; i++) {
+      if (memcmp( &a[i], &b[i], sizeof(Solid) ) == 0)
+         continue;
+      if (bad < 10)
+         WARN("Solid %d differs: (%.17g,%.17g) vs (%.17g,%.17g)", i,
+               a[i].pos.x, a[i].pos.y, b[i].pos.x, b[i].pos.y);
+      bad++;
+   }
+
+   LOG("%d solids, %d ticks", n, m);
+   LOG("scalar:  %8.3f s  (%7.2f us/tick)", t_scalar, t_scalar / m * 1e6);
+   LOG("batched: %8.3f s  (%7.2f us/tick)", t_batch, t_batch / m * 1e6);
+
+   free(a);
+   free(b);
+   free(pb);
+
+   if (bad > 0) {
+      WARN("%d of %d solids differ!", bad, n);
+      return EXIT_FAILURE;
+   }
+   return EXIT_SUCCESS;
+}